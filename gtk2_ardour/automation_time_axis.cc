@@ -1177,6 +1177,7 @@ AutomationTimeAxisView::cut_copy_clear_one (AutomationLine& line, Selection& sel
 			(*x)->when = when;
 			(*x)->value = val;
 		}
+		what_we_got->mark_dirty ();
 	}
 }
 
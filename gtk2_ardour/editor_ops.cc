@@ -4322,6 +4322,7 @@ Editor::cut_copy_points (Editing::CutCopyOp op, Temporal::Beats earliest, bool m
 			for (AutomationList::iterator ctrl_evt = al_cpy->begin(); ctrl_evt != al_cpy->end(); ++ctrl_evt) {
 				(*ctrl_evt)->when -= line_offset;
 			}
+			al_cpy->mark_dirty ();
 
 			/* And add it to the cut buffer */
 			cut_buffer->add (al_cpy);
@@ -4951,7 +4952,9 @@ Editor::reset_point_selection ()
 {
 	for (PointSelection::iterator i = selection->points.begin(); i != selection->points.end(); ++i) {
 		ARDOUR::AutomationList::iterator j = (*i)->model ();
-		(*j)->value = (*i)->line().the_list()->descriptor ().normal;
+		boost::shared_ptr<ARDOUR::AutomationList> list = (*i)->line().the_list();
+		/* through the list, which marks it dirty */
+		list->modify (j, (*j)->when, list->descriptor ().normal);
 	}
 }
 
@@ -209,6 +209,7 @@ SessionOptionEditor::SessionOptionEditor (Session* s)
 #ifdef HAVE_RF64_RIFF
 	hf->add (RF64_WAV, _("RF64 (WAV compatible)"));
 #endif
+	hf->add (FLAC, _("FLAC (lossless compression, no 32-bit float)"));
 
 	add_option (_("Media"), hf);
 
@@ -0,0 +1,136 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef __ardour_audio_block_cache_h__
+#define __ardour_audio_block_cache_h__
+
+#include <list>
+#include <map>
+#include <vector>
+
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+#include <glibmm/threads.h>
+
+#include "pbd/id.h"
+
+#include "ardour/libardour_visibility.h"
+#include "ardour/types.h"
+
+namespace ARDOUR {
+
+/** A memory-budgeted, least-recently-used cache of decoded audio, in
+ *  fixed-size blocks keyed by (source, generation, block number).
+ *
+ *  AudioSource::read() goes through it for read-only sources, so that
+ *  regions sharing a source (loops, duplicates, repeated auditions) do
+ *  not read and decode the same part of the file again. The source's
+ *  generation changes whenever the samples it reads do (gain, file),
+ *  so blocks of an older generation are never found again.
+ *
+ *  Blocks are handed out as shared pointers and are immutable once
+ *  inserted, so copying data out does not need the cache lock.
+ *  Each Session owns one, and clears it when it is closed.
+ *  The budget is the "audio-block-cache-mb" configuration variable;
+ *  0 disables the cache.
+ */
+class LIBARDOUR_API AudioBlockCache
+{
+public:
+	/** samples per block */
+	static const samplecnt_t block_samples = 65536;
+
+	struct Block {
+		Block () : data (block_samples), length (0) {}
+
+		std::vector<Sample> data;
+		samplecnt_t         length; ///< number of valid samples
+	};
+
+	struct Stats {
+		Stats () : hits (0), misses (0), evictions (0), blocks (0), bytes (0) {}
+
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+		size_t   blocks;
+		size_t   bytes;
+	};
+
+	AudioBlockCache ();
+
+	/** @return true if the cache has a non-zero budget */
+	bool enabled () const;
+
+	boost::shared_ptr<Block const> lookup (PBD::ID const& source, uint32_t generation, uint64_t block);
+	void insert (PBD::ID const& source, uint32_t generation, uint64_t block, boost::shared_ptr<Block const>);
+
+	/** @return true if the block is cached; unlike lookup(), this does not
+	 *  count as a use of the block, or as a hit or a miss.
+	 */
+	bool contains (PBD::ID const& source, uint32_t generation, uint64_t block) const;
+
+	/** forget all blocks of a source, of all generations */
+	void drop (PBD::ID const& source);
+	void clear ();
+
+	Stats stats () const;
+	void reset_stats ();
+
+private:
+	struct Key {
+		Key (PBD::ID const& s, uint32_t g, uint64_t b) : source (s), generation (g), block (b) {}
+
+		bool operator< (Key const& other) const {
+			if (source != other.source) {
+				return source < other.source;
+			}
+			if (generation != other.generation) {
+				return generation < other.generation;
+			}
+			return block < other.block;
+		}
+
+		PBD::ID  source;
+		uint32_t generation;
+		uint64_t block;
+	};
+
+	typedef std::list<Key> LRU;
+
+	struct Entry {
+		boost::shared_ptr<Block const> block;
+		LRU::iterator                  lru;
+	};
+
+	typedef std::map<Key, Entry> Blocks;
+
+	void evict_locked (size_t budget);
+	size_t budget () const;
+
+	mutable Glib::Threads::Mutex _lock;
+	Blocks _blocks;
+	LRU    _lru; ///< most recently used first
+	Stats  _stats;
+};
+
+} // namespace ARDOUR
+
+#endif /* __ardour_audio_block_cache_h__ */
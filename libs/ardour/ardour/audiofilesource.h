@@ -64,6 +64,7 @@ public:
 
 	int setup_peakfile ();
 	void set_gain (float g, bool temporarily = false);
+	void replace_file (const std::string&);
 
 	XMLNode& get_state ();
 	int set_state (const XMLNode&, int version);
@@ -22,6 +22,7 @@
 
 #include <vector>
 #include <list>
+#include <map>
 
 #include "ardour/ardour.h"
 #include "ardour/playlist.h"
@@ -43,9 +44,33 @@ public:
 
 	samplecnt_t read (Sample *dst, Sample *mixdown, float *gain_buffer, samplepos_t start, samplecnt_t cnt, uint32_t chan_n=0);
 
+	/** A part of a region that is audible (completely, or through the
+	 *  fades of regions above it) over [from, to] in session samples.
+	 */
+	struct RenderSegment {
+		RenderSegment () : from (0), to (0) {}
+		RenderSegment (boost::shared_ptr<AudioRegion> r, samplepos_t f, samplepos_t t) : region (r), from (f), to (t) {}
+
+		boost::shared_ptr<AudioRegion> region;
+		samplepos_t from;
+		samplepos_t to;
+	};
+
+	typedef std::vector<RenderSegment> RenderSegments;
+
+	/** Replace the contents of @a segments with the parts of regions that
+	 *  read() would use for [start, start + cnt), bottom layer first.
+	 *  Hidden parts of regions are left out.
+	 */
+	void audible_segments (samplepos_t start, samplecnt_t cnt, RenderSegments& segments);
+
 	bool destroy_region (boost::shared_ptr<Region>);
 
+	/** @return number of spans in the render plan, building it if needed */
+	size_t render_plan_size ();
+
 protected:
+	void regions_invalidated ();
 
 	void pre_combine (std::vector<boost::shared_ptr<Region> >&);
 	void post_combine (std::vector<boost::shared_ptr<Region> >&, boost::shared_ptr<Region>);
@@ -57,6 +82,41 @@ private:
 	bool region_changed (const PBD::PropertyChange&, boost::shared_ptr<Region>);
 	void source_offset_changed (boost::shared_ptr<AudioRegion>);
         void load_legacy_crossfades (const XMLNode&, int version);
+
+	/** The regions audible over all of [start, to], bottom layer first */
+	struct RenderSpan {
+		RenderSpan () : to (0) {}
+
+		samplepos_t to;
+		std::vector<boost::shared_ptr<AudioRegion> > regions;
+	};
+
+	/** Disjoint spans of the timeline, by start */
+	typedef std::map<samplepos_t, RenderSpan> RenderPlan;
+
+	/* The render plan is the layer-resolved, flattened playlist, so that
+	 * read() only has to look up the spans in the requested range. Region
+	 * changes invalidate the range they affect (where the region was
+	 * when the plan was made, and where it is now); the next read splices
+	 * just those ranges into the plan again.
+	 */
+	void invalidate_render_plan (boost::shared_ptr<Region> const&);
+	void update_render_plan ();
+	void flatten (RegionList const&, samplepos_t from, samplepos_t to, RenderSegments&) const;
+	void add_render_spans (RenderSegments&);
+	void find_render_segments (samplepos_t start, samplepos_t end, RenderSegments&);
+	void split_render_span (samplepos_t);
+
+	typedef std::map<Region const*, Evoral::Range<samplepos_t> > PlannedExtents;
+
+	Glib::Threads::Mutex                     _render_plan_lock;
+	RenderPlan                               _render_plan;
+	bool                                     _render_plan_valid;
+	std::vector<Evoral::Range<samplepos_t> > _render_plan_dirty;
+	PlannedExtents                           _planned_extents;
+
+	/* per-thread list of segments to read */
+	static Glib::Threads::Private<RenderSegments> _render_scratch;
 };
 
 } /* namespace ARDOUR */
@@ -21,6 +21,7 @@
 #define __ardour_audio_source_h__
 
 #include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
 #include <boost/shared_array.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
@@ -38,6 +39,8 @@
 
 namespace ARDOUR {
 
+class AudioBlockCache;
+
 class LIBARDOUR_API AudioSource : virtual public Source,
 		public ARDOUR::Readable,
 		public boost::enable_shared_from_this<ARDOUR::AudioSource>
@@ -61,6 +64,19 @@ class LIBARDOUR_API AudioSource : virtual public Source,
 
 	virtual float sample_rate () const = 0;
 
+	/** Find the bytes of the file that [start, start + cnt) is stored in,
+	 *  for read-ahead hints (see ReadaheadQueue).
+	 *  @return false if that is not known, e.g. for compressed files
+	 */
+	virtual bool file_byte_range (samplepos_t /*start*/, samplecnt_t /*cnt*/, std::string& /*path*/, off_t& /*offset*/, size_t& /*length*/) const {
+		return false;
+	}
+
+	/** @return true if read() will get the samples at @a pos from the
+	 *  AudioBlockCache, without touching the file.
+	 */
+	bool block_cached (samplepos_t pos) const;
+
 	virtual void mark_streaming_write_completed (const Lock& lock);
 
 	virtual bool can_truncate_peaks() const { return true; }
@@ -137,6 +153,18 @@ class LIBARDOUR_API AudioSource : virtual public Source,
 
 	virtual samplecnt_t read_unlocked (Sample *dst, samplepos_t start, samplecnt_t cnt) const = 0;
 	virtual samplecnt_t write_unlocked (Sample *dst, samplecnt_t cnt) = 0;
+
+	/** @return true if read() may keep and reuse decoded data in the
+	 *  AudioBlockCache, i.e. the data can not change and is not cheap
+	 *  to get.
+	 */
+	virtual bool use_block_cache () const { return false; }
+	samplecnt_t read_cached (AudioBlockCache&, Sample *dst, samplepos_t start, samplecnt_t cnt) const;
+
+	/** Call after anything that changes the samples read_unlocked()
+	 *  returns (gain, file), so that no cached block is used again.
+	 */
+	void invalidate_block_cache ();
 	virtual std::string construct_peak_filepath (const std::string& audio_path, const bool in_session = false, const bool old_peak_name = false) const = 0;
 
 	virtual int read_peaks_with_fpp (PeakData *peaks,
@@ -148,6 +176,10 @@ class LIBARDOUR_API AudioSource : virtual public Source,
 				     samplecnt_t samples_per_peak);
 
   private:
+	gint _block_cache_generation; ///< atomic
+	/** the session's cache, which sources may outlive */
+	boost::weak_ptr<AudioBlockCache> _block_cache;
+
 	bool _peaks_built;
 	/** This mutex is used to protect both the _peaks_built
 	 *  variable and also the emission (and handling) of the
@@ -0,0 +1,90 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef __ardour_background_sync_h__
+#define __ardour_background_sync_h__
+
+#include <deque>
+
+#include <sys/types.h>
+
+#include <glibmm/threads.h>
+
+#include "ardour/libardour_visibility.h"
+
+namespace ARDOUR {
+
+/** A thread that waits for written data to reach the disk, so that
+ *  the butler never has to.
+ *
+ *  Capture files are synced here once a take is complete, and (if
+ *  the page cache is to be bypassed) each block that was written is
+ *  dropped from the cache as soon as it is on disk.
+ *
+ *  File descriptors are dup()ed when they are queued, so the caller
+ *  may close its own at any time.
+ *
+ *  Each Session owns one, and stops it when it is closed.
+ */
+class LIBARDOUR_API BackgroundSync
+{
+public:
+	BackgroundSync ();
+	~BackgroundSync ();
+
+	/** Make @a length bytes at @a offset of @a fd durable.
+	 *  @param length 0 for the whole file
+	 *  @param drop_cache remove the range from the page cache once it is synced
+	 */
+	void queue (int fd, off_t offset, off_t length, bool drop_cache);
+
+	/** Wait until everything queued so far is on disk */
+	void wait ();
+
+	/** Finish what is queued, and end the thread. Later requests are
+	 *  carried out by the caller.
+	 */
+	void stop ();
+
+private:
+
+	struct Request {
+		Request (int f, off_t o, off_t l, bool d) : fd (f), offset (o), length (l), drop_cache (d) {}
+
+		int   fd;
+		off_t offset;
+		off_t length;
+		bool  drop_cache;
+	};
+
+	Glib::Threads::Mutex _lock;
+	Glib::Threads::Cond  _requests_available;
+	Glib::Threads::Cond  _done;
+	std::deque<Request>  _requests;
+	bool                 _busy;
+	bool                 _quit;
+	Glib::Threads::Thread* _thread;
+
+	void thread ();
+	static void sync (Request const&);
+};
+
+} // namespace ARDOUR
+
+#endif /* __ardour_background_sync_h__ */
@@ -35,6 +35,8 @@ class TempoMap;
 /** Converter between quarter-note beats and samples.  Takes distances in quarter-note beats or samples
  *  from some origin (supplied to the constructor in samples), and converts
  *  them to the opposite unit, taking tempo changes into account.
+ *  Uses the lock-free (_rt) tempo map lookups, so it may be used in the
+ *  process thread.
  */
 class LIBARDOUR_API BeatsSamplesConverter
 	: public Evoral::TimeConverter<Temporal::Beats,samplepos_t> {
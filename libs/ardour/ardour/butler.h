@@ -20,11 +20,15 @@
 #ifndef __ardour_butler_h__
 #define __ardour_butler_h__
 
+#include <map>
+#include <vector>
+
 #include <pthread.h>
 
 #include <glibmm/threads.h>
 
 #include "pbd/crossthread.h"
+#include "pbd/id.h"
 #include "pbd/ringbuffer.h"
 #include "pbd/pool.h"
 #include "ardour/libardour_visibility.h"
@@ -35,6 +39,10 @@
 
 namespace ARDOUR {
 
+class IOTaskList;
+class ReadaheadQueue;
+class Track;
+
 /**
  *  One of the Butler's functions is to clean up (ie delete) unused CrossThreadPools.
  *  When a thread with a CrossThreadPool terminates, its CTP is added to pool_trash.
@@ -65,6 +73,26 @@ class LIBARDOUR_API Butler : public SessionHandleRef
 
 	bool flush_tracks_to_disk_after_locate (boost::shared_ptr<RouteList>, uint32_t& errors);
 
+	/** Worker pool used to run per-track disk I/O in parallel.
+	 *  Only to be used from the butler thread.
+	 */
+	IOTaskList* io_tasks () const { return _io_tasks; }
+
+	/** Refill timing of all tracks that read from one device */
+	struct DeviceStats {
+		DeviceStats () : tracks (0), refill_us (0), bytes_per_sec (0) {}
+
+		uint32_t tracks;
+		double   refill_us;     ///< sum of the average refill time of these tracks
+		double   bytes_per_sec; ///< sum of their average read throughput
+	};
+
+	/** keyed by DiskReader::io_device() */
+	typedef std::map<uint64_t, DeviceStats> DeviceStatsMap;
+
+	/** as of the last adaptive buffering update, see RCConfiguration::adaptive_buffering */
+	DeviceStatsMap device_stats () const;
+
 	static void* _thread_work(void *arg);
 	void*         thread_work();
 
@@ -92,6 +120,34 @@ private:
 	void config_changed (std::string);
 
 	bool flush_tracks_to_disk_normal (boost::shared_ptr<RouteList>, uint32_t& errors);
+	bool flush_tracks_to_disk (boost::shared_ptr<RouteList>, uint32_t& errors, bool after_locate);
+
+	struct RefillJob {
+		RefillJob (boost::shared_ptr<Track> t, samplecnt_t u) : track (t), urgency (u) {}
+
+		boost::shared_ptr<Track> track;
+		samplecnt_t              urgency; ///< samples until underrun, lower is more urgent
+
+		struct MoreUrgent {
+			bool operator() (RefillJob const& a, RefillJob const& b) const {
+				return a.urgency < b.urgency;
+			}
+		};
+	};
+
+	/** refill passes skipped in a row, per track */
+	typedef std::map<PBD::ID, uint32_t> RefillAge;
+	RefillAge _refill_age;
+
+	static const int   refill_skipped = 2;
+
+	void refill_track (boost::shared_ptr<Track>, int* result);
+	void flush_track (boost::shared_ptr<Track>, bool after_locate, int* result);
+
+	bool update_locate_prefetch (boost::shared_ptr<RouteList>);
+	void update_adaptive_buffering (boost::shared_ptr<RouteList>);
+	void locate_prefetch_points (std::vector<samplepos_t>&) const;
+	void prefetch_track (boost::shared_ptr<Track>, std::vector<samplepos_t> const*, int* more);
 
 	/**
 	 * Add request to butler thread request queue
@@ -99,6 +155,13 @@ private:
 	void queue_request (Request::Type r);
 
 	CrossThreadChannel _xthread;
+	IOTaskList*        _io_tasks;
+	ReadaheadQueue*    _readahead;
+
+	gint64                       _last_buffering_update;
+	gint64                       _last_buffering_adjustment;
+	DeviceStatsMap               _device_stats;
+	mutable Glib::Threads::Mutex _device_stats_lock;
 
 };
 
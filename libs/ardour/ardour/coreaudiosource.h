@@ -56,6 +56,7 @@ class LIBARDOUR_API CoreAudioSource : public AudioFileSource {
   protected:
 	void close ();
 	samplecnt_t read_unlocked (Sample *dst, samplepos_t start, samplecnt_t cnt) const;
+	bool use_block_cache () const { return true; }
 	samplecnt_t write_unlocked (Sample *, samplecnt_t) { return 0; }
 
   private:
@@ -20,6 +20,12 @@
 #ifndef __ardour_disk_reader_h__
 #define __ardour_disk_reader_h__
 
+#include <map>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <glibmm/threads.h>
+
 #include "pbd/i18n.h"
 
 #include "ardour/disk_io.h"
@@ -31,6 +37,7 @@ namespace ARDOUR
 class Playlist;
 class AudioPlaylist;
 class MidiPlaylist;
+class ReadaheadQueue;
 template<typename T> class MidiRingBuffer;
 
 class LIBARDOUR_API DiskReader : public DiskIOProcessor
@@ -57,16 +64,34 @@ public:
 	PBD::Signal0<void>            AlignmentStyleChanged;
 
 	float buffer_load() const;
+	/** @return samples of audio left in the playback buffer, i.e. how long
+	 *  until it runs dry at normal speed; max_samplecnt without audio.
+	 */
+	samplecnt_t samples_until_underrun () const;
 
 	void move_processor_automation (boost::weak_ptr<Processor>, std::list<Evoral::RangeMove<samplepos_t> > const &);
 
-	/* called by the Butler in a non-realtime context */
+	/* called by the Butler (or one of its I/O threads) in a non-realtime context */
 
-	int do_refill () {
-		return refill (_mixdown_buffer, _gain_buffer, 0);
-	}
+	int do_refill ();
+
+	/** @return true if the playback buffer has no room for another refill */
+	bool refill_satisfied () const;
+
+	/** Keep the first RCConfiguration::locate_prefetch_seconds of audio
+	 *  after each of @a points in memory, so that a locate to one of them
+	 *  can refill without waiting for the disk. Reads at most one refill
+	 *  chunk per call; called by the Butler when all refills are done.
+	 *
+	 *  @return true if there is more to do
+	 */
+	bool update_locate_prefetch (std::vector<samplepos_t> const& points);
+
+	/** Add the file ranges that the next refill will read to @a queue */
+	void collect_readahead (ReadaheadQueue& queue);
 
-	/** For non-butler contexts (allocates temporary working buffers)
+	/** For non-butler contexts (allocates temporary working buffers,
+	 *  unless the calling thread has its own, see allocate_working_buffers())
 	 *
 	 * This accessible method has a default argument; derived classes
 	 * must inherit the virtual method that we call which does NOT
@@ -78,10 +103,17 @@ public:
 
 	bool pending_overwrite () const { return _pending_overwrite; }
 
-	// Working buffers for do_refill (butler thread)
-	static void allocate_working_buffers();
+	/** Working buffers for do_refill, owned by the calling thread
+	 *  (the butler and its I/O threads), of @a size samples each. Refills
+	 *  read from the playlist in pieces that fit them. They are released
+	 *  when the thread exits, or by free_working_buffers().
+	 */
+	static void allocate_working_buffers (samplecnt_t size = max_refill_samples);
 	static void free_working_buffers();
 
+	/** Largest refill read: 4MB of 16 bit samples */
+	static const samplecnt_t max_refill_samples = 2 * 1048576;
+
 	void adjust_buffering ();
 
 	int can_internal_playback_seek (samplecnt_t distance);
@@ -90,6 +122,46 @@ public:
 
 	static PBD::Signal0<void> Underrun;
 
+	/** Number of times the playback buffer ran dry since the last reset */
+	uint32_t underruns () const { return g_atomic_int_get (&_underruns); }
+	/** Number of times the playback buffer load dropped below
+	 *  near_underrun_threshold since the last reset
+	 */
+	uint32_t near_underruns () const { return g_atomic_int_get (&_near_underruns); }
+	void reset_underrun_counters ();
+
+	static const float near_underrun_threshold;
+
+	/** Timing of refills, measured by refill_audio() */
+	struct RefillStats {
+		RefillStats () : refills (0), avg_us (0), max_us (0), bytes_per_sec (0) {}
+
+		uint64_t refills;
+		double   avg_us;        ///< moving average of the time taken by one refill
+		double   max_us;        ///< slowest refill, decays over time
+		double   bytes_per_sec; ///< moving average of the read throughput
+	};
+
+	RefillStats refill_stats () const;
+	double avg_refill_us () const { return refill_stats ().avg_us; }
+	double max_refill_us () const { return refill_stats ().max_us; }
+	double refill_bytes_per_sec () const { return refill_stats ().bytes_per_sec; }
+
+	/** current size of each channel's playback buffer, in samples */
+	samplecnt_t buffer_size () const;
+	uint32_t n_buffers () const { return channels.reader()->size (); }
+	/** least space worth a refill; also the smallest read size */
+	samplecnt_t refill_chunk_samples () const { return _refill_chunk ? _refill_chunk : _chunk_samples; }
+
+	/** Playback buffer size to use from the next adjust_buffering() on,
+	 *  if RCConfiguration::adaptive_buffering is enabled (0: the session default).
+	 *  Set by the Butler.
+	 */
+	void set_target_buffer_size (samplecnt_t s) { _target_buffer_size = s; }
+	samplecnt_t target_buffer_size () const { return _target_buffer_size; }
+
+	uint64_t io_device ();
+
 	void playlist_modified ();
 	void reset_tracker ();
 
@@ -122,6 +194,81 @@ private:
 	samplepos_t   file_sample[DataType::num_types];
 
 	int _do_refill_with_alloc (bool partial_fill);
+	int refill_with_alloc (samplecnt_t fill_level);
+
+	mutable gint  _underruns;
+	mutable gint  _near_underruns;
+	bool          _near_underrun; ///< RT thread only, re-armed once the load recovers
+
+	/** The loop range of the audio playlist, kept in memory while
+	 *  looping (see RCConfiguration::loop_in_ram). It is filled by
+	 *  audio_read() as the loop plays, starting from the loop start,
+	 *  and serves all later reads inside the loop once complete.
+	 *
+	 *  Only used from the refill context; other threads merely flag
+	 *  it invalid via _loop_cache_invalid.
+	 */
+	struct LoopCache {
+		LoopCache () : start (0), end (0), n_channels (0), kb (0) {}
+
+		void clear ();
+
+		samplepos_t start;
+		samplepos_t end;
+		uint32_t    n_channels; ///< channels that the reservation covers
+		gint        kb;         ///< reserved with Session::reserve_loop_cache()
+		std::vector<std::vector<Sample> > data;   ///< per channel
+		std::vector<samplecnt_t>          filled; ///< per channel, valid samples from start
+	};
+
+	LoopCache     _loop_cache;
+	mutable gint  _loop_cache_invalid;
+
+	void update_loop_cache (samplepos_t loop_start, samplepos_t loop_end);
+	void drop_loop_cache ();
+	bool loop_cache_read (Sample* buf, samplepos_t start, samplecnt_t cnt, int channel) const;
+	void loop_cache_store (Sample const* buf, samplepos_t start, samplecnt_t cnt, int channel);
+
+	/** Audio after a locate point, per channel */
+	struct LocatePrefetch {
+		samplecnt_t                       length;
+		std::vector<std::vector<Sample> > data;
+	};
+
+	typedef std::map<samplepos_t, boost::shared_ptr<LocatePrefetch const> > LocatePrefetches;
+
+	RefillStats                  _refill_stats;
+	mutable Glib::Threads::Mutex _refill_stats_lock;
+	samplecnt_t                  _target_buffer_size;
+	samplecnt_t                  _refill_chunk; ///< 0: use _chunk_samples
+	uint64_t                     _io_device;
+	mutable gint                 _io_device_invalid;
+
+	void update_refill_stats (int64_t elapsed_us, size_t bytes);
+	void collect_readahead (ReadaheadQueue&, boost::shared_ptr<AudioPlaylist>, samplepos_t start, samplecnt_t cnt);
+
+	/** written by update_locate_prefetch(), read without a lock by
+	 *  seek() and audio_read()
+	 */
+	SerializedRCUManager<LocatePrefetches> _locate_prefetch;
+	mutable gint                           _locate_prefetch_invalid;
+
+	/** the prefetch being read, one chunk per update_locate_prefetch() */
+	boost::shared_ptr<LocatePrefetch> _locate_prefetch_pending;
+	samplepos_t                       _locate_prefetch_pending_point;
+	samplecnt_t                       _locate_prefetch_pending_done;
+
+	/** when we last located to each position, to decide which
+	 *  prefetches to keep when the session's budget is used up
+	 */
+	std::map<samplepos_t, gint64> _locate_history;
+	Glib::Threads::Mutex          _locate_history_lock;
+
+	void drop_locate_prefetch (LocatePrefetches&, LocatePrefetches::iterator);
+	void drop_locate_prefetch ();
+	void drop_pending_locate_prefetch ();
+	samplecnt_t locate_prefetch_available (samplepos_t) const;
+	bool locate_prefetch_read (Sample* buf, samplepos_t start, samplecnt_t cnt, int channel) const;
 
 	static samplecnt_t _chunk_samples;
 	static samplecnt_t midi_readahead;
@@ -132,11 +279,12 @@ private:
 	                int channel, bool reversed);
 	int midi_read (samplepos_t& start, samplecnt_t cnt, bool reversed);
 
-	static Sample* _mixdown_buffer;
-	static gain_t* _gain_buffer;
+	int audio_read_in_pieces (Sample* buf, Sample* mixdown_buffer, float* gain_buffer, samplecnt_t mixdown_size,
+	                          samplepos_t& start, samplecnt_t cnt,
+	                          int channel, bool reversed);
 
-	int refill (Sample* mixdown_buffer, float* gain_buffer, samplecnt_t fill_level);
-	int refill_audio (Sample *mixdown_buffer, float *gain_buffer, samplecnt_t fill_level);
+	int refill (Sample* mixdown_buffer, float* gain_buffer, samplecnt_t mixdown_size, samplecnt_t fill_level);
+	int refill_audio (Sample *mixdown_buffer, float *gain_buffer, samplecnt_t mixdown_size, samplecnt_t fill_level);
 	int refill_midi ();
 
 	sampleoffset_t calculate_playback_distance (pframes_t);
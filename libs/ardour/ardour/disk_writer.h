@@ -105,6 +105,21 @@ public:
 
 	float buffer_load() const;
 
+	/** Timing of the writes of captured audio, measured by do_flush() */
+	struct WriteStats {
+		WriteStats () : writes (0), avg_us (0), max_us (0), bytes_per_sec (0) {}
+
+		uint64_t writes;
+		double   avg_us;        ///< moving average of the time taken by one flush
+		double   max_us;        ///< slowest flush, decays over time
+		double   bytes_per_sec; ///< moving average of the write throughput
+	};
+
+	WriteStats write_stats () const;
+	double avg_write_us () const { return write_stats ().avg_us; }
+	double max_write_us () const { return write_stats ().max_us; }
+	double write_bytes_per_sec () const { return write_stats ().bytes_per_sec; }
+
 	virtual void request_input_monitoring (bool) {}
 	virtual void ensure_input_monitoring (bool) {}
 
@@ -189,6 +204,11 @@ private:
 	MidiBuffer                   _gui_feed_buffer;
 	mutable Glib::Threads::Mutex _gui_feed_buffer_mutex;
 
+	WriteStats                   _write_stats;
+	mutable Glib::Threads::Mutex _write_stats_lock;
+
+	void update_write_stats (int64_t elapsed_us, size_t bytes);
+
 	void check_record_status (samplepos_t transport_sample, double speed, bool can_record);
 	void finish_capture (boost::shared_ptr<ChannelList> c);
 };
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifndef ARDOUR_DSP_STATS_H
+#define ARDOUR_DSP_STATS_H
+
+#include <stdint.h>
+#include <cstring>
+
+#include <glib.h>
+
+#include "ardour/libardour_visibility.h"
+
+namespace ARDOUR {
+
+/** Execution time statistics of a single processing node (e.g. a Route).
+ *
+ * update() is called by exactly one thread at a time, once per cycle,
+ * from the process thread(s). It never blocks nor allocates.
+ *
+ * Any other thread can take a consistent snapshot(); reads are guarded
+ * by a sequence counter and retried if they overlap an update.
+ * Resetting is requested by the reader and performed by the next update(),
+ * so that the statistics only ever have a single writer.
+ */
+class LIBARDOUR_API DSPStats
+{
+public:
+	/** Number of histogram bins. Bin 0 counts durations < 2us,
+	 * bin N counts [2^N, 2^(N+1)) us, the last bin counts everything above.
+	 */
+	static const uint32_t n_bins = 16;
+
+	struct Snapshot {
+		Snapshot () { memset (this, 0, sizeof (Snapshot)); }
+
+		uint64_t count; ///< number of cycles since the last reset
+		int64_t  last;  ///< most recent execution time, in usec
+		int64_t  min;   ///< in usec
+		int64_t  max;   ///< in usec
+		double   avg;   ///< exponential moving average, in usec
+		uint64_t histogram[n_bins];
+
+		uint64_t bin (uint32_t n) const { return n < n_bins ? histogram[n] : 0; }
+	};
+
+	DSPStats ()
+		: _seq (0)
+		, _reset_request (0)
+	{}
+
+	/** Process thread: add one measurement */
+	void update (int64_t elapsed_us)
+	{
+		if (elapsed_us < 0) {
+			/* timer glitch, see DSPLoadCalculator */
+			return;
+		}
+
+		g_atomic_int_inc (&_seq);
+
+		if (g_atomic_int_get (&_reset_request)) {
+			_s = Snapshot ();
+			g_atomic_int_set (&_reset_request, 0);
+		}
+
+		if (_s.count == 0) {
+			_s.min = _s.max = elapsed_us;
+			_s.avg = elapsed_us;
+		} else {
+			if (elapsed_us < _s.min) { _s.min = elapsed_us; }
+			if (elapsed_us > _s.max) { _s.max = elapsed_us; }
+			_s.avg += .05 * (elapsed_us - _s.avg);
+		}
+
+		_s.last = elapsed_us;
+		++_s.count;
+		++_s.histogram[bin_for (elapsed_us)];
+
+		g_atomic_int_inc (&_seq);
+	}
+
+	/** Any thread: copy the current statistics.
+	 * @return false if no consistent copy could be made (heavy update traffic)
+	 */
+	bool snapshot (Snapshot& s) const
+	{
+		for (int tries = 0; tries < 64; ++tries) {
+			gint const seq = g_atomic_int_get (&_seq);
+			if (seq & 1) {
+				continue;
+			}
+			s = _s;
+			if (g_atomic_int_get (&_seq) == seq) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/** Moving average without a snapshot, in usec. Only valid in the
+	 * writer's context, or while no update() can be in progress.
+	 */
+	double rt_avg () const { return _s.avg; }
+
+	/** Any thread: request that the statistics be cleared */
+	void reset ()
+	{
+		g_atomic_int_set (&_reset_request, 1);
+	}
+
+	static uint32_t bin_for (int64_t elapsed_us)
+	{
+		uint32_t b = 0;
+		while (elapsed_us > 1 && b < n_bins - 1) {
+			elapsed_us >>= 1;
+			++b;
+		}
+		return b;
+	}
+
+private:
+	mutable volatile gint _seq;
+	mutable volatile gint _reset_request;
+	Snapshot _s;
+};
+
+} // namespace ARDOUR
+
+#endif // ARDOUR_DSP_STATS_H
@@ -83,7 +83,7 @@ public:
 	void set_origin (std::string const& o) { _origin = o; }
 
 	virtual void set_path (const std::string&);
-	void replace_file (const std::string&);
+	virtual void replace_file (const std::string&);
 
 	static PBD::Signal2<int,std::string,std::vector<std::string> > AmbiguousFileName;
 
@@ -29,12 +29,16 @@
 #include <boost/shared_ptr.hpp>
 
 #include <glib.h>
+#include <glibmm/threads.h>
 
+#include "pbd/mpmc_queue.h"
 #include "pbd/semutils.h"
+#include "pbd/work_stealing_deque.h"
 
 #include "ardour/libardour_visibility.h"
 #include "ardour/types.h"
 #include "ardour/audio_backend.h"
+#include "ardour/dsp_stats.h"
 #include "ardour/session_handle.h"
 
 namespace ARDOUR
@@ -77,6 +81,13 @@ public:
 
 	bool in_process_thread () const;
 
+	/** Duration of a graph cycle (usec) as predicted from the critical path
+	 *  and the measured cost of each route.
+	 */
+	DSPStats const& predicted_makespan () const { return _predicted_makespan; }
+	/** Measured duration of graph cycles (usec) */
+	DSPStats const& makespan () const { return _makespan; }
+
 protected:
 	virtual void session_going_away ();
 
@@ -87,8 +98,17 @@ private:
 	void drop_threads ();
 	void restart_cycle();
 	bool run_one();
+	bool run_one_locked ();
+	bool run_one_work_stealing ();
 	void main_thread();
 	void prep();
+	void rank_nodes (int chain);
+
+	void register_worker_thread ();
+	void inject (GraphNode*);
+	bool find_work (GraphNode*&);
+	bool claim_execution_token ();
+	void wake_idle_threads ();
 
 	node_list_t _nodes_rt[2];
 
@@ -112,6 +132,36 @@ private:
 
 	bool _graph_empty;
 
+	/* work-stealing scheduler (Config->get_graph_work_stealing()).
+	 *
+	 * Every process thread owns one deque: nodes that become ready
+	 * when a thread finishes a node are pushed onto that thread's
+	 * own deque, and idle threads steal from the others.
+	 * Initial triggers (and nodes triggered by threads without a deque)
+	 * go to the shared injection queue.
+	 */
+	typedef PBD::WorkStealingDeque<GraphNode*> WorkerQueue;
+
+	std::vector<WorkerQueue*>  _worker_queues;
+	PBD::MPMCQueue<GraphNode*> _inject_queue;
+	/** Number of nodes queued in _worker_queues and _inject_queue */
+	volatile gint              _ws_pending;
+	/** Number of nodes that did not fit into _inject_queue, and were
+	 *  queued in _trigger_queue instead
+	 */
+	volatile gint              _inject_overflow;
+	volatile gint              _worker_count;
+	/** Whether the current cycle uses the work-stealing scheduler */
+	volatile bool              _work_stealing;
+
+	static Glib::Threads::Private<WorkerQueue> _worker_queue;
+
+	/* critical path scheduling */
+	int            _rank_countdown;
+	microseconds_t _cycle_start;
+	DSPStats       _predicted_makespan;
+	DSPStats       _makespan;
+
 	// chain swapping
 	Glib::Threads::Mutex  _swap_mutex;
         Glib::Threads::Cond   _cleanup_cond;
@@ -45,11 +45,13 @@ class LIBARDOUR_API GraphNode
 	virtual ~GraphNode();
 
 	void prep( int chain );
-	void dec_ref();
+	bool dec_ref();
 	void finish( int chain );
 
 	virtual void process();
 
+	double priority () const { return _priority; }
+
     private:
 	friend class Graph;
 
@@ -61,6 +63,12 @@ class LIBARDOUR_API GraphNode
 	gint _refcount;
 	/** The number of nodes that we directly feed us (one count for each chain) */
 	gint _init_refcount[2];
+
+	/** Estimated time (usec) from the start of this node until the end of
+	 *  the longest chain of nodes that depend on it; nodes on the critical
+	 *  path are started first. Maintained by Graph::rank_nodes().
+	 */
+	double _priority;
 };
 
 }
@@ -0,0 +1,190 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef __ardour_interval_index_h__
+#define __ardour_interval_index_h__
+
+#include <algorithm>
+#include <vector>
+
+#include "ardour/types.h"
+
+namespace ARDOUR {
+
+/** A static index of closed intervals [first, last], each with a value
+ *  attached, for fast overlap queries.
+ *
+ *  The intervals are kept in an array sorted by start, which is used as
+ *  an implicit balanced binary tree (the root of [lo, hi) is the middle
+ *  element). Every node is augmented with the largest end point of its
+ *  subtree, so a query only descends into subtrees that can contain an
+ *  overlap: O(log N + K) for K results.
+ *
+ *  The index is built once with add() + build(); any change to the
+ *  intervals means clear() and building it again, which is O(N log N).
+ *  Results are returned in order of their start, intervals with the
+ *  same start in the order they were added.
+ */
+template<typename T>
+class /*LIBARDOUR_API*/ IntervalIndex
+{
+public:
+	struct Entry {
+		Entry (samplepos_t f, samplepos_t l, T const& v) : first (f), last (l), value (v) {}
+
+		samplepos_t first;
+		samplepos_t last;
+		T           value;
+	};
+
+	typedef std::vector<Entry> Entries;
+
+	IntervalIndex () : _built (true) {}
+
+	void clear () {
+		_entries.clear ();
+		_max_last.clear ();
+		_built = true;
+	}
+
+	void add (samplepos_t first, samplepos_t last, T const& value) {
+		_entries.push_back (Entry (first, last, value));
+		_built = false;
+	}
+
+	/** must be called after add()ing entries, and before any query */
+	void build () {
+		std::stable_sort (_entries.begin (), _entries.end (), EarlierStart ());
+		_max_last.resize (_entries.size ());
+		augment (0, _entries.size ());
+		_built = true;
+	}
+
+	bool   built () const { return _built; }
+	bool   empty () const { return _entries.empty (); }
+	size_t size () const { return _entries.size (); }
+
+	/** all entries, sorted by start */
+	Entries const& entries () const { return _entries; }
+
+	/** Append the values of all intervals that overlap [from, to] to @a out */
+	template<typename Container>
+	void overlapping (samplepos_t from, samplepos_t to, Container& out) const {
+		query (0, _entries.size (), from, to, out);
+	}
+
+	/** Append the values of all intervals that contain @a pos to @a out */
+	template<typename Container>
+	void covering (samplepos_t pos, Container& out) const {
+		query (0, _entries.size (), pos, pos, out);
+	}
+
+	/** @return number of intervals that contain @a pos */
+	size_t count_covering (samplepos_t pos) const {
+		return count (0, _entries.size (), pos);
+	}
+
+	/** @return index of the first entry that starts after @a pos, or size() */
+	size_t first_starting_after (samplepos_t pos) const {
+		return std::upper_bound (_entries.begin (), _entries.end (), pos, StartsAfter ()) - _entries.begin ();
+	}
+
+	/** @return index of the first entry that starts at or after @a pos, or size() */
+	size_t first_starting_at_or_after (samplepos_t pos) const {
+		return std::lower_bound (_entries.begin (), _entries.end (), pos, StartsBefore ()) - _entries.begin ();
+	}
+
+private:
+	struct EarlierStart {
+		bool operator() (Entry const& a, Entry const& b) const { return a.first < b.first; }
+	};
+
+	struct StartsAfter {
+		bool operator() (samplepos_t pos, Entry const& e) const { return pos < e.first; }
+	};
+
+	struct StartsBefore {
+		bool operator() (Entry const& e, samplepos_t pos) const { return e.first < pos; }
+	};
+
+	samplepos_t augment (size_t lo, size_t hi) {
+		if (lo >= hi) {
+			return 0;
+		}
+		size_t const mid = lo + (hi - lo) / 2;
+		samplepos_t m = _entries[mid].last;
+		if (lo < mid) {
+			m = std::max (m, augment (lo, mid));
+		}
+		if (mid + 1 < hi) {
+			m = std::max (m, augment (mid + 1, hi));
+		}
+		_max_last[mid] = m;
+		return m;
+	}
+
+	template<typename Container>
+	void query (size_t lo, size_t hi, samplepos_t from, samplepos_t to, Container& out) const {
+		if (lo >= hi) {
+			return;
+		}
+		size_t const mid = lo + (hi - lo) / 2;
+		if (_max_last[mid] < from) {
+			/* nothing in this subtree reaches far enough */
+			return;
+		}
+		query (lo, mid, from, to, out);
+		Entry const& e (_entries[mid]);
+		if (e.first > to) {
+			/* neither this nor anything to the right starts early enough */
+			return;
+		}
+		if (e.last >= from) {
+			out.push_back (e.value);
+		}
+		query (mid + 1, hi, from, to, out);
+	}
+
+	size_t count (size_t lo, size_t hi, samplepos_t pos) const {
+		if (lo >= hi) {
+			return 0;
+		}
+		size_t const mid = lo + (hi - lo) / 2;
+		if (_max_last[mid] < pos) {
+			return 0;
+		}
+		size_t n = count (lo, mid, pos);
+		Entry const& e (_entries[mid]);
+		if (e.first > pos) {
+			return n;
+		}
+		if (e.last >= pos) {
+			++n;
+		}
+		return n + count (mid + 1, hi, pos);
+	}
+
+	Entries                  _entries;
+	std::vector<samplepos_t> _max_last;
+	bool                     _built;
+};
+
+} // namespace ARDOUR
+
+#endif /* __ardour_interval_index_h__ */
@@ -0,0 +1,74 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef __ardour_io_tasklist_h__
+#define __ardour_io_tasklist_h__
+
+#include <vector>
+
+#include <pthread.h>
+
+#include <boost/function.hpp>
+#include <glib.h>
+
+#include "pbd/semutils.h"
+
+#include "ardour/libardour_visibility.h"
+
+namespace ARDOUR {
+
+/** A pool of worker threads used by the Butler to run per-track disk I/O
+ *  (refill, flush, locate) concurrently.
+ *
+ *  Tasks are queued with push_back() and executed by process(), which
+ *  returns once all of them are done. The calling thread takes part in
+ *  the work, so a pool with N threads runs N+1 tasks at a time.
+ *
+ *  Only one thread (the butler) may use a given IOTaskList.
+ */
+class LIBARDOUR_API IOTaskList
+{
+public:
+	IOTaskList (uint32_t n_workers);
+	~IOTaskList ();
+
+	/** number of worker threads, excluding the caller of process() */
+	uint32_t n_workers () const { return _workers.size (); }
+
+	void push_back (boost::function<void ()> fn);
+	void process ();
+
+private:
+	static void* _worker_thread (void*);
+	void worker_thread ();
+	void run_tasks ();
+
+	std::vector<boost::function<void ()> > _tasks;
+	std::vector<pthread_t>                 _workers;
+
+	volatile gint  _next_task;
+	volatile bool  _terminate;
+
+	PBD::Semaphore _exec_sem;
+	PBD::Semaphore _idle_sem;
+};
+
+} // namespace ARDOUR
+
+#endif /* __ardour_io_tasklist_h__ */
@@ -25,6 +25,7 @@
 #include <queue>
 #include <utility>
 
+#include <boost/scoped_ptr.hpp>
 #include <boost/utility.hpp>
 #include <glibmm/threads.h>
 
@@ -117,12 +118,15 @@ public:
 		void change (const NotePtr note, Property prop, const Variant& new_value);
 
 		bool adds_or_removes() const {
+			decode ();
 			return !_added_notes.empty() || !_removed_notes.empty();
 		}
 
 		NoteDiffCommand& operator+= (const NoteDiffCommand& other);
 
 		static Variant get_value (const NotePtr note, Property prop);
+		static void    set_value (const NotePtr note, Property prop, const Variant& value);
+		static bool    indexed (Property prop);
 
 		static Variant::Type value_type (Property prop);
 
@@ -137,9 +141,9 @@ public:
 		typedef std::list<NoteChange>                                    ChangeList;
 		typedef std::list< boost::shared_ptr< Evoral::Note<TimeType> > > NoteList;
 
-		const ChangeList& changes()       const { return _changes; }
-		const NoteList&   added_notes()   const { return _added_notes; }
-		const NoteList&   removed_notes() const { return _removed_notes; }
+		const ChangeList& changes()       const { decode (); return _changes; }
+		const NoteList&   added_notes()   const { decode (); return _added_notes; }
+		const NoteList&   removed_notes() const { decode (); return _removed_notes; }
 
 	private:
 		ChangeList _changes;
@@ -148,11 +152,29 @@ public:
 
 		std::set<NotePtr> side_effect_removals;
 
+		/** Binary payloads of a command restored from the undo history.
+		 *  They are only decoded once the command is used, and written
+		 *  back as they are if the history is saved before that.
+		 */
+		struct Encoded {
+			std::string changes;
+			std::string added_notes;
+			std::string removed_notes;
+			std::string side_effect_removals;
+		};
+
+		boost::scoped_ptr<Encoded> _encoded; ///< 0 once decoded
+
+		void decode () const;
+
 		XMLNode &marshal_change(const NoteChange&);
 		NoteChange unmarshal_change(XMLNode *xml_note);
 
 		XMLNode &marshal_note(const NotePtr note);
 		NotePtr unmarshal_note(XMLNode *xml_note);
+
+		std::string encode_changes () const;
+		void decode_changes (const std::string&);
 	};
 
 	/* Currently this class only supports changes of sys-ex time, but could be expanded */
@@ -188,6 +210,11 @@ public:
 
 		std::list<SysExPtr> _removed;
 
+		/** binary payload of _changes restored from the undo history, not yet decoded */
+		std::string _encoded_changes;
+
+		void decode ();
+
 		XMLNode & marshal_change (const Change &);
 		Change unmarshal_change (XMLNode *);
 	};
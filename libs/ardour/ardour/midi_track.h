@@ -42,7 +42,7 @@ public:
 	int init ();
 
 	void realtime_locate ();
-	void non_realtime_locate (samplepos_t);
+	void non_realtime_locate_processors (samplepos_t);
 
 	bool can_be_record_enabled ();
 	bool can_be_record_safe ();
@@ -31,6 +31,7 @@
 #include <sys/stat.h>
 
 #include <glib.h>
+#include <glibmm/threads.h>
 
 #include "pbd/undo.h"
 #include "pbd/stateful.h"
@@ -41,6 +42,7 @@
 #include "evoral/Range.hpp"
 
 #include "ardour/ardour.h"
+#include "ardour/interval_index.h"
 #include "ardour/region.h"
 #include "ardour/session_object.h"
 #include "ardour/data_type.h"
@@ -336,6 +338,17 @@ public:
 
 	boost::shared_ptr<RegionList> regions_touched_locked (samplepos_t start, samplepos_t end);
 
+	/** Must be called whenever regions are added, removed or moved
+	 *  without going through add_region_internal(), remove_region_internal()
+	 *  or a region property change.
+	 */
+	void invalidate_region_index ();
+
+	/** Called whenever regions were added, removed, reordered or
+	 *  relayered, for derived classes that cache derived state.
+	 */
+	virtual void regions_invalidated () {}
+
 	void notify_region_removed (boost::shared_ptr<Region>);
 	void notify_region_added (boost::shared_ptr<Region>);
 	void notify_layering_changed ();
@@ -413,6 +426,18 @@ public:
 	void coalesce_and_check_crossfades (std::list<Evoral::Range<samplepos_t> >);
 	boost::shared_ptr<RegionList> find_regions_at (samplepos_t);
 
+	/* overlap index of `regions', used for range and position
+	 * queries. It is rebuilt by the first query after a change.
+	 */
+	typedef IntervalIndex<boost::shared_ptr<Region> > RegionIndex;
+
+	RegionIndex const& region_index () const;
+	void drop_region_index ();
+
+	mutable Glib::Threads::Mutex _region_index_lock;
+	mutable RegionIndex          _region_index;
+	mutable bool                 _region_index_valid;
+
 	samplepos_t _end_space;  //this is used when we are pasting a range with extra space at the end
 };
 
@@ -359,6 +359,7 @@ private:
 	ChanMapping _thru_map; // out-idx <=  in-idx
 
 	void automate_and_run (BufferSet& bufs, samplepos_t start, samplepos_t end, double speed, pframes_t nframes);
+	void split_and_run (BufferSet& bufs, samplepos_t start, samplepos_t end, double speed, pframes_t nframes);
 	void connect_and_run (BufferSet& bufs, samplepos_t start, samplecnt_t end, double speed, pframes_t nframes, samplecnt_t offset, bool with_auto);
 	void bypass (BufferSet& bufs, pframes_t nframes);
 	void inplace_silence_unconnected (BufferSet&, const PinMappings&, samplecnt_t nframes, samplecnt_t offset) const;
@@ -381,6 +382,35 @@ private:
 	bool _latency_changed;
 	uint32_t _bypass_port;
 
+	/** The automation of a control in playback mode, rendered for the
+	 *  current cycle by render_automation().
+	 */
+	struct RenderedAutomation {
+		AutomationControl* control;
+		float*             values; ///< one per sample, 0 if the list was busy
+		bool               exact;  ///< any change of value starts a new sub-block
+		bool               logarithmic;
+		float              tolerance;
+		float              lower;  ///< values in [lower, upper] do not start a new sub-block
+		float              upper;
+	};
+
+	typedef std::vector<RenderedAutomation> RenderedAutomations;
+	RenderedAutomations  _rendered_automation;
+	std::vector<float>   _automation_buffers;
+	pframes_t            _automation_buffer_size;
+	Glib::Threads::Mutex _automation_buffer_lock;
+
+	/* DEBUG::Automation statistics */
+	uint64_t _automation_sub_blocks;
+	int64_t  _automation_sub_blocks_saved;
+
+	void allocate_automation_buffers (pframes_t);
+	void control_automation_state_changed ();
+	bool render_automation (samplepos_t start, samplepos_t end, pframes_t nframes);
+	void apply_rendered_automation (samplepos_t start, pframes_t offset);
+	pframes_t rendered_automation_block (pframes_t offset, pframes_t nframes, pframes_t min_block) const;
+
 	typedef std::map<uint32_t, boost::shared_ptr<ReadOnlyControl> >CtrlOutMap;
 	CtrlOutMap _control_outputs;
 
@@ -96,6 +96,21 @@ CONFIG_VARIABLE (BufferingPreset, buffering_preset, "buffering-preset", Medium)
 CONFIG_VARIABLE (float, audio_capture_buffer_seconds, "capture-buffer-seconds", 5.0)
 CONFIG_VARIABLE (float, audio_playback_buffer_seconds, "playback-buffer-seconds", 5.0)
 CONFIG_VARIABLE (float, midi_track_buffer_seconds, "midi-track-buffer-seconds", 1.0)
+CONFIG_VARIABLE (uint32_t, butler_threads, "butler-threads", 0) /* 0: automatic, 1: refill and flush tracks one at a time */
+CONFIG_VARIABLE (uint32_t, audio_block_cache_mb, "audio-block-cache-mb", 0) /* 0: disabled */
+CONFIG_VARIABLE (bool, loop_in_ram, "loop-in-ram", false)
+CONFIG_VARIABLE (uint32_t, loop_in_ram_max_mb, "loop-in-ram-max-mb", 512) /* per session, all tracks */
+CONFIG_VARIABLE (float, locate_prefetch_seconds, "locate-prefetch-seconds", 2.0) /* 0: disabled */
+CONFIG_VARIABLE (uint32_t, locate_prefetch_max_mb, "locate-prefetch-max-mb", 512) /* per session, all tracks */
+CONFIG_VARIABLE (bool, adaptive_buffering, "adaptive-buffering", false)
+CONFIG_VARIABLE (float, adaptive_buffering_max_seconds, "adaptive-buffering-max-seconds", 30.0) /* per track */
+CONFIG_VARIABLE (uint32_t, adaptive_buffering_max_mb, "adaptive-buffering-max-mb", 4096) /* all tracks */
+CONFIG_VARIABLE (bool, disk_readahead, "disk-readahead", true) /* Linux only */
+CONFIG_VARIABLE (bool, mmap_audio_files, "mmap-audio-files", false) /* local files only */
+CONFIG_VARIABLE (uint32_t, capture_write_block_kb, "capture-write-block-kb", 1024) /* per file, 0: write each chunk as it comes */
+CONFIG_VARIABLE (uint32_t, capture_preallocate_mb, "capture-preallocate-mb", 64) /* 0: no preallocation */
+CONFIG_VARIABLE (bool, capture_background_sync, "capture-background-sync", true)
+CONFIG_VARIABLE (bool, capture_bypass_page_cache, "capture-bypass-page-cache", false)
 CONFIG_VARIABLE (uint32_t, disk_choice_space_threshold,  "disk-choice-space-threshold", 57600000)
 CONFIG_VARIABLE (bool, auto_analyse_audio, "auto-analyse-audio", false)
 CONFIG_VARIABLE (float, transient_sensitivity, "transient-sensitivity", 50)
@@ -212,6 +227,7 @@ CONFIG_VARIABLE (bool, verify_remove_last_capture, "verify-remove-last-capture",
 CONFIG_VARIABLE (bool, save_history, "save-history", true)
 CONFIG_VARIABLE (int32_t, saved_history_depth, "save-history-depth", 20)
 CONFIG_VARIABLE (int32_t, history_depth, "history-depth", 20)
+CONFIG_VARIABLE (bool, binary_midi_history, "binary-midi-history", false) /* older versions skip such undo steps */
 CONFIG_VARIABLE (bool, use_overlap_equivalency, "use-overlap-equivalency", false)
 CONFIG_VARIABLE (bool, periodic_safety_backups, "periodic-safety-backups", true)
 CONFIG_VARIABLE (uint32_t, periodic_safety_backup_interval, "periodic-safety-backup-interval", 120)
@@ -225,6 +241,7 @@ CONFIG_VARIABLE_SPECIAL (std::string, default_session_parent_dir, "default-sessi
 #endif
 CONFIG_VARIABLE (bool, allow_special_bus_removal, "allow-special-bus-removal", false)
 CONFIG_VARIABLE (int32_t, processor_usage, "processor-usage", -1)
+CONFIG_VARIABLE (bool, graph_work_stealing, "graph-work-stealing", true)
 CONFIG_VARIABLE (gain_t, max_gain, "max-gain", 2.0) /* +6.0dB */
 CONFIG_VARIABLE (uint32_t, max_recent_sessions, "max-recent-sessions", 10)
 CONFIG_VARIABLE (uint32_t, max_recent_templates, "max-recent-templates", 10)
@@ -0,0 +1,129 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef __ardour_readahead_queue_h__
+#define __ardour_readahead_queue_h__
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "ardour/libardour_visibility.h"
+
+struct io_uring;
+
+namespace ARDOUR {
+
+/** Batches of read-ahead hints for the files that the next refill of all
+ *  tracks is going to read (see DiskReader::collect_readahead()).
+ *
+ *  The Butler adds the byte ranges of all tracks, and then submit()s them
+ *  at once, before the refills start. With io_uring, the whole batch goes
+ *  to the kernel in a single system call; otherwise it is one
+ *  posix_fadvise() per range. Either way, the kernel gets to queue, merge
+ *  and reorder the reads of hundreds of files, and the (synchronous)
+ *  reads of the refill that follows find the data in the page cache.
+ *
+ *  Hints need posix_fadvise(), so the Butler only uses this on Linux.
+ *  Only to be used from the butler thread.
+ */
+class LIBARDOUR_API ReadaheadQueue
+{
+public:
+	ReadaheadQueue ();
+	~ReadaheadQueue ();
+
+	/** Ask for @a length bytes at @a offset of the file at @a path to be read soon */
+	void add (std::string const& path, off_t offset, size_t length);
+
+	/** Pass all ranges added since the last call on to the kernel,
+	 *  without waiting for the data.
+	 */
+	void submit ();
+
+	/** Close all files kept open between batches */
+	void close_files ();
+
+	bool empty () const { return _ranges.empty (); }
+	bool using_io_uring () const;
+
+private:
+	struct Range {
+		Range (off_t o, size_t l) : offset (o), length (l) {}
+
+		off_t  offset;
+		size_t length;
+
+		bool operator< (Range const& other) const { return offset < other.offset; }
+	};
+
+	struct Request {
+		Request (int f, Range const& r) : fd (f), range (r) {}
+
+		int   fd;
+		Range range;
+	};
+
+	typedef std::vector<Request> Requests;
+
+	/* pending ranges, per file */
+	typedef std::map<std::string, std::vector<Range> > Ranges;
+	Ranges _ranges;
+
+	/* files are kept open between batches, up to max_open_files, and
+	 * for at most max_idle_batches that do not use them, so that files
+	 * that were removed or replaced are not held open for long.
+	 */
+	typedef std::list<std::string> FileLRU;
+
+	struct File {
+		int               fd;
+		dev_t             dev;
+		ino_t             ino;
+		uint64_t          batch; ///< the last one that used it
+		FileLRU::iterator lru;
+	};
+
+	typedef std::map<std::string, File> Files;
+
+	Files    _files;
+	FileLRU  _file_lru; ///< most recently used first
+	uint64_t _batch;
+
+	static const size_t   max_open_files = 256;
+	static const uint64_t max_idle_batches = 8;
+
+	int  file_descriptor (std::string const& path);
+	void close_file (Files::iterator);
+	void close_idle_files ();
+
+	static void coalesce (std::vector<Range>&);
+	static void advise (Requests const&);
+
+	struct io_uring* _ring; ///< 0 unless built with, and running on, io_uring support
+	bool submit_io_uring (Requests const&);
+};
+
+} // namespace ARDOUR
+
+#endif /* __ardour_readahead_queue_h__ */
@@ -52,6 +52,7 @@
 #include "ardour/stripable.h"
 #include "ardour/graphnode.h"
 #include "ardour/automatable.h"
+#include "ardour/dsp_stats.h"
 #include "ardour/unknown_processor.h"
 #include "ardour/soloable.h"
 #include "ardour/solo_control.h"
@@ -347,6 +348,21 @@ public:
 	samplecnt_t signal_latency() const { return _signal_latency; }
 	samplecnt_t playback_latency (bool incl_downstream = false) const;
 
+	/** Per-cycle execution time of this route, updated by the process thread */
+	DSPStats& dsp_stats () { return _dsp_stats; }
+	/** Copy the execution time statistics, for use by non-realtime threads.
+	 *  @return false if no consistent copy could be made; @a s is then unchanged
+	 */
+	bool dsp_stats_snapshot (DSPStats::Snapshot& s) const {
+		DSPStats::Snapshot tmp;
+		if (!_dsp_stats.snapshot (tmp)) {
+			return false;
+		}
+		s = tmp;
+		return true;
+	}
+	void reset_dsp_stats () { _dsp_stats.reset (); }
+
 	PBD::Signal0<void> active_changed;
 	PBD::Signal0<void> denormal_protection_changed;
 	PBD::Signal0<void> comment_changed;
@@ -620,6 +636,7 @@ protected:
 
 	bool           _active;
 	samplecnt_t    _signal_latency;
+	DSPStats       _dsp_stats;
 
 	ProcessorList  _processors;
 	mutable Glib::Threads::RWLock _processor_lock;
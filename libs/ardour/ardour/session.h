@@ -103,6 +103,7 @@ namespace ARDOUR {
 
 class Amp;
 class AudioEngine;
+class AudioBlockCache;
 class AudioFileSource;
 class AudioRegion;
 class AudioSource;
@@ -110,6 +111,7 @@ class AudioTrack;
 class Auditioner;
 class AutomationList;
 class AuxInput;
+class BackgroundSync;
 class BufferSet;
 class Bundle;
 class Butler;
@@ -279,6 +281,25 @@ public:
 
 	void refill_all_track_buffers ();
 	Butler* butler() { return _butler; }
+	/** 0 once the session is being destroyed */
+	boost::shared_ptr<AudioBlockCache> audio_block_cache () const { return _audio_block_cache; }
+	BackgroundSync& background_sync () const { return *_background_sync; }
+
+	/** Account for @param kb of locate prefetch of some track, see
+	 *  DiskReader::update_locate_prefetch().
+	 *  @return false, and reserve nothing, if all tracks together would
+	 *  use more than RCConfiguration::locate_prefetch_max_mb
+	 */
+	bool reserve_locate_prefetch (gint kb);
+	void release_locate_prefetch (gint kb);
+
+	/** Account for @param kb of loop range kept in memory by some track,
+	 *  see DiskReader::update_loop_cache().
+	 *  @return false, and reserve nothing, if all tracks together would
+	 *  use more than RCConfiguration::loop_in_ram_max_mb
+	 */
+	bool reserve_loop_cache (gint kb);
+	void release_loop_cache (gint kb);
 	void butler_transport_work ();
 
 	void refresh_disk_space ();
@@ -433,6 +454,8 @@ public:
 	void request_overwrite_buffer (boost::shared_ptr<Route>);
 	void adjust_playback_buffering();
 	void adjust_capture_buffering();
+	/** resize playback buffers with the transport stopped, from the butler */
+	void schedule_playback_buffering_adjustment ();
 
 	bool global_locate_pending() const { return _global_locate_pending; }
 	bool locate_pending() const { return static_cast<bool>(post_transport_work()&PostTransportLocate); }
@@ -478,6 +501,11 @@ public:
 	samplecnt_t worst_output_latency () const { return _worst_output_latency; }
 	samplecnt_t worst_input_latency () const  { return _worst_input_latency; }
 	samplecnt_t worst_route_latency () const  { return _worst_route_latency; }
+
+	/** Predicted (critical path) and measured duration of parallel process graph cycles.
+	 *  @return false if the session does not use the process graph
+	 */
+	bool process_graph_makespan (DSPStats::Snapshot& predicted, DSPStats::Snapshot& actual) const;
 	samplecnt_t worst_latency_preroll () const;
 
 	struct SaveAs {
@@ -1454,6 +1482,11 @@ private:
 
 	Butler* _butler;
 
+	boost::shared_ptr<AudioBlockCache> _audio_block_cache;
+	boost::scoped_ptr<BackgroundSync>  _background_sync;
+	gint                               _locate_prefetch_kb; ///< atomic
+	gint                               _loop_cache_kb; ///< atomic
+
 	static const PostTransportWork ProcessCannotProceedMask =
 		PostTransportWork (
 			PostTransportInputChange|
@@ -1468,7 +1501,6 @@ private:
 	void set_post_transport_work (PostTransportWork ptw) { g_atomic_int_set (&_post_transport_work, (gint) ptw); }
 	void add_post_transport_work (PostTransportWork ptw);
 
-	void schedule_playback_buffering_adjustment ();
 	void schedule_capture_buffering_adjustment ();
 
 	uint32_t    cumulative_rf_motion;
@@ -60,6 +60,8 @@ class LIBARDOUR_API SndFileSource : public AudioFileSource {
 	int flush_header ();
 	void flush ();
 
+	void mark_streaming_write_completed (const Lock& lock);
+
 	samplepos_t natural_position () const;
 
 	samplepos_t last_capture_start_sample() const;
@@ -72,6 +74,10 @@ class LIBARDOUR_API SndFileSource : public AudioFileSource {
 
 	bool clamped_at_unity () const;
 
+	bool file_byte_range (samplepos_t start, samplecnt_t cnt, std::string& path, off_t& offset, size_t& length) const;
+
+	void replace_file (const std::string& p);
+
 	static void setup_standard_crossfades (Session const &, samplecnt_t sample_rate);
 	static const Source::Flag default_writable_flags;
 
@@ -85,15 +91,58 @@ class LIBARDOUR_API SndFileSource : public AudioFileSource {
 
 	samplecnt_t read_unlocked (Sample *dst, samplepos_t start, samplecnt_t cnt) const;
 	samplecnt_t write_unlocked (Sample *dst, samplecnt_t cnt);
+	bool use_block_cache () const { return !writable () && !_mapped_reader; }
 	samplecnt_t write_float (Sample* data, samplepos_t pos, samplecnt_t cnt);
+	samplecnt_t write_block (Sample* data, samplepos_t pos, samplecnt_t cnt);
 
   private:
+	class SharedReader;
+	class MappedReader;
+
 	SNDFILE* _sndfile;
 	SF_INFO _info;
 	BroadcastInfo *_broadcast_info;
 
+	/** decoded interleaved data, shared with the other channels of the same
+	 *  (read-only, more than stereo) file
+	 */
+	boost::shared_ptr<SharedReader> _shared_reader;
+
+	/** direct access to the samples of uncompressed files, if supported */
+	boost::shared_ptr<MappedReader> _mapped_reader;
+
+	/** where the sample data starts in uncompressed (PCM) files, or -1 */
+	off_t    _data_offset;
+	uint32_t _bytes_per_frame;
+
+	/** Capture data is collected here and written in large blocks
+	 *  (see Config->get_capture_write_block_kb()). _length includes
+	 *  the pending samples.
+	 */
+	Sample*     _write_buf;
+	samplecnt_t _write_buf_size;
+	samplecnt_t _write_pending;
+	samplepos_t _write_pending_pos;
+	gint64      _write_pending_since; ///< when the first pending sample was collected, in us
+
+	/** longest time that collected samples wait before they are written */
+	static const gint64 max_write_delay_us = 1000000;
+
+	/** descriptor of writable files (owned by _sndfile), or -1 */
+	int   _write_fd;
+	/** end of the space reserved for the file, or -1 if preallocation is not possible */
+	off_t _preallocated;
+
+	bool flac_encoding () const;
+	int  finish_flac_stream ();
+
+	int  flush_pending_writes ();
+	void preallocate (off_t file_end);
+	void release_preallocation ();
+
 	void init_sndfile ();
 	int open();
+	void find_data_offset (int fd);
 	int setup_broadcast_info (samplepos_t when, struct tm&, time_t);
 	void file_closed ();
 
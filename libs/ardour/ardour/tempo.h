@@ -28,6 +28,7 @@
 
 #include "pbd/undo.h"
 #include "pbd/enum_convert.h"
+#include "pbd/rcu.h"
 
 #include "pbd/stateful.h"
 #include "pbd/statefuldestructible.h"
@@ -367,6 +368,8 @@ class LIBARDOUR_API TempoMap : public PBD::StatefulDestructible
 
 	void get_grid (std::vector<BBTPoint>&,
 	               samplepos_t start, samplepos_t end, uint32_t bar_mod = 0);
+	void get_grid_rt (std::vector<BBTPoint>&,
+	                  samplepos_t start, samplepos_t end, uint32_t bar_mod = 0) const;
 
 	static const Tempo& default_tempo() { return _default_tempo; }
 	static const Meter& default_meter() { return _default_meter; }
@@ -457,9 +460,15 @@ class LIBARDOUR_API TempoMap : public PBD::StatefulDestructible
 	samplepos_t sample_at_beat (const double& beat) const;
 
 	const Meter& meter_at_sample (samplepos_t) const;
+	Meter meter_at_sample_rt (samplepos_t) const;
 
 	/* bbt - it's nearly always better to use meter-based beat (above)
 	   unless tick resolution is desirable.
+
+	   the _rt variants here and below neither lock nor fail, and may be
+	   used in the process thread. They read the most recently published
+	   snapshot of the map, which can be a few cycles behind an edit that
+	   is in progress.
 	*/
 	Timecode::BBT_Time bbt_at_sample (samplepos_t when);
 	Timecode::BBT_Time bbt_at_sample_rt (samplepos_t when);
@@ -488,6 +497,9 @@ class LIBARDOUR_API TempoMap : public PBD::StatefulDestructible
 	samplepos_t samplepos_plus_qn (samplepos_t, Temporal::Beats) const;
 	Temporal::Beats framewalk_to_qn (samplepos_t pos, samplecnt_t distance) const;
 
+	samplepos_t samplepos_plus_qn_rt (samplepos_t, Temporal::Beats) const;
+	Temporal::Beats framewalk_to_qn_rt (samplepos_t pos, samplecnt_t distance) const;
+
 	/* quarter note related functions are also tempo-sensitive and ignore meter.
 	   quarter notes may be compared with and assigned to Temporal::Beats.
 	*/
@@ -593,7 +605,104 @@ private:
 	samplecnt_t                    _sample_rate;
 	mutable Glib::Threads::RWLock lock;
 
-	void recompute_tempi (Metrics& metrics);
+	/** The sections of _metrics, in the same order, in arrays for binary
+	 *  search rather than walking the list. Rebuilt whenever the map is
+	 *  recomputed (the sections' positions are read from the sections
+	 *  themselves, so only changes of the list have to rebuild it), and
+	 *  only used for lookups in _metrics, not in the copies the solver
+	 *  works on.
+	 */
+	struct MetricIndex {
+		MetricIndex () : valid (false) {}
+
+		void build (const Metrics&);
+
+		std::vector<TempoSection*> tempos;     ///< active tempo sections
+		std::vector<TempoSection*> all_tempos; ///< including inactive ones
+		std::vector<MeterSection*> meters;
+		bool                       valid;
+	};
+
+	MetricIndex _index;
+
+	/** An immutable copy of the sections of the map, with their index,
+	 *  for the lock-free _rt lookups. A new one is published through
+	 *  _snapshot when a write lock that rebuilt the index is released,
+	 *  so readers never see the intermediate states of an edit.
+	 */
+	class Snapshot {
+	public:
+		Snapshot () : _sample_rate (0) {}
+		Snapshot (Snapshot const&);
+		~Snapshot ();
+
+		void set (const Metrics&, samplecnt_t sample_rate);
+
+		const Metrics& metrics () const { return _metrics; }
+		/** @return the index of metrics(), built when the snapshot was set */
+		const MetricIndex* index () const { return _index.valid ? &_index : 0; }
+
+		double minute_at_sample (samplepos_t sample) const { return (sample / (double) _sample_rate) / 60.0; }
+
+		double pulse_at_minute (double minute) const;
+		double minute_at_pulse (double pulse) const;
+		double quarter_notes_between (double start_minute, double end_minute) const;
+		double pulse_at_bbt (const Timecode::BBT_Time&) const;
+		Timecode::BBT_Time bbt_at_minute (double minute) const;
+		Meter meter_at_minute (double minute) const;
+
+	private:
+		Snapshot& operator= (Snapshot const&);
+		void clear ();
+
+		Metrics     _metrics;
+		MetricIndex _index;
+		samplecnt_t _sample_rate;
+	};
+
+	SerializedRCUManager<Snapshot> _snapshot;
+	bool                           _snapshot_dirty;
+
+	/** Take this instead of a WriterLock on lock in every public method
+	 *  that modifies the map: it publishes the result of the edit, if
+	 *  the index was rebuilt, just before the lock is released.
+	 */
+	class WriteLock {
+	public:
+		WriteLock (TempoMap& map) : _map (map), _lm (map.lock) {}
+		~WriteLock () { _map.publish_snapshot (); }
+
+	private:
+		TempoMap&                         _map;
+		Glib::Threads::RWLock::WriterLock _lm;
+	};
+
+	friend class WriteLock;
+
+	void rebuild_index ();
+	void publish_snapshot ();
+	void invalidate_index () { _index.valid = false; }
+
+	/** The snapshot that the _rt lookups of the calling thread are
+	 *  working on, if any, so that its index is used for its metrics.
+	 */
+	static Glib::Threads::Private<Snapshot> _rt_snapshot;
+
+	/** @return the index of @a metrics, or 0 if there is none (the copies
+	 *  the solver works on), or it is not valid.
+	 */
+	const MetricIndex* index_for (const Metrics& metrics) const {
+		if (&metrics == &_metrics) {
+			return _index.valid ? &_index : 0;
+		}
+		Snapshot const* s = _rt_snapshot.get ();
+		return (s && &metrics == &s->metrics ()) ? s->index () : 0;
+	}
+
+	void get_grid_locked (const Metrics& metrics, std::vector<BBTPoint>&,
+	                      samplepos_t start, samplepos_t end, uint32_t bar_mod) const;
+
+	void recompute_tempi (Metrics& metrics, bool reindex = true);
 	void recompute_meters (Metrics& metrics);
 	void recompute_map (Metrics& metrics, samplepos_t end = -1);
 
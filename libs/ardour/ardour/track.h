@@ -134,12 +134,17 @@ public:
 	float playback_buffer_load () const;
 	float capture_buffer_load () const;
 	int do_refill ();
+	bool update_locate_prefetch (std::vector<samplepos_t> const&);
+	boost::shared_ptr<DiskReader> disk_reader () const { return _disk_reader; }
+	boost::shared_ptr<DiskWriter> disk_writer () const { return _disk_writer; }
 	int do_flush (RunContext, bool force = false);
 	void set_pending_overwrite (bool);
 	int seek (samplepos_t, bool complete_refill = false);
 	int can_internal_playback_seek (samplecnt_t);
 	int internal_playback_seek (samplecnt_t);
 	void non_realtime_locate (samplepos_t);
+	virtual void non_realtime_locate_processors (samplepos_t);
+	void non_realtime_locate_disk_reader (samplepos_t);
 	void realtime_handle_transport_stopped ();
 	void non_realtime_speed_change ();
 	int overwrite_existing_buffers ();
@@ -515,6 +515,7 @@ namespace ARDOUR {
 		RF64,
 		RF64_WAV,
 		MBWF,
+		FLAC,
 	};
 
 	struct PeakData {
@@ -102,6 +102,7 @@ LIBARDOUR_API ARDOUR::MeterFalloff meter_falloff_from_float (float);
 LIBARDOUR_API float meter_falloff_to_db_per_sec (float);
 
 LIBARDOUR_API const char* native_header_format_extension (ARDOUR::HeaderFormat, const ARDOUR::DataType& type);
+LIBARDOUR_API ARDOUR::HeaderFormat writable_header_format (ARDOUR::HeaderFormat, bool destructive);
 LIBARDOUR_API bool matching_unsuffixed_filename_exists_in (const std::string& dir, const std::string& name);
 
 LIBARDOUR_API uint32_t how_many_dsp_threads ();
@@ -0,0 +1,155 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include "ardour/audio_block_cache.h"
+#include "ardour/rc_configuration.h"
+
+using namespace ARDOUR;
+
+const samplecnt_t AudioBlockCache::block_samples;
+
+static const size_t block_bytes = AudioBlockCache::block_samples * sizeof (Sample);
+
+AudioBlockCache::AudioBlockCache ()
+{
+}
+
+size_t
+AudioBlockCache::budget () const
+{
+	return (size_t) Config->get_audio_block_cache_mb () * 1048576;
+}
+
+bool
+AudioBlockCache::enabled () const
+{
+	return Config->get_audio_block_cache_mb () > 0;
+}
+
+boost::shared_ptr<AudioBlockCache::Block const>
+AudioBlockCache::lookup (PBD::ID const& source, uint32_t generation, uint64_t block)
+{
+	Glib::Threads::Mutex::Lock lm (_lock);
+
+	Blocks::iterator i = _blocks.find (Key (source, generation, block));
+
+	if (i == _blocks.end ()) {
+		++_stats.misses;
+		return boost::shared_ptr<Block const> ();
+	}
+
+	++_stats.hits;
+	_lru.splice (_lru.begin (), _lru, i->second.lru);
+
+	return i->second.block;
+}
+
+bool
+AudioBlockCache::contains (PBD::ID const& source, uint32_t generation, uint64_t block) const
+{
+	Glib::Threads::Mutex::Lock lm (_lock);
+	return _blocks.find (Key (source, generation, block)) != _blocks.end ();
+}
+
+void
+AudioBlockCache::insert (PBD::ID const& source, uint32_t generation, uint64_t block, boost::shared_ptr<Block const> data)
+{
+	Glib::Threads::Mutex::Lock lm (_lock);
+
+	Key const key (source, generation, block);
+	Blocks::iterator i = _blocks.find (key);
+
+	if (i != _blocks.end ()) {
+		/* another thread got there first */
+		i->second.block = data;
+		_lru.splice (_lru.begin (), _lru, i->second.lru);
+		return;
+	}
+
+	size_t const b = budget ();
+
+	if (b < block_bytes) {
+		return;
+	}
+
+	evict_locked (b - block_bytes);
+
+	_lru.push_front (key);
+
+	Entry e;
+	e.block = data;
+	e.lru = _lru.begin ();
+	_blocks.insert (std::make_pair (key, e));
+
+	++_stats.blocks;
+	_stats.bytes += block_bytes;
+}
+
+void
+AudioBlockCache::evict_locked (size_t budget)
+{
+	while (!_lru.empty () && _stats.bytes > budget) {
+		_blocks.erase (_lru.back ());
+		_lru.pop_back ();
+		++_stats.evictions;
+		--_stats.blocks;
+		_stats.bytes -= block_bytes;
+	}
+}
+
+void
+AudioBlockCache::drop (PBD::ID const& source)
+{
+	Glib::Threads::Mutex::Lock lm (_lock);
+
+	Blocks::iterator i = _blocks.lower_bound (Key (source, 0, 0));
+
+	while (i != _blocks.end () && i->first.source == source) {
+		_lru.erase (i->second.lru);
+		_blocks.erase (i++);
+		--_stats.blocks;
+		_stats.bytes -= block_bytes;
+	}
+}
+
+void
+AudioBlockCache::clear ()
+{
+	Glib::Threads::Mutex::Lock lm (_lock);
+	_blocks.clear ();
+	_lru.clear ();
+	_stats.blocks = 0;
+	_stats.bytes = 0;
+}
+
+AudioBlockCache::Stats
+AudioBlockCache::stats () const
+{
+	Glib::Threads::Mutex::Lock lm (_lock);
+	return _stats;
+}
+
+void
+AudioBlockCache::reset_stats ()
+{
+	Glib::Threads::Mutex::Lock lm (_lock);
+	_stats.hits = 0;
+	_stats.misses = 0;
+	_stats.evictions = 0;
+}
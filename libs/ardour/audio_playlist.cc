@@ -34,8 +34,11 @@ using namespace ARDOUR;
 using namespace std;
 using namespace PBD;
 
+Glib::Threads::Private<AudioPlaylist::RenderSegments> AudioPlaylist::_render_scratch;
+
 AudioPlaylist::AudioPlaylist (Session& session, const XMLNode& node, bool hidden)
 	: Playlist (session, node, DataType::AUDIO, hidden)
+	, _render_plan_valid (false)
 {
 #ifndef NDEBUG
 	XMLProperty const * prop = node.property("type");
@@ -55,16 +58,19 @@ AudioPlaylist::AudioPlaylist (Session& session, const XMLNode& node, bool hidden
 
 AudioPlaylist::AudioPlaylist (Session& session, string name, bool hidden)
 	: Playlist (session, name, DataType::AUDIO, hidden)
+	, _render_plan_valid (false)
 {
 }
 
 AudioPlaylist::AudioPlaylist (boost::shared_ptr<const AudioPlaylist> other, string name, bool hidden)
 	: Playlist (other, name, hidden)
+	, _render_plan_valid (false)
 {
 }
 
 AudioPlaylist::AudioPlaylist (boost::shared_ptr<const AudioPlaylist> other, samplepos_t start, samplecnt_t cnt, string name, bool hidden)
 	: Playlist (other, start, cnt, name, hidden)
+	, _render_plan_valid (false)
 {
 	RegionReadLock rlock2 (const_cast<AudioPlaylist*> (other.get()));
 	in_set_state++;
@@ -149,12 +155,30 @@ struct ReadSorter {
     }
 };
 
-/** A segment of region that needs to be read */
-struct Segment {
-	Segment (boost::shared_ptr<AudioRegion> r, Evoral::Range<samplepos_t> a) : region (r), range (a) {}
+/** Order in which overlapping segments are read: lower layers first
+ *  (regions above mix into them through their fades), and the segments
+ *  of any one region by position.
+ */
+struct RenderOrder {
+	template<typename S>
+	bool operator() (S const& a, S const& b) const {
+		if (a.region != b.region) {
+			if (a.region->layer() != b.region->layer()) {
+				return a.region->layer() < b.region->layer();
+			}
+			if (a.region->position() != b.region->position()) {
+				return a.region->position() > b.region->position();
+			}
+			return a.region < b.region;
+		}
+		return a.from < b.from;
+	}
+};
 
-	boost::shared_ptr<AudioRegion> region; ///< the region
-	Evoral::Range<samplepos_t> range;       ///< range of the region to read, in session samples
+struct RangeStartSorter {
+	bool operator() (Evoral::Range<samplepos_t> const& a, Evoral::Range<samplepos_t> const& b) const {
+		return a.from < b.from;
+	}
 };
 
 /** @param start Start position in session samples.
@@ -188,72 +212,396 @@ AudioPlaylist::read (Sample *buf, Sample *mixdown_buffer, float *gain_buffer, sa
 
 	Playlist::RegionReadLock rl (this);
 
-	/* Find all the regions that are involved in the bit we are reading,
-	   and sort them by descending layer and ascending position.
-	*/
-	boost::shared_ptr<RegionList> all = regions_touched_locked (start, start + cnt - 1);
-	all->sort (ReadSorter ());
+	RenderSegments* to_do = _render_scratch.get ();
 
-	/* This will be a list of the bits of our read range that we have
-	   handled completely (ie for which no more regions need to be read).
-	   It is a list of ranges in session samples.
-	*/
-	Evoral::RangeList<samplepos_t> done;
+	if (!to_do) {
+		to_do = new RenderSegments;
+		_render_scratch.set (to_do);
+	}
 
-	/* This will be a list of the bits of regions that we need to read */
-	list<Segment> to_do;
+	samplepos_t const end = start + cnt - 1;
 
-	/* Now go through the `all' list filling in `to_do' and `done' */
-	for (RegionList::iterator i = all->begin(); i != all->end(); ++i) {
-		boost::shared_ptr<AudioRegion> ar = boost::dynamic_pointer_cast<AudioRegion> (*i);
+	find_render_segments (start, end, *to_do);
+
+	/* Now do the actual reads, bottom layer first */
+	for (RenderSegments::const_iterator i = to_do->begin(); i != to_do->end(); ++i) {
+		samplepos_t const from = max (i->from, start);
+		samplepos_t const to = min (i->to, end);
+
+		DEBUG_TRACE (DEBUG::AudioPlayback, string_compose ("\tPlaylist %1 read %2 @ %3 for %4, channel %5, buf @ %6 offset %7\n",
+								   name(), i->region->name(), from,
+								   to - from + 1, (int) chan_n,
+								   buf, from - start));
+		i->region->read_at (buf + from - start, mixdown_buffer, gain_buffer, from, to - from + 1, chan_n);
+	}
+
+	/* drop region references, keep the space */
+	to_do->clear ();
+
+	return cnt;
+}
+
+void
+AudioPlaylist::audible_segments (samplepos_t start, samplecnt_t cnt, RenderSegments& segments)
+{
+	segments.clear ();
+
+	if (cnt <= 0) {
+		return;
+	}
+
+	Playlist::RegionReadLock rl (this);
+	find_render_segments (start, start + cnt - 1, segments);
+}
+
+/** Fill the (empty) @a segments with the parts of regions that are
+ *  audible in [start, end], bottom layer first, with the adjacent spans of each region
+ *  joined. The caller must hold the region read lock.
+ */
+void
+AudioPlaylist::find_render_segments (samplepos_t start, samplepos_t end, RenderSegments& segments)
+{
+	/* Look up the segments of regions that are audible in the bit we
+	 * are reading. Once the plan is up to date and the scratch list
+	 * has grown to size, this does not allocate.
+	 */
+	{
+		Glib::Threads::Mutex::Lock lm (_render_plan_lock);
+
+		update_render_plan ();
+
+		RenderPlan::const_iterator s = _render_plan.upper_bound (start);
+
+		if (s != _render_plan.begin ()) {
+			--s;
+			if (s->second.to < start) {
+				++s;
+			}
+		}
+
+		for (; s != _render_plan.end () && s->first <= end; ++s) {
+			samplepos_t const from = max (s->first, start);
+			samplepos_t const to = min (s->second.to, end);
+			for (vector<boost::shared_ptr<AudioRegion> >::const_iterator r = s->second.regions.begin(); r != s->second.regions.end(); ++r) {
+				segments.push_back (RenderSegment (*r, from, to));
+			}
+		}
+	}
+
+	std::sort (segments.begin(), segments.end(), RenderOrder ());
 
+	/* join the adjacent spans of each region, so that it is read in one go */
+	if (!segments.empty ()) {
+		RenderSegments::iterator o = segments.begin ();
+		for (RenderSegments::iterator i = o + 1; i != segments.end (); ++i) {
+			if (i->region == o->region && i->from == o->to + 1) {
+				o->to = i->to;
+			} else {
+				*++o = *i;
+			}
+		}
+		segments.erase (o + 1, segments.end ());
+	}
+}
+
+/** Resolve layering for @a rl within [from, to], appending the audible
+ *  segments to @a out. Regions are handled top layer first; the bodies
+ *  (the parts between the end of the fade in and the start of the fade
+ *  out) of opaque regions hide everything below them.
+ */
+void
+AudioPlaylist::flatten (RegionList const& rl, samplepos_t from, samplepos_t to, RenderSegments& out) const
+{
+	vector<boost::shared_ptr<AudioRegion> > all;
+
+	for (RegionList::const_iterator i = rl.begin(); i != rl.end(); ++i) {
+		boost::shared_ptr<AudioRegion> ar = boost::dynamic_pointer_cast<AudioRegion> (*i);
 		/* muted regions don't figure into it at all */
-		if ( ar->muted() )
+		if (ar && !ar->muted()) {
+			all.push_back (ar);
+		}
+	}
+
+	/* descending layer and ascending position */
+	stable_sort (all.begin(), all.end(), ReadSorter ());
+
+	/* parts of [from, to] that are handled completely (no more regions
+	 * need to be read), as disjoint inclusive ranges: start -> end.
+	 */
+	typedef map<samplepos_t, samplepos_t> Done;
+	Done done;
+
+	vector<Evoral::Range<samplepos_t> > pieces;
+
+	for (vector<boost::shared_ptr<AudioRegion> >::const_iterator i = all.begin(); i != all.end(); ++i) {
+
+		boost::shared_ptr<AudioRegion> const& ar (*i);
+
+		samplepos_t const a = max (ar->first_sample(), from);
+		samplepos_t const b = min (ar->last_sample(), to);
+
+		if (a > b) {
 			continue;
+		}
 
-		/* Work out which bits of this region need to be read;
-		   first, trim to the range we are reading...
-		*/
-		Evoral::Range<samplepos_t> region_range = ar->range ();
-		region_range.from = max (region_range.from, start);
-		region_range.to = min (region_range.to, start + cnt - 1);
+		/* subtract what is done from [a, b] */
 
-		/* ... and then remove the bits that are already done */
+		pieces.clear ();
 
-		Evoral::RangeList<samplepos_t> region_to_do = Evoral::subtract (region_range, done);
+		Done::iterator d = done.upper_bound (a);
+		if (d != done.begin()) {
+			Done::iterator p = d;
+			--p;
+			if (p->second >= a) {
+				d = p;
+			}
+		}
+
+		samplepos_t pos = a;
+
+		for (; d != done.end() && d->first <= b; ++d) {
+			if (d->first > pos) {
+				pieces.push_back (Evoral::Range<samplepos_t> (pos, d->first - 1));
+			}
+			pos = max (pos, d->second + 1);
+		}
 
-		/* Make a note to read those bits, adding their bodies (the parts between end-of-fade-in
-		   and start-of-fade-out) to the `done' list.
-		*/
+		if (pos <= b) {
+			pieces.push_back (Evoral::Range<samplepos_t> (pos, b));
+		}
+
+		Evoral::Range<samplepos_t> const body = ar->body_range ();
+
+		for (vector<Evoral::Range<samplepos_t> >::const_iterator j = pieces.begin(); j != pieces.end(); ++j) {
+
+			out.push_back (RenderSegment (ar, j->from, j->to));
+
+			if (!ar->opaque () || !(body.from < j->to && body.to > j->from)) {
+				continue;
+			}
 
-		Evoral::RangeList<samplepos_t>::List t = region_to_do.get ();
+			/* Cut this range down to just the body and mark it done */
 
-		for (Evoral::RangeList<samplepos_t>::List::iterator j = t.begin(); j != t.end(); ++j) {
-			Evoral::Range<samplepos_t> d = *j;
-			to_do.push_back (Segment (ar, d));
+			samplepos_t f = max (j->from, body.from);
+			samplepos_t t = min (j->to, body.to);
 
-			if (ar->opaque ()) {
-				/* Cut this range down to just the body and mark it done */
-				Evoral::Range<samplepos_t> body = ar->body_range ();
-				if (body.from < d.to && body.to > d.from) {
-					d.from = max (d.from, body.from);
-					d.to = min (d.to, body.to);
-					done.add (d);
+			Done::iterator k = done.upper_bound (f);
+			if (k != done.begin()) {
+				Done::iterator p = k;
+				--p;
+				if (p->second + 1 >= f) {
+					f = p->first;
+					t = max (t, p->second);
+					k = p;
 				}
 			}
+			while (k != done.end() && k->first <= t + 1) {
+				t = max (t, k->second);
+				done.erase (k++);
+			}
+			done[f] = t;
 		}
 	}
+}
 
-	/* Now go backwards through the to_do list doing the actual reads */
-	for (list<Segment>::reverse_iterator i = to_do.rbegin(); i != to_do.rend(); ++i) {
-		DEBUG_TRACE (DEBUG::AudioPlayback, string_compose ("\tPlaylist %1 read %2 @ %3 for %4, channel %5, buf @ %6 offset %7\n",
-								   name(), i->region->name(), i->range.from,
-								   i->range.to - i->range.from + 1, (int) chan_n,
-								   buf, i->range.from - start));
-		i->region->read_at (buf + i->range.from - start, mixdown_buffer, gain_buffer, i->range.from, i->range.to - i->range.from + 1, chan_n);
+void
+AudioPlaylist::update_render_plan ()
+{
+	/* Caller must hold the region lock and _render_plan_lock */
+
+	if (!_render_plan_valid) {
+
+		_render_plan.clear ();
+		_planned_extents.clear ();
+
+		RegionList const& rl (regions.rlist ());
+
+		for (RegionList::const_iterator i = rl.begin(); i != rl.end(); ++i) {
+			_planned_extents[i->get()] = (*i)->range ();
+		}
+
+		RenderSegments segments;
+		flatten (rl, 0, max_samplepos, segments);
+		add_render_spans (segments);
+
+		_render_plan_dirty.clear ();
+		_render_plan_valid = true;
+		return;
 	}
 
-	return cnt;
+	if (_render_plan_dirty.empty ()) {
+		return;
+	}
+
+	/* merge overlapping and adjacent dirty ranges, so that every part of
+	 * the plan is resolved at most once.
+	 */
+
+	sort (_render_plan_dirty.begin(), _render_plan_dirty.end(), RangeStartSorter ());
+
+	vector<Evoral::Range<samplepos_t> >::iterator o = _render_plan_dirty.begin ();
+	for (vector<Evoral::Range<samplepos_t> >::iterator d = o + 1; d != _render_plan_dirty.end(); ++d) {
+		if (d->from <= o->to || d->from == o->to + 1) {
+			o->to = max (o->to, d->to);
+		} else {
+			*++o = *d;
+		}
+	}
+	_render_plan_dirty.erase (o + 1, _render_plan_dirty.end ());
+
+	RenderSegments segments;
+
+	for (vector<Evoral::Range<samplepos_t> >::const_iterator d = _render_plan_dirty.begin(); d != _render_plan_dirty.end(); ++d) {
+
+		/* cut the dirty range out of the plan .. */
+
+		split_render_span (d->from);
+		if (d->to < max_samplepos) {
+			split_render_span (d->to + 1);
+		}
+
+		_render_plan.erase (_render_plan.lower_bound (d->from), _render_plan.upper_bound (d->to));
+
+		/* .. and resolve it again */
+
+		boost::shared_ptr<RegionList> touched = regions_touched_locked (d->from, d->to);
+
+		segments.clear ();
+		flatten (*touched, d->from, d->to, segments);
+		add_render_spans (segments);
+	}
+
+	_render_plan_dirty.clear ();
+}
+
+/** Split the span of the plan that contains @a pos (if any) so that a
+ *  span starts at @a pos.
+ */
+void
+AudioPlaylist::split_render_span (samplepos_t pos)
+{
+	RenderPlan::iterator s = _render_plan.upper_bound (pos);
+
+	if (s == _render_plan.begin ()) {
+		return;
+	}
+
+	RenderPlan::iterator p = s;
+	--p;
+
+	if (p->first == pos || p->second.to < pos) {
+		return;
+	}
+
+	RenderSpan tail (p->second);
+	p->second.to = pos - 1;
+	_render_plan.insert (s, make_pair (pos, tail));
+}
+
+/** Add the segments that flatten() resolved for a range that is not in
+ *  the plan (any more) to the plan, as spans. Sorts @a segments.
+ */
+void
+AudioPlaylist::add_render_spans (RenderSegments& segments)
+{
+	if (segments.empty ()) {
+		return;
+	}
+
+	sort (segments.begin(), segments.end(), RenderOrder ());
+
+	/* every point where the set of audible regions may change */
+
+	vector<samplepos_t> bounds;
+	bounds.reserve (segments.size () * 2);
+
+	for (RenderSegments::const_iterator i = segments.begin(); i != segments.end(); ++i) {
+		bounds.push_back (i->from);
+		bounds.push_back (i->to + 1);
+	}
+
+	sort (bounds.begin(), bounds.end());
+	bounds.erase (unique (bounds.begin(), bounds.end()), bounds.end());
+
+	vector<RenderSpan> spans (bounds.size () - 1);
+
+	for (size_t n = 0; n < spans.size (); ++n) {
+		spans[n].to = bounds[n + 1] - 1;
+	}
+
+	/* segments are in render order, so the regions of each span are, too */
+
+	for (RenderSegments::const_iterator i = segments.begin(); i != segments.end(); ++i) {
+		size_t n = lower_bound (bounds.begin(), bounds.end(), i->from) - bounds.begin();
+		for (; bounds[n] <= i->to; ++n) {
+			spans[n].regions.push_back (i->region);
+		}
+	}
+
+	RenderPlan::iterator hint = _render_plan.lower_bound (bounds.front ());
+	RenderPlan::iterator last = _render_plan.end ();
+
+	for (size_t n = 0; n < spans.size (); ++n) {
+
+		if (spans[n].regions.empty ()) {
+			continue;
+		}
+
+		if (last != _render_plan.end () && last->second.to + 1 == bounds[n] && last->second.regions == spans[n].regions) {
+			last->second.to = spans[n].to;
+			continue;
+		}
+
+		last = _render_plan.insert (hint, make_pair (bounds[n], spans[n]));
+	}
+}
+
+void
+AudioPlaylist::invalidate_render_plan (boost::shared_ptr<Region> const& region)
+{
+	Glib::Threads::Mutex::Lock lm (_render_plan_lock);
+
+	if (!_render_plan_valid) {
+		return;
+	}
+
+	/* Region::last_range() is not reliable here (not every change of
+	 * position updates the last length), so use the extent the region
+	 * had when the plan was made.
+	 */
+
+	Evoral::Range<samplepos_t> const now (region->range ());
+
+	PlannedExtents::iterator p = _planned_extents.find (region.get ());
+
+	if (p != _planned_extents.end ()) {
+		_render_plan_dirty.push_back (p->second);
+		p->second = now;
+	} else {
+		_planned_extents.insert (make_pair (region.get (), now));
+	}
+
+	_render_plan_dirty.push_back (now);
+}
+
+void
+AudioPlaylist::regions_invalidated ()
+{
+	Glib::Threads::Mutex::Lock lm (_render_plan_lock);
+
+	_render_plan_valid = false;
+	_render_plan.clear ();
+	_render_plan_dirty.clear ();
+	_planned_extents.clear ();
+}
+
+size_t
+AudioPlaylist::render_plan_size ()
+{
+	RegionReadLock rl (this);
+	Glib::Threads::Mutex::Lock lm (_render_plan_lock);
+	update_render_plan ();
+	return _render_plan.size ();
 }
 
 void
@@ -298,6 +646,7 @@ AudioPlaylist::destroy_region (boost::shared_ptr<Region> region)
 
 			if ((*i) == region) {
 				regions.erase (i);
+				invalidate_region_index ();
 				changed = true;
 			}
 
@@ -331,6 +680,22 @@ AudioPlaylist::destroy_region (boost::shared_ptr<Region> region)
 bool
 AudioPlaylist::region_changed (const PropertyChange& what_changed, boost::shared_ptr<Region> region)
 {
+	/* keep the render plan up to date, even while loading */
+
+	PropertyChange audible;
+	audible.add (Properties::muted);
+	audible.add (Properties::opaque);
+	audible.add (Properties::fade_in);
+	audible.add (Properties::fade_out);
+	audible.add (Properties::fade_in_active);
+	audible.add (Properties::fade_out_active);
+
+	if (what_changed.contains (Properties::layer)) {
+		regions_invalidated ();
+	} else if (what_changed.contains (Properties::position) || what_changed.contains (Properties::length) || what_changed.contains (audible)) {
+		invalidate_render_plan (region);
+	}
+
 	if (in_flush || in_set_state) {
 		return false;
 	}
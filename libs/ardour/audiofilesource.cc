@@ -289,6 +289,7 @@ AudioFileSource::set_gain (float g, bool temporarily)
 		return;
 	}
 	_gain = g;
+	invalidate_block_cache ();
 	if (temporarily) {
 		return;
 	}
@@ -296,6 +297,13 @@ AudioFileSource::set_gain (float g, bool temporarily)
 	setup_peakfile ();
 }
 
+void
+AudioFileSource::replace_file (const std::string& newpath)
+{
+	FileSource::replace_file (newpath);
+	invalidate_block_cache ();
+}
+
 bool
 AudioFileSource::safe_audio_file_extension(const string& file)
 {
@@ -27,6 +27,7 @@
 #include <fcntl.h>
 #include <float.h>
 #include <cerrno>
+#include <cstring>
 #include <ctime>
 #include <cmath>
 #include <iomanip>
@@ -53,6 +54,7 @@
 #include "pbd/scoped_file_descriptor.h"
 #include "pbd/xml++.h"
 
+#include "ardour/audio_block_cache.h"
 #include "ardour/audiosource.h"
 #include "ardour/rc_configuration.h"
 #include "ardour/runtime_functions.h"
@@ -80,6 +82,8 @@ AudioSource::AudioSource (Session& s, const string& name)
 	: Source (s, DataType::AUDIO, name)
 	, _length (0)
 	, _peak_byte_max (0)
+	, _block_cache_generation (0)
+	, _block_cache (s.audio_block_cache ())
 	, _peaks_built (false)
 	, _peakfile_fd (-1)
 	, peak_leftover_cnt (0)
@@ -96,6 +100,8 @@ AudioSource::AudioSource (Session& s, const XMLNode& node)
 	: Source (s, node)
 	, _length (0)
 	, _peak_byte_max (0)
+	, _block_cache_generation (0)
+	, _block_cache (s.audio_block_cache ())
 	, _peaks_built (false)
 	, _peakfile_fd (-1)
 	, peak_leftover_cnt (0)
@@ -119,6 +125,11 @@ AudioSource::~AudioSource ()
 		cerr << "AudioSource destroyed with leftover peak data pending" << endl;
 	}
 
+	boost::shared_ptr<AudioBlockCache> cache = _block_cache.lock ();
+	if (cache) {
+		cache->drop (id());
+	}
+
 	if ((-1) != _peakfile_fd) {
 		close (_peakfile_fd);
 		_peakfile_fd = -1;
@@ -314,9 +325,100 @@ AudioSource::read (Sample *dst, samplepos_t start, samplecnt_t cnt, int /*channe
 	assert (cnt >= 0);
 
 	Glib::Threads::Mutex::Lock lm (_lock);
+
+	if (use_block_cache ()) {
+		boost::shared_ptr<AudioBlockCache> cache = _block_cache.lock ();
+		if (cache && cache->enabled ()) {
+			return read_cached (*cache, dst, start, cnt);
+		}
+	}
+
 	return read_unlocked (dst, start, cnt);
 }
 
+/** Read via the AudioBlockCache; the caller must hold _lock */
+samplecnt_t
+AudioSource::read_cached (AudioBlockCache& cache, Sample *dst, samplepos_t start, samplecnt_t cnt) const
+{
+	samplecnt_t const bs = AudioBlockCache::block_samples;
+	samplecnt_t done = 0;
+
+	/* if the generation changes while we read, what we insert below is
+	 * filed under the old one and never found again.
+	 */
+	uint32_t const generation = g_atomic_int_get (&_block_cache_generation);
+
+	while (done < cnt) {
+
+		samplepos_t const pos = start + done;
+		uint64_t const n = pos / bs;
+		samplecnt_t const offset = pos - n * bs;
+
+		boost::shared_ptr<AudioBlockCache::Block const> block = cache.lookup (id(), generation, n);
+
+		if (!block) {
+			boost::shared_ptr<AudioBlockCache::Block> b (new AudioBlockCache::Block);
+			b->length = read_unlocked (&b->data[0], n * bs, bs);
+			if (b->length < 0) {
+				b->length = 0;
+			}
+			/* only keep complete blocks, and the one at the end of the
+			 * data; a failed or short read must not stick.
+			 */
+			if (b->length == bs || (b->length > 0 && (samplepos_t) (n * bs) + b->length == _length)) {
+				cache.insert (id(), generation, n, b);
+			}
+			block = b;
+		}
+
+		if (block->length <= offset) {
+			/* short read, past the end of the data */
+			break;
+		}
+
+		samplecnt_t const to_copy = min (cnt - done, block->length - offset);
+		memcpy (dst + done, &block->data[offset], to_copy * sizeof (Sample));
+		done += to_copy;
+
+		if (block->length < bs) {
+			break;
+		}
+	}
+
+	if (done < cnt) {
+		memset (dst + done, 0, sizeof (Sample) * (cnt - done));
+	}
+
+	return done;
+}
+
+bool
+AudioSource::block_cached (samplepos_t pos) const
+{
+	if (!use_block_cache ()) {
+		return false;
+	}
+
+	boost::shared_ptr<AudioBlockCache> cache = _block_cache.lock ();
+
+	if (!cache || !cache->enabled ()) {
+		return false;
+	}
+
+	return cache->contains (id(), g_atomic_int_get (&_block_cache_generation), pos / AudioBlockCache::block_samples);
+}
+
+void
+AudioSource::invalidate_block_cache ()
+{
+	g_atomic_int_inc (&_block_cache_generation);
+
+	boost::shared_ptr<AudioBlockCache> cache = _block_cache.lock ();
+	if (cache) {
+		cache->drop (id());
+	}
+}
+
 samplecnt_t
 AudioSource::write (Sample *dst, samplecnt_t cnt)
 {
@@ -381,6 +381,8 @@ Automatable::non_realtime_locate (samplepos_t now)
 			}
 
 			l->start_write_pass (now);
+			/* so that the process thread does not have to walk the list */
+			l->rebuild_index_if_necessary ();
 
 			if (rolling && am_touching) {
 				c->start_touch (now);
@@ -419,6 +421,7 @@ Automatable::non_realtime_transport_stop (samplepos_t now, bool /*flush_processo
 		c->commit_transaction (list_did_write);
 
 		l->write_pass_finished (now, Config->get_automation_thinning_factor ());
+		l->rebuild_index_if_necessary ();
 
 		if (l->automation_state () == Write) {
 			l->set_automation_state (Touch);
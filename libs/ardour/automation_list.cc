@@ -28,6 +28,7 @@
 #include "ardour/event_type_map.h"
 #include "ardour/parameter_descriptor.h"
 #include "ardour/parameter_types.h"
+#include "ardour/rc_configuration.h"
 #include "ardour/evoral_types_convert.h"
 #include "ardour/types_convert.h"
 #include "evoral/Curve.hpp"
@@ -156,6 +157,9 @@ AutomationList::create_curve_if_necessary()
 	case FadeInAutomation:
 	case FadeOutAutomation:
 	case EnvelopeAutomation:
+	case PluginAutomation:
+	case PluginPropertyAutomation:
+		/* plugin automation is rendered per cycle, see PluginInsert::automate_and_run() */
 		create_curve();
 		break;
 	default:
@@ -240,7 +244,8 @@ void
 AutomationList::start_write_pass (double when)
 {
 	snapshot_history (true);
-	ControlList::start_write_pass (when);
+	/* thin while writing, so that long passes do not pile up points */
+	ControlList::start_write_pass (when, Config->get_automation_thinning_factor ());
 }
 
 void
@@ -0,0 +1,164 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include <fcntl.h>
+#ifndef PLATFORM_WINDOWS
+#include <unistd.h>
+#endif
+
+#include <boost/bind.hpp>
+
+#include "pbd/pthread_utils.h"
+
+#include "ardour/background_sync.h"
+
+using namespace ARDOUR;
+
+BackgroundSync::BackgroundSync ()
+	: _busy (false)
+	, _quit (false)
+	, _thread (0)
+{
+}
+
+BackgroundSync::~BackgroundSync ()
+{
+	stop ();
+}
+
+void
+BackgroundSync::stop ()
+{
+	Glib::Threads::Thread* t;
+
+	{
+		Glib::Threads::Mutex::Lock lm (_lock);
+		_quit = true;
+		t = _thread;
+		_thread = 0;
+		_requests_available.signal ();
+	}
+
+	if (t) {
+		t->join ();
+	}
+}
+
+void
+BackgroundSync::queue (int fd, off_t offset, off_t length, bool drop_cache)
+{
+#ifdef PLATFORM_WINDOWS
+	/* nothing to gain, data is written through when the file is closed */
+	(void) fd;
+	(void) offset;
+	(void) length;
+	(void) drop_cache;
+#else
+	int const copy = ::dup (fd);
+
+	if (copy < 0) {
+		return;
+	}
+
+	Glib::Threads::Mutex::Lock lm (_lock);
+
+	if (_quit) {
+		lm.release ();
+		sync (Request (copy, offset, length, drop_cache));
+		return;
+	}
+
+	if (!_thread) {
+		_thread = Glib::Threads::Thread::create (boost::bind (&BackgroundSync::thread, this));
+	}
+
+	_requests.push_back (Request (copy, offset, length, drop_cache));
+	_requests_available.signal ();
+#endif
+}
+
+void
+BackgroundSync::wait ()
+{
+	Glib::Threads::Mutex::Lock lm (_lock);
+
+	while (_busy || !_requests.empty ()) {
+		_done.wait (_lock);
+	}
+}
+
+void
+BackgroundSync::thread ()
+{
+	pthread_set_name ("BackgroundSync");
+
+	Glib::Threads::Mutex::Lock lm (_lock);
+
+	while (true) {
+
+		while (_requests.empty () && !_quit) {
+			_requests_available.wait (_lock);
+		}
+
+		if (_requests.empty ()) {
+			/* asked to quit, and everything is synced */
+			_done.broadcast ();
+			break;
+		}
+
+		Request const r (_requests.front ());
+		_requests.pop_front ();
+		_busy = true;
+
+		lm.release ();
+		sync (r);
+		lm.acquire ();
+
+		_busy = false;
+		_done.broadcast ();
+	}
+}
+
+void
+BackgroundSync::sync (Request const& r)
+{
+#ifndef PLATFORM_WINDOWS
+#ifdef __linux__
+	if (r.length > 0) {
+		sync_file_range (r.fd, r.offset, r.length, SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+	} else {
+		fdatasync (r.fd);
+	}
+
+	if (r.drop_cache) {
+		posix_fadvise (r.fd, r.offset, r.length, POSIX_FADV_DONTNEED);
+	}
+#else
+	/* no range sync here, and syncing the whole file for every
+	   block would make things worse: only complete takes are synced.
+	*/
+	if (r.length == 0) {
+		fsync (r.fd);
+	}
+#endif
+	::close (r.fd);
+#else
+	(void) r;
+#endif
+}
@@ -38,7 +38,7 @@ BeatsSamplesConverter::to (Temporal::Beats beats) const
 		PBD::stacktrace (std::cerr, 30);
 		return 0;
 	}
-	return _tempo_map.samplepos_plus_qn (_origin_b, beats) - _origin_b;
+	return _tempo_map.samplepos_plus_qn_rt (_origin_b, beats) - _origin_b;
 }
 
 /** Takes a duration in samples and considers it as a distance from the origin
@@ -48,7 +48,7 @@ BeatsSamplesConverter::to (Temporal::Beats beats) const
 Temporal::Beats
 BeatsSamplesConverter::from (samplepos_t samples) const
 {
-	return _tempo_map.framewalk_to_qn (_origin_b, samples);
+	return _tempo_map.framewalk_to_qn_rt (_origin_b, samples);
 }
 
 /** As above, but with quarter-note beats in double instead (for GUI). */
@@ -60,14 +60,14 @@ DoubleBeatsSamplesConverter::to (double beats) const
 		PBD::stacktrace (std::cerr, 30);
 		return 0;
 	}
-	return _tempo_map.samplepos_plus_qn (_origin_b, Temporal::Beats(beats)) - _origin_b;
+	return _tempo_map.samplepos_plus_qn_rt (_origin_b, Temporal::Beats(beats)) - _origin_b;
 }
 
 /** As above, but with quarter-note beats in double instead (for GUI). */
 double
 DoubleBeatsSamplesConverter::from (samplepos_t samples) const
 {
-	return _tempo_map.framewalk_to_qn (_origin_b, samples).to_double();
+	return _tempo_map.framewalk_to_qn_rt (_origin_b, samples).to_double();
 }
 
 } /* namespace ARDOUR */
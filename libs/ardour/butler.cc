@@ -17,6 +17,7 @@
 
 */
 
+#include <algorithm>
 #include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -25,6 +26,7 @@
 #include <poll.h>
 #endif
 
+#include "pbd/cpus.h"
 #include "pbd/error.h"
 #include "pbd/pthread_utils.h"
 
@@ -33,6 +35,9 @@
 #include "ardour/disk_io.h"
 #include "ardour/disk_reader.h"
 #include "ardour/io.h"
+#include "ardour/io_tasklist.h"
+#include "ardour/location.h"
+#include "ardour/readahead_queue.h"
 #include "ardour/session.h"
 #include "ardour/track.h"
 #include "ardour/auditioner.h"
@@ -52,6 +57,10 @@ Butler::Butler(Session& s)
 	, midi_dstream_buffer_size(0)
 	, pool_trash(16)
 	, _xthread (true)
+	, _io_tasks (0)
+	, _readahead (0)
+	, _last_buffering_update (0)
+	, _last_buffering_adjustment (0)
 {
 	g_atomic_int_set(&should_do_transport_work, 0);
 	SessionEvent::pool->set_trash (&pool_trash);
@@ -128,6 +137,24 @@ Butler::start_thread()
 
 	should_run = false;
 
+	/* the butler itself takes part in parallel I/O, so it needs one
+	 * thread less than the configured count.
+	 */
+	if (!_io_tasks) {
+		uint32_t n_threads = Config->get_butler_threads ();
+		if (n_threads == 0) {
+			n_threads = std::max (1U, std::min (8U, hardware_concurrency () / 2));
+		}
+		_io_tasks = new IOTaskList (n_threads - 1);
+	}
+
+#ifdef __linux__
+	/* read-ahead hints need posix_fadvise() */
+	if (!_readahead) {
+		_readahead = new ReadaheadQueue;
+	}
+#endif
+
 	if (pthread_create_and_store ("disk butler", &thread, _thread_work, this)) {
 		error << _("Session: could not create butler thread") << endmsg;
 		return -1;
@@ -151,7 +178,12 @@ Butler::terminate_thread ()
                 DEBUG_TRACE (DEBUG::Butler, string_compose ("%1: ask butler to quit @ %2\n", DEBUG_THREAD_SELF, g_get_monotonic_time()));
 		queue_request (Request::Quit);
 		pthread_join (thread, &status);
+		have_thread = false;
 	}
+	delete _io_tasks;
+	_io_tasks = 0;
+	delete _readahead;
+	_readahead = 0;
 }
 
 void *
@@ -159,7 +191,10 @@ Butler::_thread_work (void* arg)
 {
 	SessionEvent::create_per_thread_pool ("butler events", 4096);
 	pthread_set_name (X_("butler"));
-	return ((Butler *) arg)->thread_work ();
+	DiskReader::allocate_working_buffers ();
+	void* rv = ((Butler *) arg)->thread_work ();
+	DiskReader::free_working_buffers ();
+	return rv;
 }
 
 void *
@@ -168,7 +203,6 @@ Butler::thread_work ()
 	uint32_t err = 0;
 
 	bool disk_work_outstanding = false;
-	RouteList::iterator i;
 
 	while (true) {
 		DEBUG_TRACE (DEBUG::Butler, string_compose ("%1 butler main loop, disk work outstanding ? %2 @ %3\n", DEBUG_THREAD_SELF, disk_work_outstanding, g_get_monotonic_time()));
@@ -231,7 +265,10 @@ Butler::thread_work ()
 
 		DEBUG_TRACE (DEBUG::Butler, string_compose ("butler starts refill loop, twr = %1\n", transport_work_requested()));
 
-		for (i = rl_with_auditioner.begin(); !transport_work_requested() && should_run && i != rl_with_auditioner.end(); ++i) {
+		std::vector<RefillJob> refill_jobs;
+		RefillAge ages;
+
+		for (RouteList::iterator i = rl_with_auditioner.begin(); i != rl_with_auditioner.end(); ++i) {
 
 			boost::shared_ptr<Track> tr = boost::dynamic_pointer_cast<Track> (*i);
 
@@ -246,8 +283,60 @@ Butler::thread_work ()
 				// DEBUG_TRACE (DEBUG::Butler, string_compose ("butler skips inactive track %1\n", tr->name()));
 				continue;
 			}
-			// DEBUG_TRACE (DEBUG::Butler, string_compose ("butler refills %1, playback load = %2\n", tr->name(), tr->playback_buffer_load()));
-			switch (tr->do_refill ()) {
+
+			/* the buffer that runs dry first is refilled first. Buffers
+			 * can differ in size (adaptive buffering), so this is the
+			 * audio left in them, not how full they are. Every pass that
+			 * a track was skipped (because transport work came in) counts
+			 * as one refill chunk less, so that full tracks are not
+			 * starved forever.
+			 */
+			RefillAge::const_iterator a = _refill_age.find (tr->id ());
+			uint32_t const age = (a == _refill_age.end ()) ? 0 : a->second;
+			boost::shared_ptr<DiskReader> dr = tr->disk_reader ();
+
+			refill_jobs.push_back (RefillJob (tr, dr->samples_until_underrun () - age * dr->refill_chunk_samples ()));
+			ages[tr->id ()] = age;
+		}
+
+		std::stable_sort (refill_jobs.begin (), refill_jobs.end (), RefillJob::MoreUrgent ());
+
+		/* let the kernel know about the reads of all tracks at once,
+		 * before the refills go through them one by one.
+		 */
+		if (_readahead && Config->get_disk_readahead () && should_run && !transport_work_requested ()) {
+			for (size_t n = 0; n < refill_jobs.size (); ++n) {
+				refill_jobs[n].track->disk_reader ()->collect_readahead (*_readahead);
+			}
+			_readahead->submit ();
+		} else if (_readahead) {
+			/* do not hold files open while not reading ahead */
+			_readahead->close_files ();
+		}
+
+		/* refill all tracks, in parallel if there are I/O threads.
+		 * Tracks that were skipped because transport work came
+		 * in, or the butler was paused, report refill_skipped.
+		 */
+
+		std::vector<int> refill_results (refill_jobs.size (), 0);
+
+		for (size_t n = 0; n < refill_jobs.size (); ++n) {
+			_io_tasks->push_back (boost::bind (&Butler::refill_track, this, refill_jobs[n].track, &refill_results[n]));
+		}
+
+		_io_tasks->process ();
+
+		for (size_t n = 0; n < refill_jobs.size (); ++n) {
+			boost::shared_ptr<Track> tr = refill_jobs[n].track;
+
+			if (refill_results[n] == refill_skipped) {
+				++ages[tr->id ()];
+			} else {
+				ages[tr->id ()] = 0;
+			}
+
+			switch (refill_results[n]) {
 			case 0:
 				//DEBUG_TRACE (DEBUG::Butler, string_compose ("\ttrack refill done %1\n", tr->name()));
 				break;
@@ -257,18 +346,20 @@ Butler::thread_work ()
 				disk_work_outstanding = true;
 				break;
 
+			case refill_skipped:
+				DEBUG_TRACE (DEBUG::Butler, string_compose ("\ttrack refill deferred %1, %2 times\n", tr->name(), ages[tr->id ()]));
+				disk_work_outstanding = true;
+				break;
+
 			default:
-				error << string_compose(_("Butler read ahead failure on dstream %1"), (*i)->name()) << endmsg;
-                                std::cerr << string_compose(_("Butler read ahead failure on dstream %1"), (*i)->name()) << std::endl;
+				error << string_compose(_("Butler read ahead failure on dstream %1"), tr->name()) << endmsg;
+                                std::cerr << string_compose(_("Butler read ahead failure on dstream %1"), tr->name()) << std::endl;
 				break;
 			}
-
 		}
 
-		if (i != rl_with_auditioner.begin() && i != rl_with_auditioner.end()) {
-			/* we didn't get to all the streams */
-			disk_work_outstanding = true;
-		}
+		/* this also forgets about removed tracks */
+		_refill_age.swap (ages);
 
 		if (!err && transport_work_requested()) {
 			DEBUG_TRACE (DEBUG::Butler, "transport work requested during refill, back to restart\n");
@@ -290,6 +381,17 @@ Butler::thread_work ()
 			goto restart;
 		}
 
+		if (!disk_work_outstanding && !transport_work_requested()) {
+			update_adaptive_buffering (rl);
+		}
+
+		if (!disk_work_outstanding && should_run && !transport_work_requested()) {
+			/* nothing urgent left: use the time to read ahead
+			   at the places we are likely to locate to next.
+			*/
+			disk_work_outstanding = update_locate_prefetch (rl);
+		}
+
 		if (!disk_work_outstanding) {
 			_session.refresh_disk_space ();
 		}
@@ -317,39 +419,55 @@ Butler::thread_work ()
 bool
 Butler::flush_tracks_to_disk_normal (boost::shared_ptr<RouteList> rl, uint32_t& errors)
 {
-	bool disk_work_outstanding = false;
-
-	for (RouteList::iterator i = rl->begin(); !transport_work_requested() && should_run && i != rl->end(); ++i) {
+	return flush_tracks_to_disk (rl, errors, false);
+}
 
-		// cerr << "write behind for " << (*i)->name () << endl;
+bool
+Butler::flush_tracks_to_disk_after_locate (boost::shared_ptr<RouteList> rl, uint32_t& errors)
+{
+	/* almost the same as the "normal" version except that we do not test
+	 * for transport_work_requested() and we force flushes.
+	 */
+	return flush_tracks_to_disk (rl, errors, true);
+}
 
-		boost::shared_ptr<Track> tr = boost::dynamic_pointer_cast<Track> (*i);
+bool
+Butler::flush_tracks_to_disk (boost::shared_ptr<RouteList> rl, uint32_t& errors, bool after_locate)
+{
+	bool disk_work_outstanding = false;
 
-		if (!tr) {
-			continue;
-		}
+	std::vector<boost::shared_ptr<Track> > tracks;
 
+	for (RouteList::iterator i = rl->begin(); i != rl->end(); ++i) {
+		boost::shared_ptr<Track> tr = boost::dynamic_pointer_cast<Track> (*i);
 		/* note that we still try to flush diskstreams attached to inactive routes
 		 */
+		if (tr) {
+			tracks.push_back (tr);
+		}
+	}
+
+	std::vector<int> results (tracks.size (), 0);
 
-		int ret;
+	for (size_t n = 0; n < tracks.size (); ++n) {
+		_io_tasks->push_back (boost::bind (&Butler::flush_track, this, tracks[n], after_locate, &results[n]));
+	}
 
-		// DEBUG_TRACE (DEBUG::Butler, string_compose ("butler flushes track %1 capture load %2\n", tr->name(), tr->capture_buffer_load()));
-		ret = tr->do_flush (ButlerContext, false);
-		switch (ret) {
+	_io_tasks->process ();
+
+	for (size_t n = 0; n < tracks.size (); ++n) {
+		switch (results[n]) {
 		case 0:
-			//DEBUG_TRACE (DEBUG::Butler, string_compose ("\tflush complete for %1\n", tr->name()));
 			break;
 
 		case 1:
-			//DEBUG_TRACE (DEBUG::Butler, string_compose ("\tflush not finished for %1\n", tr->name()));
 			disk_work_outstanding = true;
 			break;
 
 		default:
 			errors++;
-			error << string_compose(_("Butler write-behind failure on dstream %1"), (*i)->name()) << endmsg;
-			std::cerr << string_compose(_("Butler write-behind failure on dstream %1"), (*i)->name()) << std::endl;
+			error << string_compose(_("Butler write-behind failure on dstream %1"), tracks[n]->name()) << endmsg;
+			std::cerr << string_compose(_("Butler write-behind failure on dstream %1"), tracks[n]->name()) << std::endl;
 			/* don't break - try to flush all streams in case they
 			   are split across disks.
 			*/
@@ -359,53 +477,203 @@ Butler::flush_tracks_to_disk_normal (boost::shared_ptr<RouteList> rl, uint32_t&
 	return disk_work_outstanding;
 }
 
-bool
-Butler::flush_tracks_to_disk_after_locate (boost::shared_ptr<RouteList> rl, uint32_t& errors)
+void
+Butler::flush_track (boost::shared_ptr<Track> tr, bool after_locate, int* result)
 {
-	bool disk_work_outstanding = false;
+	/* runs in the butler thread or one of its I/O threads */
 
-	/* almost the same as the "normal" version except that we do not test
-	 * for transport_work_requested() and we force flushes.
-	 */
+	if (!after_locate && (transport_work_requested() || !should_run)) {
+		/* come back later */
+		*result = 1;
+		return;
+	}
 
-	for (RouteList::iterator i = rl->begin(); i != rl->end(); ++i) {
+	// DEBUG_TRACE (DEBUG::Butler, string_compose ("butler flushes track %1 capture load %2\n", tr->name(), tr->capture_buffer_load()));
+	*result = tr->do_flush (ButlerContext, after_locate);
+}
 
-		// cerr << "write behind for " << (*i)->name () << endl;
+/** Size each track's playback buffer after how long refills from its
+ *  device take: the buffer has to last until the butler is back after
+ *  refilling all other tracks on that device, even if this track's
+ *  next refill is as slow as its slowest recent one.
+ *
+ *  New sizes are applied with the transport stopped only, since that
+ *  reallocates the buffers and refills them.
+ */
+void
+Butler::update_adaptive_buffering (boost::shared_ptr<RouteList> rl)
+{
+	gint64 const now = g_get_monotonic_time ();
 
-		boost::shared_ptr<Track> tr = boost::dynamic_pointer_cast<Track> (*i);
+	if (!Config->get_adaptive_buffering () || now - _last_buffering_update < 1000000) {
+		return;
+	}
 
-		if (!tr) {
+	_last_buffering_update = now;
+
+	std::vector<boost::shared_ptr<DiskReader> > readers;
+	std::vector<DiskReader::RefillStats> stats;
+	std::vector<uint64_t> devices;
+	DeviceStatsMap ds;
+
+	for (RouteList::iterator i = rl->begin(); i != rl->end(); ++i) {
+		boost::shared_ptr<Track> tr = boost::dynamic_pointer_cast<Track> (*i);
+		if (!tr || !tr->disk_reader ()) {
 			continue;
 		}
+		boost::shared_ptr<DiskReader> dr = tr->disk_reader ();
+		readers.push_back (dr);
+		stats.push_back (dr->refill_stats ());
+		devices.push_back (dr->io_device ());
+
+		DeviceStats& d (ds[devices.back ()]);
+		++d.tracks;
+		d.refill_us += stats.back ().avg_us;
+		d.bytes_per_sec += stats.back ().bytes_per_sec;
+	}
 
-		/* note that we still try to flush diskstreams attached to inactive routes
-		 */
+	double const rate = _session.sample_rate ();
+	samplecnt_t const min_size = audio_dstream_playback_buffer_size;
+	samplecnt_t const max_size = std::max (min_size, (samplecnt_t) (Config->get_adaptive_buffering_max_seconds () * rate));
 
-		int ret;
+	std::vector<samplecnt_t> targets (readers.size (), min_size);
+	double bytes = 0;
+	double min_bytes = 0;
 
-		DEBUG_TRACE (DEBUG::Butler, string_compose ("butler flushes track %1 capture load %2\n", tr->name(), tr->capture_buffer_load()));
-		ret = tr->do_flush (ButlerContext, true);
-		switch (ret) {
-		case 0:
-			DEBUG_TRACE (DEBUG::Butler, string_compose ("\tflush complete for %1\n", tr->name()));
-			break;
+	for (size_t n = 0; n < readers.size (); ++n) {
+		if (stats[n].refills > 0) {
+			double const secs = 4. * (ds[devices[n]].refill_us + stats[n].max_us) / 1e6;
+			targets[n] = std::min (max_size, std::max (min_size, (samplecnt_t) (secs * rate)));
+		}
+		size_t const chans = readers[n]->n_buffers ();
+		bytes += (double) targets[n] * chans * sizeof (Sample);
+		min_bytes += (double) min_size * chans * sizeof (Sample);
+	}
 
-		case 1:
-			DEBUG_TRACE (DEBUG::Butler, string_compose ("\tflush not finished for %1\n", tr->name()));
-			disk_work_outstanding = true;
-			break;
+	double const budget = Config->get_adaptive_buffering_max_mb () * 1048576.;
 
-		default:
-			errors++;
-			error << string_compose(_("Butler write-behind failure on dstream %1"), (*i)->name()) << endmsg;
-			std::cerr << string_compose(_("Butler write-behind failure on dstream %1"), (*i)->name()) << std::endl;
-			/* don't break - try to flush all streams in case they
-			   are split across disks.
-			*/
+	if (bytes > budget) {
+		/* share what is left of the budget in proportion to what each track wants beyond the minimum */
+		double const scale = budget > min_bytes ? (budget - min_bytes) / (bytes - min_bytes) : 0;
+		for (size_t n = 0; n < targets.size (); ++n) {
+			targets[n] = min_size + (samplecnt_t) ((targets[n] - min_size) * scale);
 		}
 	}
 
-	return disk_work_outstanding;
+	bool adjust = false;
+
+	for (size_t n = 0; n < readers.size (); ++n) {
+		readers[n]->set_target_buffer_size (targets[n]);
+		samplecnt_t const current = readers[n]->buffer_size ();
+		samplecnt_t const diff = targets[n] > current ? targets[n] - current : current - targets[n];
+		if (current > 0 && diff > current / 4) {
+			adjust = true;
+		}
+	}
+
+	{
+		Glib::Threads::Mutex::Lock lm (_device_stats_lock);
+		_device_stats.swap (ds);
+	}
+
+	if (adjust && _session.transport_stopped () && !_session.actively_recording () && now - _last_buffering_adjustment > 10000000) {
+		DEBUG_TRACE (DEBUG::Butler, "adaptive buffering: resize playback buffers\n");
+		_last_buffering_adjustment = now;
+		_session.schedule_playback_buffering_adjustment ();
+	}
+}
+
+Butler::DeviceStatsMap
+Butler::device_stats () const
+{
+	Glib::Threads::Mutex::Lock lm (_device_stats_lock);
+	return _device_stats;
+}
+
+/** Collect the positions that a locate is likely to go to: markers,
+ *  the start of range markers, the loop start and the session start.
+ */
+void
+Butler::locate_prefetch_points (std::vector<samplepos_t>& points) const
+{
+	Locations::LocationList const ll (_session.locations()->list ());
+
+	for (Locations::LocationList::const_iterator i = ll.begin (); i != ll.end (); ++i) {
+		Location const* l = *i;
+		if (l->is_mark () || l->is_range_marker () || l->is_auto_loop () || l->is_session_range ()) {
+			points.push_back (l->start ());
+		}
+	}
+
+	std::sort (points.begin (), points.end ());
+	points.erase (std::unique (points.begin (), points.end ()), points.end ());
+}
+
+/** @return true if there is more prefetching to do */
+bool
+Butler::update_locate_prefetch (boost::shared_ptr<RouteList> rl)
+{
+	std::vector<samplepos_t> points;
+
+	if (Config->get_locate_prefetch_seconds () > 0) {
+		locate_prefetch_points (points);
+	}
+
+	std::vector<boost::shared_ptr<Track> > tracks;
+
+	for (RouteList::iterator i = rl->begin(); i != rl->end(); ++i) {
+		boost::shared_ptr<Track> tr = boost::dynamic_pointer_cast<Track> (*i);
+		if (tr) {
+			if (!tr->disk_reader ()->refill_satisfied ()) {
+				/* a refill comes first */
+				return false;
+			}
+			tracks.push_back (tr);
+		}
+	}
+
+	std::vector<int> more (tracks.size (), 0);
+
+	for (size_t n = 0; n < tracks.size (); ++n) {
+		_io_tasks->push_back (boost::bind (&Butler::prefetch_track, this, tracks[n], &points, &more[n]));
+	}
+
+	_io_tasks->process ();
+
+	for (size_t n = 0; n < tracks.size (); ++n) {
+		if (more[n]) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void
+Butler::prefetch_track (boost::shared_ptr<Track> tr, std::vector<samplepos_t> const* points, int* more)
+{
+	/* runs in the butler thread or one of its I/O threads */
+
+	if (transport_work_requested() || !should_run) {
+		return;
+	}
+
+	*more = tr->update_locate_prefetch (*points);
+}
+
+void
+Butler::refill_track (boost::shared_ptr<Track> tr, int* result)
+{
+	/* runs in the butler thread or one of its I/O threads */
+
+	if (transport_work_requested() || !should_run) {
+		/* we didn't get to this stream */
+		*result = refill_skipped;
+		return;
+	}
+
+	// DEBUG_TRACE (DEBUG::Butler, string_compose ("butler refills %1, playback load = %2\n", tr->name(), tr->playback_buffer_load()));
+	*result = tr->do_refill ();
 }
 
 void
@@ -17,21 +17,29 @@
 
 */
 
+#include <glib/gstdio.h>
+#include <glibmm/threads.h>
+
 #include "pbd/enumwriter.h"
 #include "pbd/memento_command.h"
 
 #include "ardour/audioengine.h"
 #include "ardour/audioplaylist.h"
+#include "ardour/audio_block_cache.h"
 #include "ardour/audio_buffer.h"
+#include "ardour/audioregion.h"
+#include "ardour/audiosource.h"
 #include "ardour/butler.h"
 #include "ardour/debug.h"
 #include "ardour/disk_reader.h"
+#include "ardour/file_source.h"
 #include "ardour/midi_ring_buffer.h"
 #include "ardour/midi_playlist.h"
 #include "ardour/midi_track.h"
 #include "ardour/pannable.h"
 #include "ardour/playlist.h"
 #include "ardour/playlist_factory.h"
+#include "ardour/readahead_queue.h"
 #include "ardour/session.h"
 #include "ardour/session_playlists.h"
 
@@ -43,10 +51,9 @@ using namespace std;
 
 ARDOUR::samplecnt_t DiskReader::_chunk_samples = default_chunk_samples ();
 PBD::Signal0<void> DiskReader::Underrun;
-Sample* DiskReader::_mixdown_buffer = 0;
-gain_t* DiskReader::_gain_buffer = 0;
 samplecnt_t DiskReader::midi_readahead = 4096;
 bool DiskReader::_no_disk_output = false;
+const float DiskReader::near_underrun_threshold = 0.1;
 
 DiskReader::DiskReader (Session& s, string const & str, DiskIOProcessor::Flag f)
 	: DiskIOProcessor (s, str, f)
@@ -54,6 +61,18 @@ DiskReader::DiskReader (Session& s, string const & str, DiskIOProcessor::Flag f)
 	, overwrite_offset (0)
 	, _pending_overwrite (false)
 	, overwrite_queued (false)
+	, _underruns (0)
+	, _near_underruns (0)
+	, _near_underrun (false)
+	, _loop_cache_invalid (0)
+	, _target_buffer_size (0)
+	, _refill_chunk (0)
+	, _io_device (0)
+	, _io_device_invalid (1)
+	, _locate_prefetch (new LocatePrefetches)
+	, _locate_prefetch_invalid (0)
+	, _locate_prefetch_pending_point (0)
+	, _locate_prefetch_pending_done (0)
 {
 	file_sample[DataType::AUDIO] = 0;
 	file_sample[DataType::MIDI] = 0;
@@ -63,6 +82,9 @@ DiskReader::~DiskReader ()
 {
 	DEBUG_TRACE (DEBUG::Destruction, string_compose ("DiskReader %1 @ %2 deleted\n", _name, this));
 
+	drop_locate_prefetch ();
+	drop_loop_cache ();
+
 	for (uint32_t n = 0; n < DataType::num_types; ++n) {
 		if (_playlists[n]) {
 			_playlists[n]->release ();
@@ -85,25 +107,42 @@ DiskReader::~DiskReader ()
 	delete _midi_buf;
 }
 
+namespace {
+
+/** Per-thread scratch buffers for refills */
+struct WorkingBuffers {
+	WorkingBuffers (samplecnt_t n)
+		: size (n)
+		, mixdown (new Sample[n])
+		, gain (new gain_t[n])
+	{}
+
+	~WorkingBuffers () {
+		delete [] mixdown;
+		delete [] gain;
+	}
+
+	samplecnt_t size;
+	Sample* mixdown;
+	gain_t* gain;
+};
+
+Glib::Threads::Private<WorkingBuffers> thread_working_buffers;
+
+}
+
 void
-DiskReader::allocate_working_buffers()
+DiskReader::allocate_working_buffers (samplecnt_t size)
 {
-	/* with varifill buffer refilling, we compute the read size in bytes (to optimize
-	   for disk i/o bandwidth) and then convert back into samples. These buffers
-	   need to reflect the maximum size we could use, which is 4MB reads, or 2M samples
-	   using 16 bit samples.
-	*/
-	_mixdown_buffer       = new Sample[2*1048576];
-	_gain_buffer          = new gain_t[2*1048576];
+	if (!thread_working_buffers.get ()) {
+		thread_working_buffers.set (new WorkingBuffers (size));
+	}
 }
 
 void
 DiskReader::free_working_buffers()
 {
-	delete [] _mixdown_buffer;
-	delete [] _gain_buffer;
-	_mixdown_buffer       = 0;
-	_gain_buffer          = 0;
+	thread_working_buffers.replace (0);
 }
 
 samplecnt_t
@@ -177,14 +216,120 @@ DiskReader::buffer_load () const
 	return (float) ((double) b->read_space() / (double) b->bufsize());
 }
 
+samplecnt_t
+DiskReader::samples_until_underrun () const
+{
+	boost::shared_ptr<ChannelList> c = channels.reader();
+
+	if (c->empty ()) {
+		return max_samplecnt;
+	}
+
+	return c->front()->buf->read_space();
+}
+
+void
+DiskReader::reset_underrun_counters ()
+{
+	g_atomic_int_set (&_underruns, 0);
+	g_atomic_int_set (&_near_underruns, 0);
+}
+
 void
 DiskReader::adjust_buffering ()
 {
 	boost::shared_ptr<ChannelList> c = channels.reader();
+	samplecnt_t size = _session.butler()->audio_diskstream_playback_buffer_size();
+
+	if (Config->get_adaptive_buffering () && _target_buffer_size > 0) {
+		size = _target_buffer_size;
+		/* slower media get bigger buffers, and are read in bigger chunks */
+		_refill_chunk = max (_chunk_samples, size / 8);
+	} else {
+		_refill_chunk = 0;
+	}
 
 	for (ChannelList::iterator chan = c->begin(); chan != c->end(); ++chan) {
-		(*chan)->resize (_session.butler()->audio_diskstream_playback_buffer_size());
+		(*chan)->resize (size);
+	}
+}
+
+samplecnt_t
+DiskReader::buffer_size () const
+{
+	boost::shared_ptr<ChannelList> c = channels.reader();
+
+	if (c->empty ()) {
+		return 0;
+	}
+
+	return c->front()->buf->bufsize ();
+}
+
+void
+DiskReader::update_refill_stats (int64_t elapsed_us, size_t bytes)
+{
+	if (bytes == 0 || elapsed_us < 0) {
+		return;
+	}
+
+	Glib::Threads::Mutex::Lock lm (_refill_stats_lock);
+	RefillStats& s (_refill_stats);
+
+	double const bps = elapsed_us > 0 ? bytes * 1e6 / elapsed_us : 0;
+
+	if (s.refills == 0) {
+		s.avg_us = elapsed_us;
+		s.bytes_per_sec = bps;
+	} else {
+		s.avg_us += .1 * (elapsed_us - s.avg_us);
+		if (bps > 0) {
+			s.bytes_per_sec += .1 * (bps - s.bytes_per_sec);
+		}
+	}
+
+	/* the peak decays, so that a single stall is forgotten eventually */
+	s.max_us = max ((double) elapsed_us, s.max_us * .98);
+	++s.refills;
+}
+
+DiskReader::RefillStats
+DiskReader::refill_stats () const
+{
+	Glib::Threads::Mutex::Lock lm (_refill_stats_lock);
+	return _refill_stats;
+}
+
+/** @return the device that the first region of our audio playlist is read from,
+ *  or 0 if that is unknown. Call from the butler only.
+ */
+uint64_t
+DiskReader::io_device ()
+{
+	if (!g_atomic_int_compare_and_exchange (&_io_device_invalid, 1, 0)) {
+		return _io_device;
+	}
+
+	_io_device = 0;
+
+	boost::shared_ptr<AudioPlaylist> pl = audio_playlist ();
+
+	if (!pl) {
+		return 0;
+	}
+
+	boost::shared_ptr<RegionList> rl = pl->regions_touched (0, max_samplepos);
+
+	for (RegionList::const_iterator r = rl->begin(); r != rl->end(); ++r) {
+		boost::shared_ptr<FileSource> fs = boost::dynamic_pointer_cast<FileSource> ((*r)->source (0));
+		GStatBuf sb;
+		if (fs && g_stat (fs->path().c_str(), &sb) == 0) {
+			_io_device = sb.st_dev;
+			break;
+		}
 	}
+
+	return _io_device;
 }
 
 void
@@ -196,6 +341,10 @@ DiskReader::playlist_changed (const PropertyChange&)
 void
 DiskReader::playlist_modified ()
 {
+	g_atomic_int_set (&_loop_cache_invalid, 1);
+	g_atomic_int_set (&_locate_prefetch_invalid, 1);
+	g_atomic_int_set (&_io_device_invalid, 1);
+
 	if (!i_am_the_modifier && !overwrite_queued) {
 		_session.request_overwrite_buffer (_route);
 		overwrite_queued = true;
@@ -215,6 +364,10 @@ DiskReader::use_playlist (DataType dt, boost::shared_ptr<Playlist> playlist)
 		return -1;
 	}
 
+	g_atomic_int_set (&_loop_cache_invalid, 1);
+	g_atomic_int_set (&_locate_prefetch_invalid, 1);
+	g_atomic_int_set (&_io_device_invalid, 1);
+
 	/* don't do this if we've already asked for it *or* if we are setting up
 	   the diskstream for the very first time - the input changed handling will
 	   take care of the buffer refill.
@@ -387,6 +540,7 @@ DiskReader::run (BufferSet& bufs, samplepos_t start_sample, samplepos_t end_samp
 					cerr << "underrun for " << _name << endl;
 					DEBUG_TRACE (DEBUG::Butler, string_compose ("%1 underrun in %2, total space = %3\n",
 					                                            DEBUG_THREAD_SELF, name(), total));
+					g_atomic_int_inc (&_underruns);
 					Underrun ();
 					return;
 
@@ -444,9 +598,18 @@ DiskReader::run (BufferSet& bufs, samplepos_t start_sample, samplepos_t end_samp
 						butler_required = true;
 					}
 				} else {
-					if ((samplecnt_t) c->front()->buf->write_space() >= _chunk_samples) {
+					/* count each time the buffer gets close to running dry */
+					const float load = (float) c->front()->buf->read_space() / (float) c->front()->buf->bufsize();
+					if (!_near_underrun && load < near_underrun_threshold) {
+						_near_underrun = true;
+						g_atomic_int_inc (&_near_underruns);
+					} else if (_near_underrun && load >= 2.f * near_underrun_threshold) {
+						_near_underrun = false;
+					}
+
+					if ((samplecnt_t) c->front()->buf->write_space() >= refill_chunk_samples ()) {
 						DEBUG_TRACE (DEBUG::Butler, string_compose ("%1: write space = %2 of %3\n", name(), c->front()->buf->write_space(),
-						                                            _chunk_samples));
+						                                            refill_chunk_samples ()));
 						butler_required = true;
 					}
 				}
@@ -654,11 +817,24 @@ DiskReader::seek (samplepos_t sample, bool complete_refill)
 	file_sample[DataType::AUDIO] = sample;
 	file_sample[DataType::MIDI] = sample;
 
+	{
+		Glib::Threads::Mutex::Lock lm (_locate_history_lock);
+		_locate_history[sample] = g_get_monotonic_time ();
+	}
+
+	samplecnt_t const resident = locate_prefetch_available (sample);
+	samplecnt_t const space = c->empty () ? 0 : c->front()->buf->write_space ();
+
 	if (complete_refill) {
 		/* call _do_refill() to refill the entire buffer, using
 		   the largest reads possible.
 		*/
 		while ((ret = do_refill_with_alloc (false)) > 0) ;
+	} else if (resident >= refill_chunk_samples () && resident < space) {
+		/* only fill what is in memory, so that the locate does not
+		   wait for the disk. The butler reads the rest as usual.
+		*/
+		ret = refill_with_alloc (space - resident);
 	} else {
 		/* call _do_refill() to refill just one chunk, and then
 		   return.
@@ -769,6 +945,7 @@ DiskReader::audio_read (Sample* buf, Sample* mixdown_buffer, float* gain_buffer,
 			start = loop_start + ((start - loop_start) % loop_length);
 		}
 
+		update_loop_cache (loop_start, loop_end);
 	}
 
 	if (reversed) {
@@ -797,10 +974,20 @@ DiskReader::audio_read (Sample* buf, Sample* mixdown_buffer, float* gain_buffer,
 
 		this_read = min(cnt,this_read);
 
-		if (audio_playlist()->read (buf+offset, mixdown_buffer, gain_buffer, start, this_read, channel) != this_read) {
-			error << string_compose(_("DiskReader %1: cannot read %2 from playlist at sample %3"), id(), this_read,
-					 start) << endmsg;
-			return -1;
+		if (loc && !reversed && loop_cache_read (buf+offset, start, this_read, channel)) {
+			/* served from memory */
+		} else if (!reversed && locate_prefetch_read (buf+offset, start, this_read, channel)) {
+			/* likewise */
+		} else {
+			if (audio_playlist()->read (buf+offset, mixdown_buffer, gain_buffer, start, this_read, channel) != this_read) {
+				error << string_compose(_("DiskReader %1: cannot read %2 from playlist at sample %3"), id(), this_read,
+				                        start) << endmsg;
+				return -1;
+			}
+
+			if (loc && !reversed) {
+				loop_cache_store (buf+offset, start, this_read, channel);
+			}
 		}
 
 		if (reversed) {
@@ -825,9 +1012,512 @@ DiskReader::audio_read (Sample* buf, Sample* mixdown_buffer, float* gain_buffer,
 	return 0;
 }
 
+/** audio_read() in pieces of at most @a mixdown_size samples, the size of
+ *  @a mixdown_buffer and @a gain_buffer.
+ */
+int
+DiskReader::audio_read_in_pieces (Sample* buf, Sample* mixdown_buffer, float* gain_buffer, samplecnt_t mixdown_size,
+                                  samplepos_t& start, samplecnt_t cnt,
+                                  int channel, bool reversed)
+{
+	while (cnt) {
+		samplecnt_t const n = min (cnt, mixdown_size);
+
+		if (audio_read (buf, mixdown_buffer, gain_buffer, start, n, channel, reversed)) {
+			return -1;
+		}
+
+		buf += n;
+		cnt -= n;
+	}
+
+	return 0;
+}
+
+void
+DiskReader::LoopCache::clear ()
+{
+	/* release the memory, not just the contents */
+	std::vector<std::vector<Sample> > ().swap (data);
+	std::vector<samplecnt_t> ().swap (filled);
+}
+
+/** Release the loop cache, and its share of the session's budget */
+void
+DiskReader::drop_loop_cache ()
+{
+	_loop_cache.clear ();
+
+	if (_loop_cache.kb) {
+		_session.release_loop_cache (_loop_cache.kb);
+	}
+
+	_loop_cache.start = _loop_cache.end = 0;
+	_loop_cache.n_channels = 0;
+	_loop_cache.kb = 0;
+}
+
+/** Drop the loop cache if the playlist changed, or if the loop range is not
+ *  the cached one (any more). @a loop_end == @a loop_start means no loop.
+ *  A new loop range is only cached if it fits into what is left of
+ *  RCConfiguration::loop_in_ram_max_mb for the whole session; if it does
+ *  not, the next call tries again.
+ */
+void
+DiskReader::update_loop_cache (samplepos_t loop_start, samplepos_t loop_end)
+{
+	if (g_atomic_int_compare_and_exchange (&_loop_cache_invalid, 1, 0)) {
+		drop_loop_cache ();
+	}
+
+	if (loop_end <= loop_start || !Config->get_loop_in_ram ()) {
+		drop_loop_cache ();
+		return;
+	}
+
+	if (_loop_cache.kb && _loop_cache.start == loop_start && _loop_cache.end == loop_end) {
+		return;
+	}
+
+	drop_loop_cache ();
+
+	uint32_t const n_channels = channels.reader()->size ();
+	uint64_t const bytes = (uint64_t) (loop_end - loop_start) * sizeof (Sample) * n_channels;
+
+	if (n_channels == 0 || bytes > (uint64_t) Config->get_loop_in_ram_max_mb () * 1048576) {
+		return;
+	}
+
+	gint const kb = (gint) ((bytes + 1023) / 1024);
+
+	if (!_session.reserve_loop_cache (kb)) {
+		return;
+	}
+
+	_loop_cache.start = loop_start;
+	_loop_cache.end = loop_end;
+	_loop_cache.n_channels = n_channels;
+	_loop_cache.kb = kb;
+}
+
+/** @return true if [start, start + cnt) of @a channel was copied from the loop cache */
+bool
+DiskReader::loop_cache_read (Sample* buf, samplepos_t start, samplecnt_t cnt, int channel) const
+{
+	if ((size_t) channel >= _loop_cache.filled.size () || start < _loop_cache.start) {
+		return false;
+	}
+
+	samplecnt_t const offset = start - _loop_cache.start;
+
+	if (offset + cnt > _loop_cache.filled[channel]) {
+		return false;
+	}
+
+	memcpy (buf, &_loop_cache.data[channel][offset], sizeof (Sample) * cnt);
+	return true;
+}
+
+/** Add data read from the playlist to the loop cache, if it continues what
+ *  has been cached of @a channel so far.
+ */
+void
+DiskReader::loop_cache_store (Sample const* buf, samplepos_t start, samplecnt_t cnt, int channel)
+{
+	if (_loop_cache.end <= _loop_cache.start) {
+		return;
+	}
+
+	samplepos_t const from = max (start, _loop_cache.start);
+	samplepos_t const to = min (start + cnt, _loop_cache.end);
+
+	if (channel < 0 || (uint32_t) channel >= _loop_cache.n_channels || from >= to) {
+		return;
+	}
+
+	if (_loop_cache.filled.size () <= (size_t) channel) {
+		_loop_cache.data.resize (channel + 1);
+		_loop_cache.filled.resize (channel + 1, 0);
+	}
+
+	samplepos_t const filled_to = _loop_cache.start + _loop_cache.filled[channel];
+
+	if (from > filled_to || to <= filled_to) {
+		/* not adjacent, or nothing new */
+		return;
+	}
+
+	std::vector<Sample>& d (_loop_cache.data[channel]);
+
+	if (d.empty ()) {
+		d.resize (_loop_cache.end - _loop_cache.start);
+	}
+
+	memcpy (&d[filled_to - _loop_cache.start], buf + (filled_to - start), sizeof (Sample) * (to - filled_to));
+	_loop_cache.filled[channel] = to - _loop_cache.start;
+}
+
+bool
+DiskReader::refill_satisfied () const
+{
+	boost::shared_ptr<ChannelList> c = channels.reader();
+
+	return c->empty () || c->front()->buf->write_space () < refill_chunk_samples ();
+}
+
+void
+DiskReader::drop_locate_prefetch (LocatePrefetches& lp, LocatePrefetches::iterator i)
+{
+	_session.release_locate_prefetch ((gint) ((i->second->length * i->second->data.size () * sizeof (Sample)) / 1024));
+	lp.erase (i);
+}
+
+void
+DiskReader::drop_locate_prefetch ()
+{
+	drop_pending_locate_prefetch ();
+
+	RCUWriter<LocatePrefetches> writer (_locate_prefetch);
+	boost::shared_ptr<LocatePrefetches> lp = writer.get_copy ();
+
+	while (!lp->empty ()) {
+		drop_locate_prefetch (*lp, lp->begin ());
+	}
+}
+
+void
+DiskReader::drop_pending_locate_prefetch ()
+{
+	if (_locate_prefetch_pending) {
+		_session.release_locate_prefetch ((gint) ((_locate_prefetch_pending->length * _locate_prefetch_pending->data.size () * sizeof (Sample)) / 1024));
+		_locate_prefetch_pending.reset ();
+	}
+}
+
+/** orders locate points by when they were last located to, most recent
+ *  first, then by position.
+ */
+struct LocatePointOrder {
+	LocatePointOrder (std::map<samplepos_t, gint64> const& h) : history (h) {}
+
+	gint64 used (samplepos_t p) const {
+		std::map<samplepos_t, gint64>::const_iterator i = history.find (p);
+		return i == history.end () ? 0 : i->second;
+	}
+
+	bool operator() (samplepos_t a, samplepos_t b) const {
+		gint64 const ua = used (a);
+		gint64 const ub = used (b);
+		return ua != ub ? ua > ub : a < b;
+	}
+
+	std::map<samplepos_t, gint64> const& history;
+};
+
+bool
+DiskReader::update_locate_prefetch (std::vector<samplepos_t> const& points)
+{
+	boost::shared_ptr<AudioPlaylist> pl = audio_playlist ();
+	samplecnt_t const length = Config->get_locate_prefetch_seconds () * _session.nominal_sample_rate ();
+	size_t const n_chans = channels.reader()->size ();
+	bool const invalid = g_atomic_int_get (&_locate_prefetch_invalid);
+	gint const kb = (gint) ((length * n_chans * sizeof (Sample)) / 1024);
+
+	std::vector<samplepos_t> wanted (points);
+
+	{
+		Glib::Threads::Mutex::Lock lm (_locate_history_lock);
+
+		for (std::map<samplepos_t, gint64>::iterator i = _locate_history.begin (); i != _locate_history.end (); ) {
+			if (!std::binary_search (points.begin (), points.end (), i->first)) {
+				_locate_history.erase (i++);
+			} else {
+				++i;
+			}
+		}
+
+		std::sort (wanted.begin (), wanted.end (), LocatePointOrder (_locate_history));
+	}
+
+	if (invalid || !pl || (_locate_prefetch_pending &&
+	                       (_locate_prefetch_pending->length != length || _locate_prefetch_pending->data.size () != n_chans ||
+	                        !std::binary_search (points.begin (), points.end (), _locate_prefetch_pending_point)))) {
+		drop_pending_locate_prefetch ();
+	}
+
+	/* forget what is stale; nothing to do in the common case */
+
+	boost::shared_ptr<LocatePrefetches const> current = _locate_prefetch.reader ();
+	bool stale = false;
+
+	for (LocatePrefetches::const_iterator i = current->begin (); i != current->end () && !stale; ++i) {
+		stale = invalid || !pl || i->second->length != length || i->second->data.size () != n_chans ||
+			!std::binary_search (points.begin (), points.end (), i->first);
+	}
+
+	if (stale) {
+		RCUWriter<LocatePrefetches> writer (_locate_prefetch);
+		boost::shared_ptr<LocatePrefetches> lp = writer.get_copy ();
+
+		for (LocatePrefetches::iterator i = lp->begin (); i != lp->end (); ) {
+			LocatePrefetches::iterator tmp = i;
+			++tmp;
+			if (invalid || !pl || i->second->length != length || i->second->data.size () != n_chans ||
+			    !std::binary_search (points.begin (), points.end (), i->first)) {
+				drop_locate_prefetch (*lp, i);
+			}
+			i = tmp;
+		}
+	}
+
+	if (invalid) {
+		/* only now that the readers can not find anything stale */
+		g_atomic_int_compare_and_exchange (&_locate_prefetch_invalid, 1, 0);
+	}
+
+	if (!pl || length <= 0 || n_chans == 0) {
+		return false;
+	}
+
+	if (!_locate_prefetch_pending) {
+
+		current = _locate_prefetch.reader ();
+
+		std::vector<samplepos_t>::const_iterator p;
+
+		for (p = wanted.begin (); p != wanted.end (); ++p) {
+			if (current->find (*p) == current->end ()) {
+				break;
+			}
+		}
+
+		if (p == wanted.end ()) {
+			return false;
+		}
+
+		while (!_session.reserve_locate_prefetch (kb)) {
+			/* out of budget: make room by dropping our least recently
+			 * used prefetch, if that is less likely to be used than
+			 * this one. Otherwise wait until some other point (of
+			 * any track) is dropped.
+			 */
+			std::vector<samplepos_t>::const_iterator victim = wanted.end ();
+
+			while (victim != p + 1 && current->find (*(victim - 1)) == current->end ()) {
+				--victim;
+			}
+
+			if (victim == p + 1) {
+				return false;
+			}
+
+			{
+				RCUWriter<LocatePrefetches> writer (_locate_prefetch);
+				boost::shared_ptr<LocatePrefetches> lp = writer.get_copy ();
+				drop_locate_prefetch (*lp, lp->find (*(victim - 1)));
+			}
+
+			current = _locate_prefetch.reader ();
+		}
+
+		_locate_prefetch_pending.reset (new LocatePrefetch);
+		_locate_prefetch_pending->length = length;
+		_locate_prefetch_pending->data.resize (n_chans);
+		for (size_t chan = 0; chan < n_chans; ++chan) {
+			_locate_prefetch_pending->data[chan].resize (length);
+		}
+		_locate_prefetch_pending_point = *p;
+		_locate_prefetch_pending_done = 0;
+	}
+
+	/* read one chunk, so that no pass keeps the butler from a refill
+	 * for longer than a refill itself would.
+	 */
+
+	samplecnt_t const n = min (refill_chunk_samples (), length - _locate_prefetch_pending_done);
+	samplepos_t const pos = _locate_prefetch_pending_point + _locate_prefetch_pending_done;
+	std::vector<Sample> mixdown (n);
+	std::vector<float> gain (n);
+
+	for (size_t chan = 0; chan < n_chans; ++chan) {
+		if (pl->read (&_locate_prefetch_pending->data[chan][_locate_prefetch_pending_done], &mixdown[0], &gain[0], pos, n, chan) != n) {
+			drop_pending_locate_prefetch ();
+			return false;
+		}
+	}
+
+	_locate_prefetch_pending_done += n;
+
+	if (_locate_prefetch_pending_done < length) {
+		return true;
+	}
+
+	if (g_atomic_int_get (&_locate_prefetch_invalid)) {
+		/* the playlist changed while reading; try again next time */
+		drop_pending_locate_prefetch ();
+		return true;
+	}
+
+	{
+		RCUWriter<LocatePrefetches> writer (_locate_prefetch);
+		boost::shared_ptr<LocatePrefetches> lp = writer.get_copy ();
+		(*lp)[_locate_prefetch_pending_point] = _locate_prefetch_pending;
+	}
+
+	_locate_prefetch_pending.reset ();
+
+	return true;
+}
+
+void
+DiskReader::collect_readahead (ReadaheadQueue& queue)
+{
+	boost::shared_ptr<AudioPlaylist> pl = audio_playlist ();
+	boost::shared_ptr<ChannelList> c = channels.reader();
+
+	if (!pl || c->empty () || _session.transport_speed () < 0) {
+		return;
+	}
+
+	samplecnt_t const space = c->front()->buf->write_space ();
+
+	if (space < refill_chunk_samples ()) {
+		/* no refill coming */
+		return;
+	}
+
+	/* refill_audio() reads at most 4MB per channel at a time */
+	samplecnt_t cnt = min (space, (samplecnt_t) 1048576);
+	samplepos_t start = file_sample[DataType::AUDIO];
+	Location* loc = loop_location;
+
+	if (loc) {
+		samplepos_t const loop_start = loc->start ();
+		samplepos_t const loop_end = loc->end ();
+
+		if (loop_end > loop_start) {
+			if (start >= loop_end) {
+				start = loop_start + ((start - loop_start) % (loop_end - loop_start));
+			}
+			if (start + cnt > loop_end) {
+				collect_readahead (queue, pl, loop_start, min (cnt - (loop_end - start), loop_end - loop_start));
+				cnt = loop_end - start;
+			}
+		}
+	}
+
+	collect_readahead (queue, pl, start, cnt);
+}
+
+void
+DiskReader::collect_readahead (ReadaheadQueue& queue, boost::shared_ptr<AudioPlaylist> pl, samplepos_t start, samplecnt_t cnt)
+{
+	if (cnt <= 0) {
+		return;
+	}
+
+	/* only what the refill will actually read from the files: no regions
+	 * that are muted or hidden below opaque ones, and no parts that the
+	 * block cache has.
+	 */
+	AudioPlaylist::RenderSegments segments;
+	pl->audible_segments (start, cnt, segments);
+
+	for (AudioPlaylist::RenderSegments::const_iterator i = segments.begin(); i != segments.end(); ++i) {
+		boost::shared_ptr<AudioRegion> ar = i->region;
+		samplepos_t const from = i->from - ar->position () + ar->start ();
+		samplepos_t const to = i->to + 1 - ar->position () + ar->start ();
+
+		for (uint32_t n = 0; n < ar->n_channels (); ++n) {
+			boost::shared_ptr<AudioSource> src = ar->audio_source (n);
+			samplepos_t pos = from;
+
+			while (pos < to) {
+				samplepos_t const first = pos;
+
+				while (pos < to && !src->block_cached (pos)) {
+					pos = min (to, (pos / AudioBlockCache::block_samples + 1) * AudioBlockCache::block_samples);
+				}
+
+				std::string path;
+				off_t offset;
+				size_t length;
+
+				if (pos > first && src->file_byte_range (first, pos - first, path, offset, length)) {
+					queue.add (path, offset, length);
+				}
+
+				while (pos < to && src->block_cached (pos)) {
+					pos = min (to, (pos / AudioBlockCache::block_samples + 1) * AudioBlockCache::block_samples);
+				}
+			}
+		}
+	}
+}
+
+/** @return number of samples at @a pos that are available from the locate prefetch */
+samplecnt_t
+DiskReader::locate_prefetch_available (samplepos_t pos) const
+{
+	if (g_atomic_int_get (&_locate_prefetch_invalid)) {
+		return 0;
+	}
+
+	boost::shared_ptr<LocatePrefetches const> lp = _locate_prefetch.reader ();
+	LocatePrefetches::const_iterator i = lp->find (pos);
+
+	return i == lp->end () ? 0 : i->second->length;
+}
+
+/** @return true if [start, start + cnt) of @a channel was copied from the locate prefetch */
+bool
+DiskReader::locate_prefetch_read (Sample* buf, samplepos_t start, samplecnt_t cnt, int channel) const
+{
+	boost::shared_ptr<LocatePrefetches const> lp = _locate_prefetch.reader ();
+
+	if (lp->empty () || g_atomic_int_get (&_locate_prefetch_invalid)) {
+		return false;
+	}
+
+	LocatePrefetches::const_iterator i = lp->upper_bound (start);
+
+	if (i == lp->begin ()) {
+		return false;
+	}
+
+	--i;
+
+	LocatePrefetch const& p (*i->second);
+
+	if (channel < 0 || (size_t) channel >= p.data.size () || start + cnt > i->first + p.length) {
+		return false;
+	}
+
+	memcpy (buf, &p.data[channel][start - i->first], sizeof (Sample) * cnt);
+	return true;
+}
+
+int
+DiskReader::do_refill ()
+{
+	return _do_refill_with_alloc (false);
+}
+
 int
 DiskReader::_do_refill_with_alloc (bool partial_fill)
 {
+	return refill_with_alloc (partial_fill ? refill_chunk_samples () : 0);
+}
+
+int
+DiskReader::refill_with_alloc (samplecnt_t fill_level)
+{
+	WorkingBuffers* wb = thread_working_buffers.get ();
+
+	if (wb) {
+		return refill (wb->mixdown, wb->gain, wb->size, fill_level);
+	}
+
 	/* We limit disk reads to at most 4MB chunks, which with floating point
 	   samples would be 1M samples. But we might use 16 or 14 bit samples,
 	   in which case 4MB is more samples than that. Therefore size this for
@@ -835,10 +1525,10 @@ DiskReader::_do_refill_with_alloc (bool partial_fill)
 	*/
 
 	{
-		std::auto_ptr<Sample> mix_buf (new Sample[2*1048576]);
-		std::auto_ptr<float>  gain_buf (new float[2*1048576]);
+		std::auto_ptr<Sample> mix_buf (new Sample[max_refill_samples]);
+		std::auto_ptr<float>  gain_buf (new float[max_refill_samples]);
 
-		int ret = refill_audio (mix_buf.get(), gain_buf.get(), (partial_fill ? _chunk_samples : 0));
+		int ret = refill_audio (mix_buf.get(), gain_buf.get(), max_refill_samples, fill_level);
 
 		if (ret) {
 			return ret;
@@ -849,9 +1539,9 @@ DiskReader::_do_refill_with_alloc (bool partial_fill)
 }
 
 int
-DiskReader::refill (Sample* mixdown_buffer, float* gain_buffer, samplecnt_t fill_level)
+DiskReader::refill (Sample* mixdown_buffer, float* gain_buffer, samplecnt_t mixdown_size, samplecnt_t fill_level)
 {
-	int ret = refill_audio (mixdown_buffer, gain_buffer, fill_level);
+	int ret = refill_audio (mixdown_buffer, gain_buffer, mixdown_size, fill_level);
 
 	if (ret) {
 		return ret;
@@ -871,7 +1561,7 @@ DiskReader::refill (Sample* mixdown_buffer, float* gain_buffer, samplecnt_t fill
  */
 
 int
-DiskReader::refill_audio (Sample* mixdown_buffer, float* gain_buffer, samplecnt_t fill_level)
+DiskReader::refill_audio (Sample* mixdown_buffer, float* gain_buffer, samplecnt_t mixdown_size, samplecnt_t fill_level)
 {
 	/* do not read from disk while session is marked as Loading, to avoid
 	   useless redundant I/O.
@@ -932,8 +1622,10 @@ DiskReader::refill_audio (Sample* mixdown_buffer, float* gain_buffer, samplecnt_
 	   the playback buffer is empty.
 	*/
 
-	DEBUG_TRACE (DEBUG::DiskIO, string_compose ("%1: space to refill %2 vs. chunk %3 (speed = %4)\n", name(), total_space, _chunk_samples, _session.transport_speed()));
-	if ((total_space < _chunk_samples) && fabs (_session.transport_speed()) < 2.0f) {
+	samplecnt_t const chunk = refill_chunk_samples ();
+
+	DEBUG_TRACE (DEBUG::DiskIO, string_compose ("%1: space to refill %2 vs. chunk %3 (speed = %4)\n", name(), total_space, chunk, _session.transport_speed()));
+	if ((total_space < chunk) && fabs (_session.transport_speed()) < 2.0f) {
 		return 0;
 	}
 
@@ -1020,9 +1712,11 @@ DiskReader::refill_audio (Sample* mixdown_buffer, float* gain_buffer, samplecnt_
 	const size_t bits_per_sample = format_data_width (_session.config.get_native_file_data_format());
 	size_t total_bytes = total_space * bits_per_sample / 8;
 
-	/* chunk size range is 256kB to 4MB. Bigger is faster in terms of MB/sec, but bigger chunk size always takes longer
+	/* chunk size range is 256kB to 4MB. Bigger is faster in terms of MB/sec, but bigger chunk size always takes longer.
+	   Slow media get a bigger refill chunk (see Butler::update_adaptive_buffering()), and so bigger reads.
 	 */
-	size_t byte_size_for_read = max ((size_t) (256 * 1024), min ((size_t) (4 * 1048576), total_bytes));
+	size_t const min_bytes = min ((size_t) (4 * 1048576), max ((size_t) (256 * 1024), (size_t) (chunk * bits_per_sample / 8)));
+	size_t byte_size_for_read = max (min_bytes, min ((size_t) (4 * 1048576), total_bytes));
 
 	/* find nearest (lower) multiple of 16384 */
 
@@ -1034,8 +1728,8 @@ DiskReader::refill_audio (Sample* mixdown_buffer, float* gain_buffer, samplecnt_
 
 	DEBUG_TRACE (DEBUG::DiskIO, string_compose ("%1: will refill %2 channels with %3 samples\n", name(), c->size(), total_space));
 
-	// uint64_t before = g_get_monotonic_time ();
-	// uint64_t elapsed;
+	gint64 const before = g_get_monotonic_time ();
+	samplecnt_t samples_read = 0;
 
 	for (chan_n = 0, i = c->begin(); i != c->end(); ++i, ++chan_n) {
 
@@ -1084,11 +1778,12 @@ DiskReader::refill_audio (Sample* mixdown_buffer, float* gain_buffer, samplecnt_
 
 		if (to_read) {
 
-			if (audio_read (buf1, mixdown_buffer, gain_buffer, file_sample_tmp, to_read, chan_n, reversed)) {
+			if (audio_read_in_pieces (buf1, mixdown_buffer, gain_buffer, mixdown_size, file_sample_tmp, to_read, chan_n, reversed)) {
 				ret = -1;
 				goto out;
 			}
 			chan->buf->increment_write_ptr (to_read);
+			samples_read += to_read;
 			ts -= to_read;
 		}
 
@@ -1101,12 +1796,13 @@ DiskReader::refill_audio (Sample* mixdown_buffer, float* gain_buffer, samplecnt_
 			   all of vector.len[1] as well.
 			*/
 
-			if (audio_read (buf2, mixdown_buffer, gain_buffer, file_sample_tmp, to_read, chan_n, reversed)) {
+			if (audio_read_in_pieces (buf2, mixdown_buffer, gain_buffer, mixdown_size, file_sample_tmp, to_read, chan_n, reversed)) {
 				ret = -1;
 				goto out;
 			}
 
 			chan->buf->increment_write_ptr (to_read);
+			samples_read += to_read;
 		}
 
 		if (zero_fill) {
@@ -1115,13 +1811,12 @@ DiskReader::refill_audio (Sample* mixdown_buffer, float* gain_buffer, samplecnt_
 
 	}
 
-	// elapsed = g_get_monotonic_time () - before;
-	// cerr << '\t' << name() << ": bandwidth = " << (byte_size_for_read / 1048576.0) / (elapsed/1000000.0) << "MB/sec\n";
+	update_refill_stats (g_get_monotonic_time () - before, samples_read * bits_per_sample / 8);
 
 	file_sample[DataType::AUDIO] = file_sample_tmp;
 	assert (file_sample[DataType::AUDIO] >= 0);
 
-	ret = ((total_space - samples_to_read) > _chunk_samples);
+	ret = ((total_space - samples_to_read) > refill_chunk_samples ());
 
 	c->front()->buf->get_write_vector (&vector);
 
@@ -810,6 +810,8 @@ DiskWriter::do_flush (RunContext ctxt, bool force_flush)
 	RingBufferNPT<Sample>::rw_vector vector;
 	RingBufferNPT<CaptureTransition>::rw_vector transvec;
 	samplecnt_t total;
+	gint64 const before = g_get_monotonic_time ();
+	samplecnt_t audio_written = 0;
 
 	transvec.buf[0] = 0;
 	transvec.buf[1] = 0;
@@ -901,6 +903,7 @@ DiskWriter::do_flush (RunContext ctxt, bool force_flush)
 
 		(*chan)->buf->increment_read_ptr (to_write);
 		(*chan)->curr_capture_cnt += to_write;
+		audio_written += to_write;
 
 		if ((to_write == vector.len[0]) && (total > to_write) && (to_write < _chunk_samples) && !destructive()) {
 
@@ -920,6 +923,7 @@ DiskWriter::do_flush (RunContext ctxt, bool force_flush)
 
 			(*chan)->buf->increment_read_ptr (to_write);
 			(*chan)->curr_capture_cnt += to_write;
+			audio_written += to_write;
 		}
 	}
 
@@ -968,10 +972,48 @@ DiskWriter::do_flush (RunContext ctxt, bool force_flush)
 	}
 
   out:
+	if (audio_written) {
+		update_write_stats (g_get_monotonic_time () - before, audio_written * format_data_width (_session.config.get_native_file_data_format()) / 8);
+	}
+
 	return ret;
 
 }
 
+void
+DiskWriter::update_write_stats (int64_t elapsed_us, size_t bytes)
+{
+	if (bytes == 0 || elapsed_us < 0) {
+		return;
+	}
+
+	Glib::Threads::Mutex::Lock lm (_write_stats_lock);
+	WriteStats& s (_write_stats);
+
+	double const bps = elapsed_us > 0 ? bytes * 1e6 / elapsed_us : 0;
+
+	if (s.writes == 0) {
+		s.avg_us = elapsed_us;
+		s.bytes_per_sec = bps;
+	} else {
+		s.avg_us += .1 * (elapsed_us - s.avg_us);
+		if (bps > 0) {
+			s.bytes_per_sec += .1 * (bps - s.bytes_per_sec);
+		}
+	}
+
+	/* the peak decays, so that a single stall is forgotten eventually */
+	s.max_us = max ((double) elapsed_us, s.max_us * .98);
+	++s.writes;
+}
+
+DiskWriter::WriteStats
+DiskWriter::write_stats () const
+{
+	Glib::Threads::Mutex::Lock lm (_write_stats_lock);
+	return _write_stats;
+}
+
 void
 DiskWriter::reset_write_sources (bool mark_write_complete, bool /*force*/)
 {
@@ -31,6 +31,7 @@
 #include "ardour/route.h"
 #include "ardour/process_thread.h"
 #include "ardour/audioengine.h"
+#include "ardour/rc_configuration.h"
 
 #include "pbd/i18n.h"
 
@@ -51,12 +52,27 @@ int alloc_allowed ()
 }
 #endif
 
+static void
+do_not_delete_the_worker_queue (void*)
+{
+	/* worker queues are owned by the Graph, not by the thread */
+}
+
+Glib::Threads::Private<Graph::WorkerQueue> Graph::_worker_queue (do_not_delete_the_worker_queue);
+
 Graph::Graph (Session & session)
 	: SessionHandleRef (session)
 	, _threads_active (false)
 	, _execution_sem ("graph_execution", 0)
 	, _callback_start_sem ("graph_start", 0)
 	, _callback_done_sem ("graph_done", 0)
+	, _inject_queue (8192)
+	, _ws_pending (0)
+	, _inject_overflow (0)
+	, _worker_count (0)
+	, _work_stealing (Config->get_graph_work_stealing ())
+	, _rank_countdown (0)
+	, _cycle_start (0)
 {
 	pthread_mutex_init( &_trigger_mutex, NULL);
 
@@ -121,6 +137,11 @@ Graph::reset_thread_list ()
 
 	_threads_active = true;
 
+	/* one deque per thread, claimed by each thread as it starts */
+	for (uint32_t i = 0; i < num_threads; ++i) {
+		_worker_queues.push_back (new WorkerQueue (8192));
+	}
+
 	if (AudioEngine::instance()->create_process_thread (boost::bind (&Graph::main_thread, this)) != 0) {
 		throw failed_constructor ();
 	}
@@ -143,6 +164,7 @@ Graph::session_going_away()
 	_init_trigger_list[0].clear();
 	_init_trigger_list[1].clear();
 	_trigger_queue.clear();
+	_inject_queue.clear ();
 }
 
 void
@@ -169,6 +191,16 @@ Graph::drop_threads ()
 	_callback_done_sem.signal ();
 	_execution_tokens = 0;
 
+	/* all threads are gone, nobody can reference their queues anymore */
+	for (std::vector<WorkerQueue*>::iterator i = _worker_queues.begin (); i != _worker_queues.end (); ++i) {
+		delete *i;
+	}
+	_worker_queues.clear ();
+	_inject_queue.clear ();
+	_worker_count = 0;
+	_ws_pending = 0;
+	_inject_overflow = 0;
+
 	/* reset semaphores.
 	 * This is somewhat ugly, yet if a thread is killed (e.g jackd terminates
 	 * abnormally), some semaphores are still unlocked.
@@ -221,6 +253,7 @@ Graph::prep()
 			// printf ("chain swap ! %d -> %d\n", _current_chain, _pending_chain);
 			_setup_chain = _current_chain;
 			_current_chain = _pending_chain;
+			_rank_countdown = 0;
 			_cleanup_cond.signal ();
 		}
 		_swap_mutex.unlock ();
@@ -228,6 +261,14 @@ Graph::prep()
 
 	chain = _current_chain;
 
+	/* route costs change slowly, there is no need to re-rank every cycle */
+	if (_rank_countdown-- <= 0) {
+		rank_nodes (chain);
+		_rank_countdown = 64;
+	}
+
+	_cycle_start = get_microseconds ();
+
 	_graph_empty = true;
 	for (i=_nodes_rt[chain].begin(); i!=_nodes_rt[chain].end(); i++) {
 		(*i)->prep( chain);
@@ -235,11 +276,27 @@ Graph::prep()
 	}
 	_finished_refcount = _init_finished_refcount[chain];
 
+	/* The previous cycle is complete, so no node is queued anywhere and
+	 * it is safe to switch schedulers here.
+	 */
+	_work_stealing = Config->get_graph_work_stealing ();
+
+	/* The initial trigger list is sorted by descending priority.
+	 * The injection queue is FIFO, the locked trigger queue LIFO.
+	 */
+	if (_work_stealing) {
+		for (i=_init_trigger_list[chain].begin(); i!=_init_trigger_list[chain].end(); i++) {
+			inject (i->get ());
+			g_atomic_int_inc (&_ws_pending);
+		}
+		return;
+	}
+
 	/* Trigger the initial nodes for processing, which are the ones at the `input' end */
 	pthread_mutex_lock (&_trigger_mutex);
-	for (i=_init_trigger_list[chain].begin(); i!=_init_trigger_list[chain].end(); i++) {
+	for (node_list_t::reverse_iterator ri=_init_trigger_list[chain].rbegin(); ri!=_init_trigger_list[chain].rend(); ri++) {
 		/* don't use ::trigger here, as we have already locked the mutex */
-		_trigger_queue.push_back (i->get ());
+		_trigger_queue.push_back (ri->get ());
 	}
 	pthread_mutex_unlock (&_trigger_mutex);
 }
@@ -247,6 +304,18 @@ Graph::prep()
 void
 Graph::trigger (GraphNode* n)
 {
+	if (_work_stealing) {
+		/* keep downstream nodes on the thread that just ran their
+		 * last input; idle threads will steal it if need be.
+		 */
+		WorkerQueue* wq = _worker_queue.get ();
+		if (!wq || !wq->push (n)) {
+			inject (n);
+		}
+		g_atomic_int_inc (&_ws_pending);
+		return;
+	}
+
 	pthread_mutex_lock (&_trigger_mutex);
 	_trigger_queue.push_back (n);
 	pthread_mutex_unlock (&_trigger_mutex);
@@ -264,6 +333,8 @@ Graph::dec_ref()
 		 * the graph, so there is nothing more to do this time around.
 		 */
 
+		_makespan.update (get_microseconds () - _cycle_start);
+
 		restart_cycle ();
 	}
 }
@@ -295,9 +366,56 @@ again:
 	// starting with waking up the others.
 }
 
-/** Rechain our stuff using a list of routes (which can be in any order) and
- *  a directed graph of their interconnections, which is guaranteed to be
- *  acyclic.
+static bool
+higher_priority_first (node_ptr_t const& a, node_ptr_t const& b)
+{
+	return a->priority () > b->priority ();
+}
+
+/** Estimate how long the rest of the graph takes from each node onwards,
+ *  and sort the initial trigger list so that the longest chains start first.
+ *  Called from the process thread, at the start of a cycle.
+ */
+void
+Graph::rank_nodes (int chain)
+{
+	double total = 0;
+	double critical = 0;
+
+	/* _nodes_rt is topologically sorted (see rechain), so walking it
+	 * backwards ranks every node after all the nodes it feeds.
+	 */
+	for (node_list_t::reverse_iterator ni = _nodes_rt[chain].rbegin(); ni != _nodes_rt[chain].rend(); ++ni) {
+		GraphNode* n = ni->get ();
+		Route* r = dynamic_cast<Route*> (n);
+
+		/* no route is free, even before it has been measured */
+		double const cost = max (1.0, r ? r->dsp_stats ().rt_avg () : 0.0);
+
+		double downstream = 0;
+		for (node_set_t::const_iterator ai = n->_activation_set[chain].begin(); ai != n->_activation_set[chain].end(); ++ai) {
+			downstream = max (downstream, (*ai)->_priority);
+		}
+
+		n->_priority = cost + downstream;
+		total += cost;
+		critical = max (critical, n->_priority);
+	}
+
+	/* std::list::sort does not allocate */
+	_init_trigger_list[chain].sort (higher_priority_first);
+
+	/* lower bound of the cycle time: the critical path, or the total
+	 * work spread evenly across all threads, whichever is longer.
+	 */
+	size_t const n_threads = max ((size_t) 1, _worker_queues.size ());
+	_predicted_makespan.update (llrint (max (critical, total / n_threads)));
+}
+
+/** Rechain our stuff using a list of routes and a directed graph of their
+ *  interconnections, which is guaranteed to be acyclic. The list must be
+ *  topologically sorted (see Session::resort_routes_using), which
+ *  rank_nodes() relies upon.
  */
 void
 Graph::rechain (boost::shared_ptr<RouteList> routelist, GraphEdges const & edges)
@@ -373,6 +491,16 @@ Graph::rechain (boost::shared_ptr<RouteList> routelist, GraphEdges const & edges
  */
 bool
 Graph::run_one()
+{
+	if (_work_stealing) {
+		return run_one_work_stealing ();
+	}
+	return run_one_locked ();
+}
+
+/** The original scheduler: a single trigger queue protected by _trigger_mutex */
+bool
+Graph::run_one_locked ()
 {
 	GraphNode* to_run;
 
@@ -385,14 +513,14 @@ Graph::run_one()
 	}
 
 	/* the number of threads that are asleep */
-	int et = _execution_tokens;
+	int et = g_atomic_int_get (&_execution_tokens);
 	/* the number of nodes that need to be run */
 	int ts = _trigger_queue.size();
 
 	/* hence how many threads to wake up */
 	int wakeup = min (et, ts);
 	/* update the number of threads that will still be sleeping */
-	_execution_tokens -= wakeup;
+	g_atomic_int_add (&_execution_tokens, -wakeup);
 
 	DEBUG_TRACE(DEBUG::ProcessThreads, string_compose ("%1 signals %2\n", pthread_name(), wakeup));
 
@@ -400,20 +528,14 @@ Graph::run_one()
 		_execution_sem.signal ();
 	}
 
-	while (to_run == 0) {
-		_execution_tokens += 1;
+	if (to_run == 0) {
+		g_atomic_int_inc (&_execution_tokens);
 		pthread_mutex_unlock (&_trigger_mutex);
 		DEBUG_TRACE (DEBUG::ProcessThreads, string_compose ("%1 goes to sleep\n", pthread_name()));
 		_execution_sem.wait ();
-		if (!_threads_active) {
-			return true;
-		}
 		DEBUG_TRACE (DEBUG::ProcessThreads, string_compose ("%1 is awake\n", pthread_name()));
-		pthread_mutex_lock (&_trigger_mutex);
-		if (_trigger_queue.size()) {
-			to_run = _trigger_queue.back();
-			_trigger_queue.pop_back();
-		}
+		/* start over; the scheduler may have been switched meanwhile */
+		return !_threads_active;
 	}
 	pthread_mutex_unlock (&_trigger_mutex);
 
@@ -425,6 +547,143 @@ Graph::run_one()
 	return !_threads_active;
 }
 
+/** Lock-free scheduler: per-thread deques, work stealing, and a shared
+ *  injection queue for the initial nodes of each cycle.
+ */
+bool
+Graph::run_one_work_stealing ()
+{
+	GraphNode* to_run;
+
+	if (!find_work (to_run)) {
+		/* announce that this thread is going to sleep */
+		g_atomic_int_inc (&_execution_tokens);
+
+		/* A node may have been queued after we looked, but before
+		 * this thread was counted as idle. Look again, unless
+		 * somebody already took our token to wake us up.
+		 */
+		if (g_atomic_int_get (&_ws_pending) > 0 && claim_execution_token ()) {
+			return !_threads_active;
+		}
+
+		DEBUG_TRACE (DEBUG::ProcessThreads, string_compose ("%1 goes to sleep\n", pthread_name()));
+		_execution_sem.wait ();
+		DEBUG_TRACE (DEBUG::ProcessThreads, string_compose ("%1 is awake\n", pthread_name()));
+		return !_threads_active;
+	}
+
+	g_atomic_int_add (&_ws_pending, -1);
+
+	/* more work is ready than we can do, wake up sleeping threads */
+	wake_idle_threads ();
+
+	to_run->process();
+	to_run->finish (_current_chain);
+
+	DEBUG_TRACE(DEBUG::ProcessThreads, string_compose ("%1 has finished run_one()\n", pthread_name()));
+
+	return !_threads_active;
+}
+
+/** Queue @a n for any thread of the work-stealing scheduler */
+void
+Graph::inject (GraphNode* n)
+{
+	if (_inject_queue.push_back (n)) {
+		return;
+	}
+
+	/* The injection queue is full (a huge graph). Fall back to the
+	 * locked trigger queue, which is unused in this mode.
+	 */
+	pthread_mutex_lock (&_trigger_mutex);
+	_trigger_queue.push_back (n);
+	g_atomic_int_inc (&_inject_overflow);
+	pthread_mutex_unlock (&_trigger_mutex);
+}
+
+bool
+Graph::find_work (GraphNode*& n)
+{
+	WorkerQueue* own = _worker_queue.get ();
+
+	/* most recently triggered node first, its inputs are still in cache */
+	if (own && own->pop (n)) {
+		return true;
+	}
+
+	if (_inject_queue.pop_front (n)) {
+		return true;
+	}
+
+	if (g_atomic_int_get (&_inject_overflow) > 0) {
+		bool found = false;
+		pthread_mutex_lock (&_trigger_mutex);
+		if (!_trigger_queue.empty ()) {
+			n = _trigger_queue.back ();
+			_trigger_queue.pop_back ();
+			g_atomic_int_add (&_inject_overflow, -1);
+			found = true;
+		}
+		pthread_mutex_unlock (&_trigger_mutex);
+		if (found) {
+			return true;
+		}
+	}
+
+	for (std::vector<WorkerQueue*>::const_iterator i = _worker_queues.begin (); i != _worker_queues.end (); ++i) {
+		if (*i != own && (*i)->steal (n)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/** Take one token from the count of sleeping threads.
+ *  @return true if a token was taken, false if no thread is (about to be) asleep.
+ */
+bool
+Graph::claim_execution_token ()
+{
+	gint et;
+	while ((et = g_atomic_int_get (&_execution_tokens)) > 0) {
+		if (g_atomic_int_compare_and_exchange (&_execution_tokens, et, et - 1)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void
+Graph::wake_idle_threads ()
+{
+	gint pending = g_atomic_int_get (&_ws_pending);
+	int wakeup = 0;
+
+	while (pending-- > 0 && claim_execution_token ()) {
+		_execution_sem.signal ();
+		++wakeup;
+	}
+
+	DEBUG_TRACE(DEBUG::ProcessThreads, string_compose ("%1 signals %2\n", pthread_name(), wakeup));
+}
+
+/** Give the calling thread its own worker queue. */
+void
+Graph::register_worker_thread ()
+{
+	gint id = g_atomic_int_add (&_worker_count, 1);
+
+	if (id < (gint) _worker_queues.size ()) {
+		_worker_queue.set (_worker_queues[id]);
+	} else {
+		/* this thread will only use the shared queue */
+		_worker_queue.set (0);
+	}
+}
+
 void
 Graph::helper_thread()
 {
@@ -433,6 +692,7 @@ Graph::helper_thread()
 	resume_rt_malloc_checks ();
 
 	pt->get_buffers();
+	register_worker_thread ();
 
 	while(1) {
 		if (run_one()) {
@@ -453,6 +713,7 @@ Graph::main_thread()
 	resume_rt_malloc_checks ();
 
 	pt->get_buffers();
+	register_worker_thread ();
 
 again:
 	_callback_start_sem.wait ();
@@ -573,6 +834,8 @@ Graph::process_one_route (Route* route)
 
 	DEBUG_TRACE (DEBUG::ProcessThreads, string_compose ("%1 runs route %2\n", pthread_name(), route->name()));
 
+	microseconds_t const t0 = get_microseconds ();
+
 	if (_process_noroll) {
 		route->set_pending_declick (_process_declick);
 		retval = route->no_roll (_process_nframes, _process_start_sample, _process_end_sample, _process_non_rt_pending);
@@ -581,6 +844,8 @@ Graph::process_one_route (Route* route)
 		retval = route->roll (_process_nframes, _process_start_sample, _process_end_sample, _process_declick, need_butler);
 	}
 
+	route->dsp_stats ().update (get_microseconds () - t0);
+
 	if (retval) {
 		_process_retval = retval;
 	}
@@ -26,6 +26,7 @@ using namespace ARDOUR;
 
 GraphNode::GraphNode (boost::shared_ptr<Graph> graph)
 	: _graph(graph)
+	, _priority (0)
 {
 }
 
@@ -42,16 +43,13 @@ GraphNode::prep (int chain)
 
 /** Called by another node to tell us that one of the nodes that feed us
  *  has been processed.
+ *  @return true if all the nodes that feed us are done, and this node
+ *  must now be queued for processing.
  */
-void
+bool
 GraphNode::dec_ref()
 {
-	if (g_atomic_int_dec_and_test (&_refcount)) {
-		/* All the nodes that feed us are done, so we can queue this node
-		 * for processing.
-		 */
-		_graph->trigger (this);
-	}
+	return g_atomic_int_dec_and_test (&_refcount);
 }
 
 void
@@ -60,10 +58,39 @@ GraphNode::finish (int chain)
 	node_set_t::iterator i;
 	bool feeds_somebody = false;
 
+	/* Nodes that became ready because of us. They are triggered in order
+	 * of ascending priority, since the scheduler picks the most recently
+	 * triggered node first.
+	 */
+	const size_t max_ready = 32;
+	GraphNode* ready[max_ready];
+	size_t n_ready = 0;
+
 	/* Tell the nodes that we feed that we've finished */
 	for (i=_activation_set[chain].begin(); i!=_activation_set[chain].end(); i++) {
-		(*i)->dec_ref();
 		feeds_somebody = true;
+
+		GraphNode* n = i->get ();
+
+		if (!n->dec_ref()) {
+			continue;
+		}
+
+		if (n_ready == max_ready) {
+			_graph->trigger (n);
+			continue;
+		}
+
+		size_t k = n_ready++;
+		while (k > 0 && ready[k - 1]->_priority > n->_priority) {
+			ready[k] = ready[k - 1];
+			--k;
+		}
+		ready[k] = n;
+	}
+
+	for (size_t k = 0; k < n_ready; ++k) {
+		_graph->trigger (ready[k]);
 	}
 
 	if (!feeds_somebody) {
@@ -0,0 +1,132 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#include "pbd/compose.h"
+#include "pbd/error.h"
+#include "pbd/pthread_utils.h"
+
+#include "ardour/debug.h"
+#include "ardour/disk_reader.h"
+#include "ardour/io_tasklist.h"
+
+#include "pbd/i18n.h"
+
+using namespace ARDOUR;
+using namespace PBD;
+
+IOTaskList::IOTaskList (uint32_t n_workers)
+	: _next_task (0)
+	, _terminate (false)
+	, _exec_sem ("io thread exec", 0)
+	, _idle_sem ("io thread idle", 0)
+{
+	for (uint32_t i = 0; i < n_workers; ++i) {
+		pthread_t thread;
+		if (pthread_create_and_store (string_compose ("butler io %1", i), &thread, _worker_thread, this)) {
+			error << _("Butler: could not create I/O worker thread") << endmsg;
+			break;
+		}
+		_workers.push_back (thread);
+	}
+}
+
+IOTaskList::~IOTaskList ()
+{
+	_terminate = true;
+	for (std::vector<pthread_t>::const_iterator i = _workers.begin (); i != _workers.end (); ++i) {
+		_exec_sem.signal ();
+	}
+	for (std::vector<pthread_t>::const_iterator i = _workers.begin (); i != _workers.end (); ++i) {
+		void* status;
+		pthread_join (*i, &status);
+	}
+}
+
+void
+IOTaskList::push_back (boost::function<void ()> fn)
+{
+	_tasks.push_back (fn);
+}
+
+void
+IOTaskList::process ()
+{
+	if (_workers.empty () || _tasks.size () < 2) {
+		for (std::vector<boost::function<void ()> >::const_iterator i = _tasks.begin (); i != _tasks.end (); ++i) {
+			(*i)();
+		}
+		_tasks.clear ();
+		return;
+	}
+
+	DEBUG_TRACE (DEBUG::Butler, string_compose ("IOTaskList: run %1 tasks with %2 workers\n", _tasks.size (), _workers.size ()));
+
+	g_atomic_int_set (&_next_task, 0);
+
+	for (std::vector<pthread_t>::const_iterator i = _workers.begin (); i != _workers.end (); ++i) {
+		_exec_sem.signal ();
+	}
+
+	run_tasks ();
+
+	for (std::vector<pthread_t>::const_iterator i = _workers.begin (); i != _workers.end (); ++i) {
+		_idle_sem.wait ();
+	}
+
+	_tasks.clear ();
+}
+
+void
+IOTaskList::run_tasks ()
+{
+	gint const n_tasks = _tasks.size ();
+	gint n;
+	while ((n = g_atomic_int_add (&_next_task, 1)) < n_tasks) {
+		_tasks[n]();
+	}
+}
+
+void*
+IOTaskList::_worker_thread (void* arg)
+{
+	pthread_set_name ("butler io");
+	static_cast<IOTaskList*> (arg)->worker_thread ();
+	return 0;
+}
+
+void
+IOTaskList::worker_thread ()
+{
+	/* every worker refills with its own scratch buffers; smaller ones
+	 * than the butler's (refills read in pieces that fit them), so that
+	 * the pool costs 2MB per thread rather than 16MB.
+	 */
+	DiskReader::allocate_working_buffers (262144);
+
+	while (true) {
+		_exec_sem.wait ();
+		if (_terminate) {
+			break;
+		}
+		run_tasks ();
+		_idle_sem.signal ();
+	}
+
+	DiskReader::free_working_buffers ();
+}
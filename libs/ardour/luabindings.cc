@@ -43,6 +43,7 @@
 #include "ardour/disk_reader.h"
 #include "ardour/disk_writer.h"
 #include "ardour/dsp_filter.h"
+#include "ardour/dsp_stats.h"
 #include "ardour/file_source.h"
 #include "ardour/fluid_synth.h"
 #include "ardour/interthread_info.h"
@@ -552,6 +553,7 @@ LuaBindings::common (lua_State* L)
 		.addFunction ("clear_list", (void (Evoral::ControlList::*)())&Evoral::ControlList::clear)
 		.addFunction ("in_write_pass", &Evoral::ControlList::in_write_pass)
 		.addFunction ("events", &Evoral::ControlList::events)
+		.addFunction ("mark_dirty", &Evoral::ControlList::mark_dirty)
 		.endClass ()
 
 		.beginWSPtrClass <Evoral::ControlSet> ("ControlSet")
@@ -764,6 +766,16 @@ LuaBindings::common (lua_State* L)
 		.endClass ()
 		.endNamespace ()
 
+		.beginClass <DSPStats::Snapshot> ("DSPStats")
+		.addVoidConstructor ()
+		.addData ("count", &DSPStats::Snapshot::count, false)
+		.addData ("last", &DSPStats::Snapshot::last, false)
+		.addData ("min", &DSPStats::Snapshot::min, false)
+		.addData ("max", &DSPStats::Snapshot::max, false)
+		.addData ("avg", &DSPStats::Snapshot::avg, false)
+		.addFunction ("bin", &DSPStats::Snapshot::bin)
+		.endClass ()
+
 		.beginClass <ChanMapping> ("ChanMapping")
 		.addVoidConstructor ()
 		.addFunction ("get", static_cast<uint32_t(ChanMapping::*)(DataType, uint32_t) const>(&ChanMapping::get))
@@ -1077,6 +1089,8 @@ LuaBindings::common (lua_State* L)
 		.addFunction ("set_meter_point", &Route::set_meter_point)
 		.addFunction ("signal_latency", &Route::signal_latency)
 		.addFunction ("playback_latency", &Route::playback_latency)
+		.addRefFunction ("dsp_stats", &Route::dsp_stats_snapshot)
+		.addFunction ("reset_dsp_stats", &Route::reset_dsp_stats)
 		.endClass ()
 
 		.deriveWSPtrClass <Playlist, SessionObject> ("Playlist")
@@ -1357,9 +1371,23 @@ LuaBindings::common (lua_State* L)
 		.endClass ()
 
 		.deriveWSPtrClass <DiskReader, DiskIOProcessor> ("DiskReader")
+		.addFunction ("buffer_load", &DiskReader::buffer_load)
+		.addFunction ("underruns", &DiskReader::underruns)
+		.addFunction ("near_underruns", &DiskReader::near_underruns)
+		.addFunction ("reset_underrun_counters", &DiskReader::reset_underrun_counters)
+		.addFunction ("buffer_size", &DiskReader::buffer_size)
+		.addFunction ("target_buffer_size", &DiskReader::target_buffer_size)
+		.addFunction ("refill_chunk_samples", &DiskReader::refill_chunk_samples)
+		.addFunction ("avg_refill_us", &DiskReader::avg_refill_us)
+		.addFunction ("max_refill_us", &DiskReader::max_refill_us)
+		.addFunction ("refill_bytes_per_sec", &DiskReader::refill_bytes_per_sec)
 		.endClass ()
 
 		.deriveWSPtrClass <DiskWriter, DiskIOProcessor> ("DiskWriter")
+		.addFunction ("buffer_load", &DiskWriter::buffer_load)
+		.addFunction ("avg_write_us", &DiskWriter::avg_write_us)
+		.addFunction ("max_write_us", &DiskWriter::max_write_us)
+		.addFunction ("write_bytes_per_sec", &DiskWriter::write_bytes_per_sec)
 		.endClass ()
 
 		.deriveWSPtrClass <IOProcessor, Processor> ("IOProcessor")
@@ -1901,6 +1929,7 @@ LuaBindings::common (lua_State* L)
 		.addConst ("RF64", ARDOUR::HeaderFormat(RF64))
 		.addConst ("RF64_WAV", ARDOUR::HeaderFormat(RF64_WAV))
 		.addConst ("MBWF", ARDOUR::HeaderFormat(MBWF))
+		.addConst ("FLAC", ARDOUR::HeaderFormat(FLAC))
 		.endNamespace ()
 
 		.beginNamespace ("InsertMergePolicy")
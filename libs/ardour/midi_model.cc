@@ -20,10 +20,14 @@
 
 #include <algorithm>
 #include <iostream>
+#include <map>
 #include <set>
 #include <stdexcept>
 #include <stdint.h>
 
+#include <glib.h>
+#include <boost/make_shared.hpp>
+
 #include "pbd/compose.h"
 #include "pbd/enumwriter.h"
 #include "pbd/error.h"
@@ -38,6 +42,7 @@
 #include "ardour/midi_model.h"
 #include "ardour/midi_source.h"
 #include "ardour/midi_state_tracker.h"
+#include "ardour/rc_configuration.h"
 #include "ardour/session.h"
 #include "ardour/types.h"
 
@@ -125,17 +130,201 @@ MidiModel::apply_command_as_subcommand(Session& session, Command* cmd)
 /************** DIFF COMMAND ********************/
 
 #define NOTE_DIFF_COMMAND_ELEMENT "NoteDiffCommand"
+#define BINARY_NOTE_DIFF_COMMAND_ELEMENT "BinaryNoteDiffCommand"
 #define DIFF_NOTES_ELEMENT "ChangedNotes"
 #define ADDED_NOTES_ELEMENT "AddedNotes"
 #define REMOVED_NOTES_ELEMENT "RemovedNotes"
 #define SIDE_EFFECT_REMOVALS_ELEMENT "SideEffectRemovals"
 #define SYSEX_DIFF_COMMAND_ELEMENT "SysExDiffCommand"
+#define BINARY_SYSEX_DIFF_COMMAND_ELEMENT "BinarySysExDiffCommand"
 #define DIFF_SYSEXES_ELEMENT "ChangedSysExes"
 #define PATCH_CHANGE_DIFF_COMMAND_ELEMENT "PatchChangeDiffCommand"
 #define ADDED_PATCH_CHANGES_ELEMENT "AddedPatchChanges"
 #define REMOVED_PATCH_CHANGES_ELEMENT "RemovedPatchChanges"
 #define DIFF_PATCH_CHANGES_ELEMENT "ChangedPatchChanges"
 
+/* Payloads of note and sys-ex diff commands can be saved in a compact binary
+ * form, base64-encoded as the content of the element that would otherwise hold
+ * one child node per note or change (see Config->get_binary_midi_history()).
+ * Each payload starts with a version byte, followed by fixed-size records of
+ * little-endian integers; times are stored as beats + ticks.
+ * Commands in this form are saved as Binary{Note,SysEx}DiffCommand, which
+ * older versions do not know and skip, rather than reading the payloads as
+ * empty commands; payloads are only honoured inside such a command.
+ */
+#define BINARY_ENCODING "binary"
+
+namespace {
+
+const uint8_t binary_history_version = 1;
+
+/* id, time, length, note, channel, velocity, padding */
+const size_t note_record_size = 24;
+/* property, padding, id, old value, new value */
+const size_t change_record_size = 24;
+
+class HistoryWriter
+{
+public:
+	HistoryWriter () {
+		_buf.push_back (binary_history_version);
+	}
+
+	void u8 (uint8_t v) {
+		_buf.push_back (v);
+	}
+
+	void i32 (int32_t v) {
+		uint32_t const u = v;
+		for (int shift = 0; shift < 32; shift += 8) {
+			_buf.push_back ((u >> shift) & 0xff);
+		}
+	}
+
+	void beats (Temporal::Beats const& b) {
+		i32 (b.get_beats ());
+		i32 (b.get_ticks ());
+	}
+
+	void note (MidiModel::NotePtr const& n) {
+		i32 (n->id ());
+		beats (n->time ());
+		beats (n->length ());
+		u8 (n->note ());
+		u8 (n->channel ());
+		u8 (n->velocity ());
+		u8 (0);
+	}
+
+	std::string base64 () const {
+		gchar* b64 = g_base64_encode (&_buf[0], _buf.size ());
+		std::string s (b64);
+		g_free (b64);
+		return s;
+	}
+
+private:
+	std::vector<guchar> _buf;
+};
+
+class HistoryReader
+{
+public:
+	HistoryReader (std::string const& b64)
+		: _pos (1)
+	{
+		gsize size;
+		_buf = g_base64_decode (b64.c_str (), &size);
+		_size = size;
+
+		if (_size > 0 && _buf[0] != binary_history_version) {
+			error << string_compose (_("Unknown version %1 of binary MIDI history - ignored"), (int) _buf[0]) << endmsg;
+			_size = 0;
+		}
+	}
+
+	~HistoryReader () {
+		g_free (_buf);
+	}
+
+	/** @return true if there is another record of @a record_size bytes to read */
+	bool more (size_t record_size) const {
+		return _pos + record_size <= _size;
+	}
+
+	uint8_t u8 () {
+		return _buf[_pos++];
+	}
+
+	int32_t i32 () {
+		uint32_t u = 0;
+		for (int shift = 0; shift < 32; shift += 8) {
+			u |= (uint32_t) _buf[_pos++] << shift;
+		}
+		return (int32_t) u;
+	}
+
+	Temporal::Beats beats () {
+		int32_t const b = i32 ();
+		int32_t const t = i32 ();
+		return Temporal::Beats (b, t);
+	}
+
+	MidiModel::NotePtr note () {
+		Evoral::event_id_t const id = i32 ();
+		Temporal::Beats const time = beats ();
+		Temporal::Beats const length = beats ();
+		uint8_t const note = u8 ();
+		uint8_t const channel = u8 ();
+		uint8_t const velocity = u8 ();
+		u8 ();
+
+		MidiModel::NotePtr n (boost::make_shared<Evoral::Note<MidiModel::TimeType> > (channel, time, length, note, velocity));
+		n->set_id (id);
+		return n;
+	}
+
+private:
+	guchar* _buf;
+	size_t  _size;
+	size_t  _pos;
+};
+
+template<typename Container>
+std::string
+encode_notes (Container const& notes)
+{
+	HistoryWriter w;
+	for (typename Container::const_iterator i = notes.begin(); i != notes.end(); ++i) {
+		w.note (*i);
+	}
+	return w.base64 ();
+}
+
+template<typename OutputIterator>
+void
+decode_notes (std::string const& b64, OutputIterator out)
+{
+	HistoryReader r (b64);
+	while (r.more (note_record_size)) {
+		*out++ = r.note ();
+	}
+}
+
+/** @return the binary payload of @a node, or an empty string if it holds XML children */
+std::string
+binary_payload (XMLNode const* node)
+{
+	std::string encoding;
+
+	if (!node || !node->get_property ("encoding", encoding)) {
+		return std::string ();
+	}
+
+	if (encoding != BINARY_ENCODING) {
+		error << string_compose (_("Unknown encoding \"%1\" of MIDI history - ignored"), encoding) << endmsg;
+		return std::string ();
+	}
+
+	for (XMLNodeList::const_iterator n = node->children().begin(); n != node->children().end(); ++n) {
+		if ((*n)->is_content ()) {
+			return (*n)->content ();
+		}
+	}
+
+	/* an empty payload: just the version */
+	return HistoryWriter().base64 ();
+}
+
+void
+add_binary_payload (XMLNode* node, std::string const& b64)
+{
+	node->set_property ("encoding", BINARY_ENCODING);
+	node->add_content (b64);
+}
+
+} // anonymous namespace
+
 MidiModel::DiffCommand::DiffCommand(boost::shared_ptr<MidiModel> m, const std::string& name)
 	: Command (name)
 	, _model (m)
@@ -154,6 +343,7 @@ MidiModel::NoteDiffCommand::NoteDiffCommand (boost::shared_ptr<MidiModel> m, con
 void
 MidiModel::NoteDiffCommand::add (const NotePtr note)
 {
+	decode ();
 	_removed_notes.remove(note);
 	_added_notes.push_back(note);
 }
@@ -161,6 +351,7 @@ MidiModel::NoteDiffCommand::add (const NotePtr note)
 void
 MidiModel::NoteDiffCommand::remove (const NotePtr note)
 {
+	decode ();
 	_added_notes.remove(note);
 	_removed_notes.push_back(note);
 }
@@ -168,6 +359,7 @@ MidiModel::NoteDiffCommand::remove (const NotePtr note)
 void
 MidiModel::NoteDiffCommand::side_effect_remove (const NotePtr note)
 {
+	decode ();
 	side_effect_removals.insert (note);
 }
 
@@ -213,6 +405,8 @@ MidiModel::NoteDiffCommand::change (const NotePtr  note,
 {
 	assert (note);
 
+	decode ();
+
 	const NoteChange change = {
 		prop, note, 0, get_value(note, prop), new_value
 	};
@@ -235,6 +429,9 @@ MidiModel::NoteDiffCommand::operator+= (const NoteDiffCommand& other)
 		return *this;
 	}
 
+	decode ();
+	other.decode ();
+
 	_added_notes.insert (_added_notes.end(), other._added_notes.begin(), other._added_notes.end());
 	_removed_notes.insert (_removed_notes.end(), other._removed_notes.begin(), other._removed_notes.end());
 	side_effect_removals.insert (other.side_effect_removals.begin(), other.side_effect_removals.end());
@@ -243,9 +440,58 @@ MidiModel::NoteDiffCommand::operator+= (const NoteDiffCommand& other)
 	return *this;
 }
 
+void
+MidiModel::NoteDiffCommand::set_value (const NotePtr note, Property prop, const Variant& value)
+{
+	switch (prop) {
+	case NoteNumber:
+		note->set_note (value.get_int());
+		break;
+	case Velocity:
+		note->set_velocity (value.get_int());
+		break;
+	case Channel:
+		note->set_channel (value.get_int());
+		break;
+	case StartTime:
+		note->set_time (value.get_beats());
+		break;
+	case Length:
+		note->set_length (value.get_beats());
+		break;
+	}
+}
+
+/** @return true if changing @a prop changes the position of a note in the model's indexes */
+bool
+MidiModel::NoteDiffCommand::indexed (Property prop)
+{
+	switch (prop) {
+	case NoteNumber:
+	case StartTime:
+	case Channel:
+		return true;
+	case Velocity:
+	case Length:
+		/* no remove-then-add required for these properties, since we do not index them */
+		break;
+	}
+
+	return false;
+}
+
+/** Apply all adds, removes and changes as one edit of the model.
+ *
+ * Notes whose indexed properties change are taken out of the model all at
+ * once, together with the removed notes, and are then changed and re-added
+ * (which resolves overlaps). This keeps edits of many notes at a time, like
+ * quantizing or transposing a whole region, linear in the size of the model.
+ */
 void
 MidiModel::NoteDiffCommand::operator() ()
 {
+	decode ();
+
 	{
 		MidiModel::WriteLock lock(_model->edit_lock());
 
@@ -258,15 +504,10 @@ MidiModel::NoteDiffCommand::operator() ()
 			}
 		}
 
-		for (NoteList::iterator i = _removed_notes.begin(); i != _removed_notes.end(); ++i) {
-			_model->remove_note_unlocked(*i);
-		}
-
 		/* notes we modify in a way that requires remove-then-add to maintain ordering */
 		set<NotePtr> temporary_removals;
 
 		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			Property prop = i->property;
 
 			if (!i->note) {
 				/* note found during deserialization, so try
@@ -276,43 +517,17 @@ MidiModel::NoteDiffCommand::operator() ()
 				assert (i->note);
 			}
 
-			switch (prop) {
-			case NoteNumber:
-				if (temporary_removals.find (i->note) == temporary_removals.end()) {
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
-				}
-				i->note->set_note (i->new_value.get_int());
-				break;
-
-			case StartTime:
-				if (temporary_removals.find (i->note) == temporary_removals.end()) {
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
-				}
-				i->note->set_time (i->new_value.get_beats());
-				break;
-
-			case Channel:
-				if (temporary_removals.find (i->note) == temporary_removals.end()) {
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
-				}
-				i->note->set_channel (i->new_value.get_int());
-				break;
-
-				/* no remove-then-add required for these properties, since we do not index them
-				 */
-
-			case Velocity:
-				i->note->set_velocity (i->new_value.get_int());
-				break;
+			if (indexed (i->property)) {
+				temporary_removals.insert (i->note);
+			}
+		}
 
-			case Length:
-				i->note->set_length (i->new_value.get_beats());
-				break;
+		set<NotePtr> removals (temporary_removals);
+		removals.insert (_removed_notes.begin(), _removed_notes.end());
+		_model->remove_notes_unlocked (removals);
 
-			}
+		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
+			set_value (i->note, i->property, i->new_value);
 		}
 
 		for (set<NotePtr>::iterator i = temporary_removals.begin(); i != temporary_removals.end(); ++i) {
@@ -343,13 +558,11 @@ MidiModel::NoteDiffCommand::operator() ()
 void
 MidiModel::NoteDiffCommand::undo ()
 {
+	decode ();
+
 	{
 		MidiModel::WriteLock lock(_model->edit_lock());
 
-		for (NoteList::iterator i = _added_notes.begin(); i != _added_notes.end(); ++i) {
-			_model->remove_note_unlocked(*i);
-		}
-
 		/* Apply changes first; this is important in the case of a note change which
 		   resulted in the note being removed by the overlap checker.  If the overlap
 		   checker removes a note, it will be in _removed_notes.  We are going to re-add
@@ -357,10 +570,6 @@ MidiModel::NoteDiffCommand::undo ()
 		   checker doesn't refuse the re-add.
 		*/
 
-		/* notes we modify in a way that requires remove-then-add to maintain ordering */
-		set<NotePtr> temporary_removals;
-
-
 		/* lazily discover any affected notes that were not discovered when
 		 * loading the history because of deletions, etc.
 		 */
@@ -372,61 +581,25 @@ MidiModel::NoteDiffCommand::undo ()
 			}
 		}
 
-		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
-			Property prop = i->property;
-
-			switch (prop) {
-			case NoteNumber:
-				if (temporary_removals.find (i->note) == temporary_removals.end() &&
-				    find (_removed_notes.begin(), _removed_notes.end(), i->note) == _removed_notes.end()) {
-
-					/* We only need to mark this note for re-add if (a) we haven't
-					   already marked it and (b) it isn't on the _removed_notes
-					   list (which means that it has already been removed and it
-					   will be re-added anyway)
-					*/
-
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
-				}
-				i->note->set_note (i->old_value.get_int());
-				break;
-
-			case StartTime:
-				if (temporary_removals.find (i->note) == temporary_removals.end() &&
-				    find (_removed_notes.begin(), _removed_notes.end(), i->note) == _removed_notes.end()) {
-
-					/* See above ... */
-
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
-				}
-				i->note->set_time (i->old_value.get_beats());
-				break;
-
-			case Channel:
-				if (temporary_removals.find (i->note) == temporary_removals.end() &&
-				    find (_removed_notes.begin(), _removed_notes.end(), i->note) == _removed_notes.end()) {
-
-					/* See above ... */
-
-					_model->remove_note_unlocked (i->note);
-					temporary_removals.insert (i->note);
-				}
-				i->note->set_channel (i->old_value.get_int());
-				break;
+		/* notes we modify in a way that requires remove-then-add to maintain ordering.
+		   Notes on the _removed_notes list have already been removed, and will be
+		   re-added anyway.
+		*/
+		set<NotePtr> const removed (_removed_notes.begin(), _removed_notes.end());
+		set<NotePtr> temporary_removals;
 
-				/* no remove-then-add required for these properties, since we do not index them
-				 */
+		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
+			if (indexed (i->property) && removed.find (i->note) == removed.end()) {
+				temporary_removals.insert (i->note);
+			}
+		}
 
-			case Velocity:
-				i->note->set_velocity (i->old_value.get_int());
-				break;
+		set<NotePtr> removals (temporary_removals);
+		removals.insert (_added_notes.begin(), _added_notes.end());
+		_model->remove_notes_unlocked (removals);
 
-			case Length:
-				i->note->set_length (i->old_value.get_beats());
-				break;
-			}
+		for (ChangeList::iterator i = _changes.begin(); i != _changes.end(); ++i) {
+			set_value (i->note, i->property, i->old_value);
 		}
 
 		for (NoteList::iterator i = _removed_notes.begin(); i != _removed_notes.end(); ++i) {
@@ -504,7 +677,7 @@ MidiModel::NoteDiffCommand::unmarshal_note (XMLNode *xml_note)
 		velocity = 127;
 	}
 
-	NotePtr note_ptr(new Evoral::Note<TimeType>(channel, time, length, note, velocity));
+	NotePtr note_ptr (boost::make_shared<Evoral::Note<TimeType> > (channel, time, length, note, velocity));
 	note_ptr->set_id (id);
 
 	return note_ptr;
@@ -596,18 +769,132 @@ MidiModel::NoteDiffCommand::unmarshal_change (XMLNode *xml_change)
 	return change;
 }
 
+std::string
+MidiModel::NoteDiffCommand::encode_changes () const
+{
+	HistoryWriter w;
+
+	for (ChangeList::const_iterator i = _changes.begin(); i != _changes.end(); ++i) {
+		w.u8 (i->property);
+		w.u8 (0);
+		w.u8 (0);
+		w.u8 (0);
+		w.i32 (i->note ? i->note->id () : i->note_id);
+
+		if (i->property == StartTime || i->property == Length) {
+			w.beats (i->old_value.get_beats ());
+			w.beats (i->new_value.get_beats ());
+		} else {
+			w.i32 (i->old_value.get_int ());
+			w.i32 (0);
+			w.i32 (i->new_value.get_int ());
+			w.i32 (0);
+		}
+	}
+
+	return w.base64 ();
+}
+
+void
+MidiModel::NoteDiffCommand::decode_changes (const std::string& b64)
+{
+	HistoryReader r (b64);
+	ChangeList changes;
+
+	while (r.more (change_record_size)) {
+		NoteChange change;
+
+		change.property = (Property) r.u8 ();
+		r.u8 ();
+		r.u8 ();
+		r.u8 ();
+
+		Evoral::event_id_t const id = r.i32 ();
+
+		if (change.property == StartTime || change.property == Length) {
+			change.old_value = Variant (r.beats ());
+			change.new_value = Variant (r.beats ());
+		} else {
+			change.old_value = Variant (r.i32 ());
+			r.i32 ();
+			change.new_value = Variant (r.i32 ());
+			r.i32 ();
+		}
+
+		change.note_id = id;
+
+		changes.push_back (change);
+	}
+
+	if (changes.empty()) {
+		return;
+	}
+
+	/* point at the instances of the notes that are actually in the model
+	   (see unmarshal_change()), looking them all up in one pass.
+	*/
+	std::map<Evoral::event_id_t, NotePtr> by_id;
+
+	for (Notes::const_iterator n = _model->notes().begin(); n != _model->notes().end(); ++n) {
+		by_id.insert (std::make_pair ((*n)->id(), *n));
+	}
+
+	for (ChangeList::iterator i = changes.begin(); i != changes.end(); ++i) {
+		std::map<Evoral::event_id_t, NotePtr>::const_iterator n = by_id.find (i->note_id);
+		if (n != by_id.end()) {
+			i->note = n->second;
+		}
+	}
+
+	_changes.splice (_changes.end(), changes);
+}
+
+void
+MidiModel::NoteDiffCommand::decode () const
+{
+	if (!_encoded) {
+		return;
+	}
+
+	/* decoding does not change what the command does */
+	NoteDiffCommand* self = const_cast<NoteDiffCommand*> (this);
+
+	boost::scoped_ptr<Encoded> e;
+	e.swap (self->_encoded);
+
+	decode_notes (e->added_notes, back_inserter (self->_added_notes));
+	decode_notes (e->removed_notes, back_inserter (self->_removed_notes));
+	decode_notes (e->side_effect_removals, inserter (self->side_effect_removals, self->side_effect_removals.end()));
+	self->decode_changes (e->changes);
+}
+
 int
 MidiModel::NoteDiffCommand::set_state (const XMLNode& diff_command, int /*version*/)
 {
-	if (diff_command.name() != string (NOTE_DIFF_COMMAND_ELEMENT)) {
+	_encoded.reset ();
+
+	if (diff_command.name() == string (BINARY_NOTE_DIFF_COMMAND_ELEMENT)) {
+
+		/* binary payloads are kept as they are until the command is used */
+
+		_encoded.reset (new Encoded);
+		_encoded->added_notes = binary_payload (diff_command.child (ADDED_NOTES_ELEMENT));
+		_encoded->removed_notes = binary_payload (diff_command.child (REMOVED_NOTES_ELEMENT));
+		_encoded->changes = binary_payload (diff_command.child (DIFF_NOTES_ELEMENT));
+		_encoded->side_effect_removals = binary_payload (diff_command.child (SIDE_EFFECT_REMOVALS_ELEMENT));
+
+	} else if (diff_command.name() != string (NOTE_DIFF_COMMAND_ELEMENT)) {
 		return 1;
 	}
 
+	Encoded none;
+	Encoded const& e (_encoded ? *_encoded : none);
+
 	/* additions */
 
 	_added_notes.clear();
 	XMLNode* added_notes = diff_command.child(ADDED_NOTES_ELEMENT);
-	if (added_notes) {
+	if (added_notes && e.added_notes.empty()) {
 		XMLNodeList notes = added_notes->children();
 		transform(notes.begin(), notes.end(), back_inserter(_added_notes),
 		          boost::bind (&NoteDiffCommand::unmarshal_note, this, _1));
@@ -618,7 +905,7 @@ MidiModel::NoteDiffCommand::set_state (const XMLNode& diff_command, int /*versio
 
 	_removed_notes.clear();
 	XMLNode* removed_notes = diff_command.child(REMOVED_NOTES_ELEMENT);
-	if (removed_notes) {
+	if (removed_notes && e.removed_notes.empty()) {
 		XMLNodeList notes = removed_notes->children();
 		transform(notes.begin(), notes.end(), back_inserter(_removed_notes),
 		          boost::bind (&NoteDiffCommand::unmarshal_note, this, _1));
@@ -631,7 +918,7 @@ MidiModel::NoteDiffCommand::set_state (const XMLNode& diff_command, int /*versio
 
 	XMLNode* changed_notes = diff_command.child(DIFF_NOTES_ELEMENT);
 
-	if (changed_notes) {
+	if (changed_notes && e.changes.empty()) {
 		XMLNodeList notes = changed_notes->children();
 		transform (notes.begin(), notes.end(), back_inserter(_changes),
 		           boost::bind (&NoteDiffCommand::unmarshal_change, this, _1));
@@ -644,7 +931,7 @@ MidiModel::NoteDiffCommand::set_state (const XMLNode& diff_command, int /*versio
 
 	XMLNode* side_effect_notes = diff_command.child(SIDE_EFFECT_REMOVALS_ELEMENT);
 
-	if (side_effect_notes) {
+	if (side_effect_notes && e.side_effect_removals.empty()) {
 		XMLNodeList notes = side_effect_notes->children();
 		for (XMLNodeList::iterator n = notes.begin(); n != notes.end(); ++n) {
 			side_effect_removals.insert (unmarshal_note (*n));
@@ -657,9 +944,35 @@ MidiModel::NoteDiffCommand::set_state (const XMLNode& diff_command, int /*versio
 XMLNode&
 MidiModel::NoteDiffCommand::get_state ()
 {
+	if (Config->get_binary_midi_history ()) {
+
+		XMLNode* diff_command = new XMLNode (BINARY_NOTE_DIFF_COMMAND_ELEMENT);
+		diff_command->set_property("midi-source", _model->midi_source()->id().to_s());
+
+		/* anything not decoded yet is written back as it was read */
+		Encoded const* e = _encoded.get ();
+
+		add_binary_payload (diff_command->add_child (DIFF_NOTES_ELEMENT),
+		                    e && !e->changes.empty() ? e->changes : encode_changes ());
+		add_binary_payload (diff_command->add_child (ADDED_NOTES_ELEMENT),
+		                    e && !e->added_notes.empty() ? e->added_notes : encode_notes (_added_notes));
+		add_binary_payload (diff_command->add_child (REMOVED_NOTES_ELEMENT),
+		                    e && !e->removed_notes.empty() ? e->removed_notes : encode_notes (_removed_notes));
+
+		if (e && !e->side_effect_removals.empty()) {
+			add_binary_payload (diff_command->add_child (SIDE_EFFECT_REMOVALS_ELEMENT), e->side_effect_removals);
+		} else if (!side_effect_removals.empty()) {
+			add_binary_payload (diff_command->add_child (SIDE_EFFECT_REMOVALS_ELEMENT), encode_notes (side_effect_removals));
+		}
+
+		return *diff_command;
+	}
+
 	XMLNode* diff_command = new XMLNode (NOTE_DIFF_COMMAND_ELEMENT);
 	diff_command->set_property("midi-source", _model->midi_source()->id().to_s());
 
+	decode ();
+
 	XMLNode* changes = diff_command->add_child(DIFF_NOTES_ELEMENT);
 	for_each(_changes.begin(), _changes.end(),
 	         boost::bind (
@@ -702,6 +1015,8 @@ MidiModel::SysExDiffCommand::SysExDiffCommand (boost::shared_ptr<MidiModel> m, c
 void
 MidiModel::SysExDiffCommand::change (boost::shared_ptr<Evoral::Event<TimeType> > s, TimeType new_time)
 {
+	decode ();
+
 	Change change;
 
 	change.sysex = s;
@@ -715,6 +1030,8 @@ MidiModel::SysExDiffCommand::change (boost::shared_ptr<Evoral::Event<TimeType> >
 void
 MidiModel::SysExDiffCommand::operator() ()
 {
+	decode ();
+
 	{
 		MidiModel::WriteLock lock (_model->edit_lock ());
 
@@ -745,6 +1062,8 @@ MidiModel::SysExDiffCommand::operator() ()
 void
 MidiModel::SysExDiffCommand::undo ()
 {
+	decode ();
+
 	{
 		MidiModel::WriteLock lock (_model->edit_lock ());
 
@@ -774,6 +1093,34 @@ MidiModel::SysExDiffCommand::undo ()
 	_model->ContentsChanged(); /* EMIT SIGNAL */
 }
 
+void
+MidiModel::SysExDiffCommand::decode ()
+{
+	if (_encoded_changes.empty()) {
+		return;
+	}
+
+	HistoryReader r (_encoded_changes);
+	_encoded_changes.clear ();
+
+	while (r.more (change_record_size)) {
+		Change change;
+
+		change.property = (Property) r.u8 ();
+		r.u8 ();
+		r.u8 ();
+		r.u8 ();
+		change.sysex_id = r.i32 ();
+		change.old_time = r.beats ();
+		change.new_time = r.beats ();
+
+		/* see unmarshal_change() */
+		change.sysex = _model->find_sysex (change.sysex_id);
+
+		_changes.push_back (change);
+	}
+}
+
 void
 MidiModel::SysExDiffCommand::remove (SysExPtr sysex)
 {
@@ -834,7 +1181,9 @@ MidiModel::SysExDiffCommand::unmarshal_change (XMLNode *xml_change)
 int
 MidiModel::SysExDiffCommand::set_state (const XMLNode& diff_command, int /*version*/)
 {
-	if (diff_command.name() != string (SYSEX_DIFF_COMMAND_ELEMENT)) {
+	bool const binary = diff_command.name() == string (BINARY_SYSEX_DIFF_COMMAND_ELEMENT);
+
+	if (!binary && diff_command.name() != string (SYSEX_DIFF_COMMAND_ELEMENT)) {
 		return 1;
 	}
 
@@ -844,7 +1193,10 @@ MidiModel::SysExDiffCommand::set_state (const XMLNode& diff_command, int /*versi
 
 	XMLNode* changed_sysexes = diff_command.child (DIFF_SYSEXES_ELEMENT);
 
-	if (changed_sysexes) {
+	/* a binary payload is kept as it is until the command is used */
+	_encoded_changes = binary ? binary_payload (changed_sysexes) : std::string ();
+
+	if (changed_sysexes && _encoded_changes.empty()) {
 		XMLNodeList sysexes = changed_sysexes->children();
 		transform (sysexes.begin(), sysexes.end(), back_inserter (_changes),
 		           boost::bind (&SysExDiffCommand::unmarshal_change, this, _1));
@@ -857,9 +1209,37 @@ MidiModel::SysExDiffCommand::set_state (const XMLNode& diff_command, int /*versi
 XMLNode&
 MidiModel::SysExDiffCommand::get_state ()
 {
+	if (Config->get_binary_midi_history ()) {
+
+		XMLNode* diff_command = new XMLNode (BINARY_SYSEX_DIFF_COMMAND_ELEMENT);
+		diff_command->set_property ("midi-source", _model->midi_source()->id().to_s());
+
+		std::string payload = _encoded_changes;
+
+		if (payload.empty()) {
+			HistoryWriter w;
+			for (ChangeList::const_iterator i = _changes.begin(); i != _changes.end(); ++i) {
+				w.u8 (i->property);
+				w.u8 (0);
+				w.u8 (0);
+				w.u8 (0);
+				w.i32 (i->sysex ? i->sysex->id () : i->sysex_id);
+				w.beats (i->old_time);
+				w.beats (i->new_time);
+			}
+			payload = w.base64 ();
+		}
+
+		add_binary_payload (diff_command->add_child (DIFF_SYSEXES_ELEMENT), payload);
+
+		return *diff_command;
+	}
+
 	XMLNode* diff_command = new XMLNode (SYSEX_DIFF_COMMAND_ELEMENT);
 	diff_command->set_property ("midi-source", _model->midi_source()->id().to_s());
 
+	decode ();
+
 	XMLNode* changes = diff_command->add_child(DIFF_SYSEXES_ELEMENT);
 	for_each (_changes.begin(), _changes.end(),
 	          boost::bind (
@@ -358,9 +358,9 @@ MidiTrack::realtime_locate ()
 }
 
 void
-MidiTrack::non_realtime_locate (samplepos_t pos)
+MidiTrack::non_realtime_locate_processors (samplepos_t pos)
 {
-	Track::non_realtime_locate(pos);
+	Track::non_realtime_locate_processors (pos);
 
 	boost::shared_ptr<MidiPlaylist> playlist = _disk_writer->midi_playlist();
 	if (!playlist) {
@@ -324,6 +324,7 @@ Playlist::init (bool hide)
 	_capture_insertion_underway = false;
 	_combine_ops = 0;
 	_end_space = 0;
+	_region_index_valid = false;
 
 	_session.history().BeginUndoRedo.connect_same_thread (*this, boost::bind (&Playlist::begin_undo, this));
 	_session.history().EndUndoRedo.connect_same_thread (*this, boost::bind (&Playlist::end_undo, this));
@@ -759,6 +760,7 @@ Playlist::add_region_internal (boost::shared_ptr<Region> region, samplepos_t pos
 
 	regions.insert (upper_bound (regions.begin(), regions.end(), region, cmp), region);
 	all_regions.insert (region);
+	invalidate_region_index ();
 
 	possibly_splice_unlocked (position, region->length(), region);
 
@@ -820,6 +822,7 @@ Playlist::remove_region_internal (boost::shared_ptr<Region> region)
 			samplecnt_t distance = (*i)->length();
 
 			regions.erase (i);
+			invalidate_region_index ();
 
 			possibly_splice_unlocked (pos, -distance);
 
@@ -1704,6 +1707,13 @@ Playlist::region_bounds_changed (const PropertyChange& what_changed, boost::shar
 		 return;
 	 }
 
+	 if (what_changed.contains (Properties::position) || what_changed.contains (Properties::length)) {
+		 /* regions_invalidated() is not needed, derived classes
+		  * see the change in region_changed()
+		  */
+		 drop_region_index ();
+	 }
+
 	 /* this makes a virtual call to the right kind of playlist ... */
 
 	 region_changed (what_changed, region);
@@ -1764,6 +1774,7 @@ Playlist::region_bounds_changed (const PropertyChange& what_changed, boost::shar
 	 RegionWriteLock rl (this);
 	 regions.clear ();
 	 all_regions.clear ();
+	 invalidate_region_index ();
  }
 
  void
@@ -1792,6 +1803,7 @@ Playlist::region_bounds_changed (const PropertyChange& what_changed, boost::shar
 		 }
 
 		 regions.clear ();
+		 invalidate_region_index ();
 
 		 for (set<boost::shared_ptr<Region> >::iterator s = pending_removes.begin(); s != pending_removes.end(); ++s) {
 			 remove_dependents (*s);
@@ -1844,15 +1856,9 @@ Playlist::regions_at (samplepos_t sample)
  Playlist::count_regions_at (samplepos_t sample) const
  {
 	 RegionReadLock rlock (const_cast<Playlist*>(this));
-	 uint32_t cnt = 0;
-
-	 for (RegionList::const_iterator i = regions.begin(); i != regions.end(); ++i) {
-		 if ((*i)->covers (sample)) {
-			 cnt++;
-		 }
-	 }
+	 Glib::Threads::Mutex::Lock lm (_region_index_lock);
 
-	 return cnt;
+	 return region_index ().count_covering (sample);
  }
 
  boost::shared_ptr<Region>
@@ -1910,11 +1916,8 @@ Playlist::find_regions_at (samplepos_t sample)
 
 	boost::shared_ptr<RegionList> rlist (new RegionList);
 
-	for (RegionList::iterator i = regions.begin(); i != regions.end(); ++i) {
-		if ((*i)->covers (sample)) {
-			rlist->push_back (*i);
-		}
-	}
+	Glib::Threads::Mutex::Lock lm (_region_index_lock);
+	region_index ().covering (sample, *rlist);
 
 	return rlist;
 }
@@ -1965,13 +1968,41 @@ Playlist::regions_touched_locked (samplepos_t start, samplepos_t end)
 {
 	boost::shared_ptr<RegionList> rlist (new RegionList);
 
-	for (RegionList::iterator i = regions.begin(); i != regions.end(); ++i) {
-		if ((*i)->coverage (start, end) != Evoral::OverlapNone) {
-			rlist->push_back (*i);
+	Glib::Threads::Mutex::Lock lm (_region_index_lock);
+	region_index ().overlapping (start, end, *rlist);
+
+	return rlist;
+}
+
+void
+Playlist::invalidate_region_index ()
+{
+	drop_region_index ();
+	regions_invalidated ();
+}
+
+void
+Playlist::drop_region_index ()
+{
+	Glib::Threads::Mutex::Lock lm (_region_index_lock);
+	_region_index.clear ();
+	_region_index_valid = false;
+}
+
+Playlist::RegionIndex const&
+Playlist::region_index () const
+{
+	/* Caller must hold the region lock and _region_index_lock */
+
+	if (!_region_index_valid) {
+		for (RegionList::const_iterator i = regions.begin(); i != regions.end(); ++i) {
+			_region_index.add ((*i)->first_sample (), (*i)->last_sample (), *i);
 		}
+		_region_index.build ();
+		_region_index_valid = true;
 	}
 
-	return rlist;
+	return _region_index;
 }
 
 samplepos_t
@@ -1980,17 +2011,20 @@ Playlist::find_next_transient (samplepos_t from, int dir)
 	RegionReadLock rlock (this);
 	AnalysisFeatureList points;
 	AnalysisFeatureList these_points;
+	RegionList candidates;
 
-	for (RegionList::iterator i = regions.begin(); i != regions.end(); ++i) {
+	{
+		Glib::Threads::Mutex::Lock lm (_region_index_lock);
 		if (dir > 0) {
-			if ((*i)->last_sample() < from) {
-				continue;
-			}
+			/* regions that end at or after from */
+			region_index ().overlapping (from, max_samplepos, candidates);
 		} else {
-			if ((*i)->first_sample() > from) {
-				continue;
-			}
+			/* regions that start at or before from */
+			region_index ().overlapping (0, from, candidates);
 		}
+	}
+
+	for (RegionList::iterator i = candidates.begin(); i != candidates.end(); ++i) {
 
 		(*i)->get_transients (these_points);
 
@@ -2041,6 +2075,29 @@ Playlist::find_next_region (samplepos_t sample, RegionPoint point, int dir)
 	boost::shared_ptr<Region> ret;
 	samplepos_t closest = max_samplepos;
 
+	if (point == Start) {
+		/* regions are indexed by their start, no need to look at all of them */
+		Glib::Threads::Mutex::Lock lm (_region_index_lock);
+		RegionIndex const& idx (region_index ());
+		RegionIndex::Entries const& e (idx.entries ());
+
+		if (dir == 1) {
+			size_t n = idx.first_starting_after (sample);
+			if (n < e.size ()) {
+				ret = e[n].value;
+			}
+		} else {
+			size_t n = idx.first_starting_at_or_after (sample);
+			if (n > 0) {
+				/* the first of all regions at the closest position */
+				n = idx.first_starting_at_or_after (e[n - 1].first);
+				ret = e[n].value;
+			}
+		}
+
+		return ret;
+	}
+
 	bool end_iter = false;
 
 	for (RegionList::iterator i = regions.begin(); i != regions.end(); ++i) {
@@ -2637,6 +2694,7 @@ Playlist::relayer ()
 	   but premature optimisation &c...
 	*/
 	notify_layering_changed ();
+	regions_invalidated ();
 
 	/* This relayer() may have been called as a result of a region removal, in which
 	   case we need to setup layering indices to account for the one that has just
@@ -2889,6 +2947,7 @@ Playlist::shuffle (boost::shared_ptr<Region> region, int dir)
 						regions.erase (i); // removes the region from the list */
 						next++;
 						regions.insert (next, region); // adds it back after next
+						invalidate_region_index ();
 
 						moved = true;
 					}
@@ -2929,6 +2988,7 @@ Playlist::shuffle (boost::shared_ptr<Region> region, int dir)
 
 						regions.erase (i); // remove region
 						regions.insert (prev, region); // insert region before prev
+						invalidate_region_index ();
 
 						moved = true;
 					}
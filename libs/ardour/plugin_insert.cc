@@ -21,6 +21,7 @@
 #include "libardour-config.h"
 #endif
 
+#include <cmath>
 #include <string>
 
 #include "pbd/failed_constructor.h"
@@ -83,6 +84,9 @@ PluginInsert::PluginInsert (Session& s, boost::shared_ptr<Plugin> plug)
 	, _maps_from_state (false)
 	, _latency_changed (false)
 	, _bypass_port (UINT32_MAX)
+	, _automation_buffer_size (0)
+	, _automation_sub_blocks (0)
+	, _automation_sub_blocks_saved (0)
 {
 	/* the first is the master */
 
@@ -525,6 +529,15 @@ PluginInsert::create_automatable_parameters ()
 		}
 	}
 	plugin->PresetPortSetValue.connect_same_thread (*this, boost::bind (&PluginInsert::preset_load_set_value, this, _1, _2));
+
+	for (Controls::const_iterator li = controls().begin(); li != controls().end(); ++li) {
+		boost::shared_ptr<AutomationControl> ac = boost::dynamic_pointer_cast<AutomationControl> (li->second);
+		if (ac && ac->alist()) {
+			ac->alist()->automation_state_changed.connect_same_thread (*this, boost::bind (&PluginInsert::control_automation_state_changed, this));
+		}
+	}
+
+	allocate_automation_buffers (_session.get_block_size ());
 }
 
 /** Called when something outside of this host has modified a plugin
@@ -585,6 +598,7 @@ PluginInsert::set_block_size (pframes_t nframes)
 			ret = -1;
 		}
 	}
+	allocate_automation_buffers (nframes);
 	return ret;
 }
 
@@ -1202,20 +1216,86 @@ PluginInsert::run (BufferSet& bufs, samplepos_t start_sample, samplepos_t end_sa
 	 */
 }
 
+/** Smallest sub-block that automation splits a cycle into, in samples */
+static const pframes_t automation_min_block = 32;
+/** Largest number of sub-blocks that automation splits a cycle into */
+static const pframes_t automation_max_blocks = 8;
+/** Change of a continuous parameter (relative to its range) that starts a new sub-block */
+static const float automation_tolerance = 1.f / 256.f;
+
 void
 PluginInsert::automate_and_run (BufferSet& bufs, samplepos_t start, samplepos_t end, double speed, pframes_t nframes)
 {
-	Evoral::ControlEvent next_event (0, 0.0f);
-	samplecnt_t offset = 0;
-
 	Glib::Threads::Mutex::Lock lm (control_lock(), Glib::Threads::TRY_LOCK);
 
 	if (!lm.locked()) {
-		connect_and_run (bufs, start, end, speed, nframes, offset, false);
+		connect_and_run (bufs, start, end, speed, nframes, 0, false);
+		return;
+	}
+
+	if (_plugins.front()->requires_fixed_sized_buffers()) {
+		connect_and_run (bufs, start, end, speed, nframes, 0, true);
+		return;
+	}
+
+	Glib::Threads::Mutex::Lock bl (_automation_buffer_lock, Glib::Threads::TRY_LOCK);
+
+	if (!bl.locked() || !render_automation (start, end, nframes)) {
+		/* buffers are being (re)allocated, or the cycle does not fit */
+		split_and_run (bufs, start, end, speed, nframes);
+		return;
+	}
+
+	if (_rendered_automation.empty ()) {
+		connect_and_run (bufs, start, end, speed, nframes, 0, false);
 		return;
 	}
 
-	if (!find_next_event (start, end, next_event) || _plugins.front()->requires_fixed_sized_buffers()) {
+	/* Run the plugin in sub-blocks that start where any of the parameters
+	 * has changed noticeably since the start of the current one. Changes
+	 * of discrete parameters are applied at their sample, interpolated
+	 * ones are not followed more closely than min_block.
+	 */
+	const pframes_t min_block = max (automation_min_block, (nframes + automation_max_blocks - 1) / automation_max_blocks);
+
+	uint32_t sub_blocks = 0;
+	pframes_t offset = 0;
+
+	while (offset < nframes) {
+		apply_rendered_automation (start, offset);
+
+		const pframes_t cnt = rendered_automation_block (offset, nframes, min_block);
+
+		connect_and_run (bufs, start + offset, start + offset + cnt, speed, cnt, offset, false); // XXX (start + cnt) * speed
+
+		offset += cnt;
+		++sub_blocks;
+	}
+
+	if (DEBUG_ENABLED (DEBUG::Automation)) {
+		/* count the sub-blocks that splitting at every control point would have used */
+		Evoral::ControlEvent next_event (0, 0.0f);
+		uint32_t by_events = 1;
+		for (samplepos_t pos = start; pos < end && find_next_event (pos, end, next_event); ++by_events) {
+			pos = max ((samplepos_t) ceil (next_event.when), pos + 1);
+		}
+		_automation_sub_blocks += sub_blocks;
+		_automation_sub_blocks_saved += (int64_t) by_events - sub_blocks;
+		if (sub_blocks != by_events) {
+			DEBUG_TRACE (DEBUG::Automation, string_compose ("%1: %2 sub-blocks instead of %3, %4 of %5 saved in total\n",
+			                                                name (), sub_blocks, by_events, _automation_sub_blocks_saved, _automation_sub_blocks));
+		}
+	}
+}
+
+/** Run the plugin in sub-blocks that start at every control point of its automation */
+void
+PluginInsert::split_and_run (BufferSet& bufs, samplepos_t start, samplepos_t end, double speed, pframes_t nframes)
+{
+	Evoral::ControlEvent next_event (0, 0.0f);
+	samplecnt_t offset = 0;
+
+	if (!find_next_event (start, end, next_event)) {
 
 		/* no events have a time within the relevant range */
 
@@ -1245,6 +1325,165 @@ PluginInsert::automate_and_run (BufferSet& bufs, samplepos_t start, samplepos_t
 	}
 }
 
+/** Called when the block size or the automation state of a control
+ *  changes. Buffers are only allocated for controls that may play
+ *  automation back.
+ */
+void
+PluginInsert::allocate_automation_buffers (pframes_t nframes)
+{
+	size_t n_automated = 0;
+
+	for (Controls::const_iterator li = controls().begin(); li != controls().end(); ++li) {
+		AutomationControl* c = dynamic_cast<AutomationControl*> (li->second.get());
+		if (c && c->alist() && (c->alist()->automation_state() & (Play | Touch | Latch))) {
+			++n_automated;
+		}
+	}
+
+	Glib::Threads::Mutex::Lock lm (_automation_buffer_lock);
+
+	_rendered_automation.reserve (n_automated);
+	_automation_buffer_size = nframes;
+
+	if (_automation_buffers.size() != n_automated * nframes) {
+		std::vector<float> (n_automated * nframes).swap (_automation_buffers);
+	}
+}
+
+void
+PluginInsert::control_automation_state_changed ()
+{
+	allocate_automation_buffers (_automation_buffer_size ? _automation_buffer_size : _session.get_block_size ());
+}
+
+/** Render the automation of all controls in playback mode for the cycle
+ *  into _automation_buffers, at once. Caller must hold _automation_buffer_lock.
+ *  @return false if the cycle does not fit in the buffers
+ */
+bool
+PluginInsert::render_automation (samplepos_t start, samplepos_t end, pframes_t nframes)
+{
+	_rendered_automation.clear ();
+
+	if (nframes > _automation_buffer_size) {
+		return false;
+	}
+
+	size_t used = 0;
+
+	for (Controls::iterator li = controls().begin(); li != controls().end(); ++li) {
+
+		AutomationControl* c = dynamic_cast<AutomationControl*> (li->second.get());
+
+		if (!c || !c->list() || !c->automation_playback()) {
+			continue;
+		}
+
+		if (used + nframes > _automation_buffers.size()) {
+			/* in playback mode before the buffers caught up */
+			_rendered_automation.clear ();
+			return false;
+		}
+
+		float* buf = &_automation_buffers[used];
+
+		const ParameterDescriptor& desc (c->desc());
+		boost::shared_ptr<const Evoral::ControlList> alist (c->list());
+
+		RenderedAutomation ra;
+		ra.control = c;
+		ra.values = alist->curve().rt_safe_get_vector (start, end, buf, nframes) ? buf : 0;
+		ra.exact = desc.toggled || desc.integer_step || desc.enumeration || alist->interpolation() == Evoral::ControlList::Discrete;
+		ra.logarithmic = desc.logarithmic && desc.lower > 0 && desc.upper > desc.lower;
+		if (ra.logarithmic) {
+			/* a factor, rather than a difference */
+			ra.tolerance = powf (desc.upper / desc.lower, automation_tolerance);
+		} else {
+			ra.tolerance = automation_tolerance * (desc.upper - desc.lower);
+		}
+		ra.lower = ra.upper = 0;
+
+		_rendered_automation.push_back (ra);
+		used += nframes;
+	}
+
+	return true;
+}
+
+/** Set all rendered controls to their value at @a offset into the cycle */
+void
+PluginInsert::apply_rendered_automation (samplepos_t start, pframes_t offset)
+{
+	for (RenderedAutomations::iterator i = _rendered_automation.begin(); i != _rendered_automation.end(); ++i) {
+		float val;
+
+		if (i->values) {
+			val = i->values[offset];
+		} else {
+			/* the list was busy when rendering, try again */
+			bool valid;
+			val = i->control->list()->rt_safe_eval (start + offset, valid);
+			if (!valid) {
+				continue;
+			}
+		}
+
+		/* see connect_and_run() */
+		i->control->set_value_unchecked (val);
+
+		if (i->exact) {
+			i->lower = i->upper = val;
+		} else if (i->logarithmic && val > 0) {
+			i->lower = val / i->tolerance;
+			i->upper = val * i->tolerance;
+		} else {
+			i->lower = val - i->tolerance;
+			i->upper = val + i->tolerance;
+		}
+	}
+}
+
+/** @return length of the sub-block that starts at @a offset: until any rendered
+ *  value leaves the range set by apply_rendered_automation(). Discrete values
+ *  end the sub-block exactly where they change, interpolated ones only after
+ *  at least @a min_block samples.
+ */
+pframes_t
+PluginInsert::rendered_automation_block (pframes_t offset, pframes_t nframes, pframes_t min_block) const
+{
+	pframes_t exact_end = nframes;
+	pframes_t end = nframes;
+
+	for (RenderedAutomations::const_iterator i = _rendered_automation.begin(); i != _rendered_automation.end(); ++i) {
+		if (!i->values) {
+			continue;
+		}
+		if (i->exact) {
+			for (pframes_t n = offset + 1; n < exact_end; ++n) {
+				if (i->values[n] != i->lower) {
+					exact_end = n;
+					break;
+				}
+			}
+		} else if (nframes - offset > min_block) {
+			for (pframes_t n = offset + min_block; n < end; ++n) {
+				if (i->values[n] < i->lower || i->values[n] > i->upper) {
+					end = n;
+					break;
+				}
+			}
+		}
+	}
+
+	/* do not leave a short remainder for interpolated values */
+	if (nframes - end < min_block) {
+		end = nframes;
+	}
+
+	return min (end, exact_end) - offset;
+}
+
 float
 PluginInsert::default_parameter_value (const Evoral::Parameter& param)
 {
@@ -0,0 +1,292 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifdef WAF_BUILD
+#include "libardour-config.h"
+#endif
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "pbd/gstdio_compat.h"
+
+#ifdef HAVE_URING
+#include <liburing.h>
+#endif
+
+#include "pbd/compose.h"
+
+#include "ardour/debug.h"
+#include "ardour/readahead_queue.h"
+
+using namespace ARDOUR;
+
+/** reads are merged if they are less than this far apart */
+static const off_t merge_gap = 64 * 1024;
+static const off_t page_size = 4096;
+
+ReadaheadQueue::ReadaheadQueue ()
+	: _batch (0)
+	, _ring (0)
+{
+#ifdef HAVE_URING
+	struct io_uring* ring = new struct io_uring;
+
+	if (io_uring_queue_init (256, ring, 0) == 0) {
+		/* fadvise through io_uring needs Linux 5.6 */
+		struct io_uring_probe* probe = io_uring_get_probe_ring (ring);
+		if (probe && io_uring_opcode_supported (probe, IORING_OP_FADVISE)) {
+			_ring = ring;
+		} else {
+			io_uring_queue_exit (ring);
+		}
+		free (probe);
+	}
+
+	if (!_ring) {
+		delete ring;
+	}
+#endif
+	DEBUG_TRACE (DEBUG::Butler, string_compose ("read-ahead %1 io_uring\n", _ring ? "uses" : "does not use"));
+}
+
+ReadaheadQueue::~ReadaheadQueue ()
+{
+	close_files ();
+
+#ifdef HAVE_URING
+	if (_ring) {
+		io_uring_queue_exit (_ring);
+		delete _ring;
+	}
+#endif
+}
+
+bool
+ReadaheadQueue::using_io_uring () const
+{
+	return _ring != 0;
+}
+
+void
+ReadaheadQueue::add (std::string const& path, off_t offset, size_t length)
+{
+	if (length > 0) {
+		_ranges[path].push_back (Range (offset, length));
+	}
+}
+
+int
+ReadaheadQueue::file_descriptor (std::string const& path)
+{
+	Files::iterator i = _files.find (path);
+
+	if (i != _files.end ()) {
+		GStatBuf st;
+
+		/* the file at @a path may have been removed or replaced since */
+		if (g_stat (path.c_str (), &st) == 0 && st.st_dev == i->second.dev && st.st_ino == i->second.ino) {
+			_file_lru.splice (_file_lru.begin (), _file_lru, i->second.lru);
+			i->second.batch = _batch;
+			return i->second.fd;
+		}
+
+		close_file (i);
+	}
+
+	int const fd = g_open (path.c_str (), O_RDONLY, 0444);
+
+	if (fd < 0) {
+		return -1;
+	}
+
+	struct stat st;
+
+	if (fstat (fd, &st) != 0) {
+		::close (fd);
+		return -1;
+	}
+
+	/* files of this batch stay open until it is submitted */
+	while (_files.size () >= max_open_files && _files[_file_lru.back ()].batch != _batch) {
+		close_file (_files.find (_file_lru.back ()));
+	}
+
+	_file_lru.push_front (path);
+
+	File f;
+	f.fd = fd;
+	f.dev = st.st_dev;
+	f.ino = st.st_ino;
+	f.batch = _batch;
+	f.lru = _file_lru.begin ();
+	_files[path] = f;
+
+	return fd;
+}
+
+void
+ReadaheadQueue::close_file (Files::iterator i)
+{
+	::close (i->second.fd);
+	_file_lru.erase (i->second.lru);
+	_files.erase (i);
+}
+
+/** Close the files that the last max_idle_batches batches did not use,
+ *  and the least recently used ones beyond max_open_files.
+ */
+void
+ReadaheadQueue::close_idle_files ()
+{
+	while (!_file_lru.empty ()) {
+		Files::iterator i = _files.find (_file_lru.back ());
+		if (_files.size () <= max_open_files && i->second.batch + max_idle_batches > _batch) {
+			/* and all that were used more recently */
+			break;
+		}
+		close_file (i);
+	}
+}
+
+void
+ReadaheadQueue::close_files ()
+{
+	for (Files::iterator i = _files.begin (); i != _files.end (); ++i) {
+		::close (i->second.fd);
+	}
+	_files.clear ();
+	_file_lru.clear ();
+}
+
+/** Sort @a ranges, align them to pages and merge those that overlap or are close */
+void
+ReadaheadQueue::coalesce (std::vector<Range>& ranges)
+{
+	std::sort (ranges.begin (), ranges.end ());
+
+	std::vector<Range> merged;
+
+	for (std::vector<Range>::const_iterator r = ranges.begin (); r != ranges.end (); ++r) {
+		off_t const start = (r->offset / page_size) * page_size;
+		off_t const end = r->offset + r->length;
+
+		if (!merged.empty ()) {
+			Range& last (merged.back ());
+			if (start <= last.offset + (off_t) last.length + merge_gap) {
+				last.length = std::max (last.offset + (off_t) last.length, end) - last.offset;
+				continue;
+			}
+		}
+
+		merged.push_back (Range (start, end - start));
+	}
+
+	ranges.swap (merged);
+}
+
+void
+ReadaheadQueue::advise (Requests const& requests)
+{
+#ifdef __linux__
+	/* WILLNEED only starts the reads; it does not wait for them */
+	for (Requests::const_iterator r = requests.begin (); r != requests.end (); ++r) {
+		posix_fadvise (r->fd, r->range.offset, r->range.length, POSIX_FADV_WILLNEED);
+	}
+#else
+	(void) requests;
+#endif
+}
+
+void
+ReadaheadQueue::submit ()
+{
+	Requests requests;
+
+	++_batch;
+
+	for (Ranges::iterator i = _ranges.begin (); i != _ranges.end (); ++i) {
+		int const fd = file_descriptor (i->first);
+		if (fd < 0) {
+			continue;
+		}
+		coalesce (i->second);
+		for (std::vector<Range>::const_iterator r = i->second.begin (); r != i->second.end (); ++r) {
+			requests.push_back (Request (fd, *r));
+		}
+	}
+
+	_ranges.clear ();
+
+	if (!requests.empty () && !(_ring && submit_io_uring (requests))) {
+		advise (requests);
+	}
+
+	/* the kernel holds its own references to the files by now */
+	close_idle_files ();
+}
+
+/** @return false if the ring failed, and the requests have to take the slow path */
+bool
+ReadaheadQueue::submit_io_uring (Requests const& requests)
+{
+#ifdef HAVE_URING
+	size_t done = 0;
+
+	while (done < requests.size ()) {
+
+		unsigned int queued = 0;
+		struct io_uring_sqe* sqe;
+
+		while (done + queued < requests.size () && (sqe = io_uring_get_sqe (_ring)) != 0) {
+			Request const& r (requests[done + queued]);
+			io_uring_prep_fadvise (sqe, r.fd, r.range.offset, r.range.length, POSIX_FADV_WILLNEED);
+			++queued;
+		}
+
+		if (io_uring_submit (_ring) < 0) {
+			if (done == 0) {
+				return false;
+			}
+			/* the rest is just not hinted */
+			return true;
+		}
+
+		/* fadvise only starts the reads; completions come in fast */
+		for (unsigned int n = 0; n < queued; ++n) {
+			struct io_uring_cqe* cqe;
+			if (io_uring_wait_cqe (_ring, &cqe) < 0) {
+				break;
+			}
+			io_uring_cqe_seen (_ring, cqe);
+		}
+
+		done += queued;
+	}
+
+	return true;
+#else
+	(void) requests;
+	return false;
+#endif
+}
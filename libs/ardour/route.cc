@@ -5041,6 +5041,13 @@ Route::non_realtime_locate (samplepos_t pos)
 		Glib::Threads::RWLock::ReaderLock lm (_processor_lock);
 
 		for (ProcessorList::iterator i = _processors.begin(); i != _processors.end(); ++i) {
+			if (!is_private_route() && boost::dynamic_pointer_cast<DiskIOProcessor> (*i)) {
+				/* tracks locate their disk I/O themselves, except
+				 * private ones (e.g. the auditioner), see
+				 * Track::non_realtime_locate_disk_reader()
+				 */
+				continue;
+			}
 			(*i)->non_realtime_locate (pos);
 		}
 	}
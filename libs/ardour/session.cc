@@ -50,12 +50,14 @@
 #include "ardour/amp.h"
 #include "ardour/analyser.h"
 #include "ardour/async_midi_port.h"
+#include "ardour/audio_block_cache.h"
 #include "ardour/audio_buffer.h"
 #include "ardour/audio_port.h"
 #include "ardour/audio_track.h"
 #include "ardour/audioengine.h"
 #include "ardour/audiofilesource.h"
 #include "ardour/auditioner.h"
+#include "ardour/background_sync.h"
 #include "ardour/boost_debug.h"
 #include "ardour/buffer_manager.h"
 #include "ardour/buffer_set.h"
@@ -250,6 +252,10 @@ Session::Session (AudioEngine &eng,
 	, lua (lua_newstate (&PBD::ReallocPool::lalloc, &_mempool))
 	, _n_lua_scripts (0)
 	, _butler (new Butler (*this))
+	, _audio_block_cache (new AudioBlockCache)
+	, _background_sync (new BackgroundSync)
+	, _locate_prefetch_kb (0)
+	, _loop_cache_kb (0)
 	, _post_transport_work (0)
 	,  cumulative_rf_motion (0)
 	, rf_scale (1.0)
@@ -766,8 +772,6 @@ Session::destroy ()
 	routes.flush ();
 	_bundles.flush ();
 
-	DiskReader::free_working_buffers();
-
 	/* tell everyone who is still standing that we're about to die */
 	drop_references ();
 
@@ -813,6 +817,12 @@ Session::destroy ()
 		sources.clear ();
 	}
 
+	/* sources that outlive the session must not find the cache */
+	_audio_block_cache->clear ();
+	_audio_block_cache.reset ();
+	/* sources dropped above may have queued their last sync */
+	_background_sync->stop ();
+
 	/* not strictly necessary, but doing it here allows the shared_ptr debugging to work */
 	playlists.reset ();
 
@@ -2475,6 +2485,17 @@ Session::resort_routes_using (boost::shared_ptr<RouteList> r)
 
 }
 
+bool
+Session::process_graph_makespan (DSPStats::Snapshot& predicted, DSPStats::Snapshot& actual) const
+{
+	if (!_process_graph) {
+		return false;
+	}
+	_process_graph->predicted_makespan ().snapshot (predicted);
+	_process_graph->makespan ().snapshot (actual);
+	return true;
+}
+
 /** Find a route name starting with \a base, maybe followed by the
  *  lowest \a id.  \a id will always be added if \a definitely_add_number
  *  is true on entry; otherwise it will only be added if required
@@ -5150,7 +5171,7 @@ string
 Session::format_audio_source_name (const string& legalized_base, uint32_t nchan, uint32_t chan, bool destructive, bool take_required, uint32_t cnt, bool related_exists)
 {
 	ostringstream sstr;
-	const string ext = native_header_format_extension (config.get_native_file_header_format(), DataType::AUDIO);
+	const string ext = native_header_format_extension (writable_header_format (config.get_native_file_header_format(), destructive), DataType::AUDIO);
 
 	if (Profile->get_trx() && destructive) {
 		sstr << 'T';
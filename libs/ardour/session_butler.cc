@@ -22,6 +22,7 @@
 #include "pbd/stacktrace.h"
 
 #include "ardour/butler.h"
+#include "ardour/rc_configuration.h"
 #include "ardour/route.h"
 #include "ardour/session.h"
 #include "ardour/session_event.h"
@@ -115,6 +116,47 @@ Session::overwrite_some_buffers (Track* t)
 	_butler->schedule_transport_work ();
 }
 
+/** Add @a kb to the atomic counter @a used, unless that would exceed @a budget */
+static bool
+reserve_kb (gint* used, gint kb, gint budget)
+{
+	while (true) {
+		gint const u = g_atomic_int_get (used);
+		if (u + kb > budget) {
+			return false;
+		}
+		if (g_atomic_int_compare_and_exchange (used, u, u + kb)) {
+			return true;
+		}
+	}
+}
+
+/** Butler thread, or one of its I/O threads. */
+bool
+Session::reserve_locate_prefetch (gint kb)
+{
+	return reserve_kb (&_locate_prefetch_kb, kb, (gint) Config->get_locate_prefetch_max_mb () * 1024);
+}
+
+void
+Session::release_locate_prefetch (gint kb)
+{
+	g_atomic_int_add (&_locate_prefetch_kb, -kb);
+}
+
+/** Butler thread, or one of its I/O threads. */
+bool
+Session::reserve_loop_cache (gint kb)
+{
+	return reserve_kb (&_loop_cache_kb, kb, (gint) Config->get_loop_in_ram_max_mb () * 1024);
+}
+
+void
+Session::release_loop_cache (gint kb)
+{
+	g_atomic_int_add (&_loop_cache_kb, -kb);
+}
+
 uint32_t
 Session::playback_load ()
 {
@@ -163,11 +163,15 @@ Session::no_roll (pframes_t nframes)
 
 			(*i)->set_pending_declick (declick);
 
+			microseconds_t const t0 = get_microseconds ();
+
 			if ((*i)->no_roll (nframes, _transport_sample, end_sample, non_realtime_work_pending())) {
 				error << string_compose(_("Session: error in no roll for %1"), (*i)->name()) << endmsg;
 				ret = -1;
 				break;
 			}
+
+			(*i)->dsp_stats ().update (get_microseconds () - t0);
 		}
 		PT_TIMING_CHECK (11);
 	}
@@ -215,11 +219,15 @@ Session::process_routes (pframes_t nframes, bool& need_butler)
 
 			bool b = false;
 
+			microseconds_t const t0 = get_microseconds ();
+
 			if ((ret = (*i)->roll (nframes, start_sample, end_sample, declick, b)) < 0) {
 				stop_transport ();
 				return -1;
 			}
 
+			(*i)->dsp_stats ().update (get_microseconds () - t0);
+
 			if (b) {
 				DEBUG_TRACE (DEBUG::Butler, string_compose ("%1 rolled and needs butler\n", (*i)->name()));
 				need_butler = true;
@@ -285,7 +285,6 @@ Session::post_engine_init ()
 		_engine.GraphReordered.connect_same_thread (*this, boost::bind (&Session::graph_reordered, this));
 		_engine.MidiSelectionPortsChanged.connect_same_thread (*this, boost::bind (&Session::rewire_midi_selection_ports, this));
 
-		DiskReader::allocate_working_buffers();
 		refresh_disk_space ();
 
 		/* we're finally ready to call set_state() ... all objects have
@@ -4006,7 +4005,7 @@ Session::restore_history (string snapshot_name)
 					ut->add_command(c);
 				}
 
-			} else if (n->name() == "NoteDiffCommand") {
+			} else if (n->name() == "NoteDiffCommand" || n->name() == "BinaryNoteDiffCommand") {
 				PBD::ID id (n->property("midi-source")->value());
 				boost::shared_ptr<MidiSource> midi_source =
 					boost::dynamic_pointer_cast<MidiSource, Source>(source_by_id(id));
@@ -4016,7 +4015,7 @@ Session::restore_history (string snapshot_name)
 					error << _("Failed to downcast MidiSource for NoteDiffCommand") << endmsg;
 				}
 
-			} else if (n->name() == "SysExDiffCommand") {
+			} else if (n->name() == "SysExDiffCommand" || n->name() == "BinarySysExDiffCommand") {
 
 				PBD::ID id (n->property("midi-source")->value());
 				boost::shared_ptr<MidiSource> midi_source =
@@ -42,6 +42,7 @@
 #include "ardour/click.h"
 #include "ardour/debug.h"
 #include "ardour/disk_reader.h"
+#include "ardour/io_tasklist.h"
 #include "ardour/location.h"
 #include "ardour/profile.h"
 #include "ardour/scene_changer.h"
@@ -561,11 +562,33 @@ Session::non_realtime_locate ()
 		gint sc = g_atomic_int_get (&_seek_counter);
 		tf = _transport_sample;
 
-		for (RouteList::iterator i = rl->begin(); i != rl->end(); ++i) {
-			(*i)->non_realtime_locate (tf);
+		IOTaskList* tl = _butler->io_tasks ();
+
+		if (tl && tl->n_workers () > 0) {
+			/* locate processors and automation here, one route after
+			 * the other, and refill the disk readers in parallel (this
+			 * is the butler thread).
+			 */
+			for (RouteList::iterator i = rl->begin(); i != rl->end(); ++i) {
+				boost::shared_ptr<Track> tr = boost::dynamic_pointer_cast<Track> (*i);
+				if (tr) {
+					tr->non_realtime_locate_processors (tf);
+					tl->push_back (boost::bind (&Track::non_realtime_locate_disk_reader, tr, tf));
+				} else {
+					(*i)->non_realtime_locate (tf);
+				}
+			}
+			tl->process ();
 			if (sc != g_atomic_int_get (&_seek_counter)) {
 				goto restart;
 			}
+		} else {
+			for (RouteList::iterator i = rl->begin(); i != rl->end(); ++i) {
+				(*i)->non_realtime_locate (tf);
+				if (sc != g_atomic_int_get (&_seek_counter)) {
+					goto restart;
+				}
+			}
 		}
 	}
 
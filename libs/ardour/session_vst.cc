@@ -183,34 +183,27 @@ intptr_t Session::vst_callback (
 				newflags |= (kVstTempoValid);
 			}
 			if (value & (kVstTimeSigValid)) {
-				const MeterSection& ms (session->tempo_map().meter_section_at_sample (now));
+				const Meter ms (session->tempo_map().meter_at_sample_rt (now));
 				timeinfo->timeSigNumerator = ms.divisions_per_bar ();
 				timeinfo->timeSigDenominator = ms.note_divisor ();
 				newflags |= (kVstTimeSigValid);
 			}
 			if ((value & (kVstPpqPosValid)) || (value & (kVstBarsValid))) {
-				Timecode::BBT_Time bbt;
-
-				try {
-					bbt = session->tempo_map().bbt_at_sample_rt (now);
-					bbt.beats = 1;
-					bbt.ticks = 0;
-					/* exact quarter note */
-					double ppqBar = session->tempo_map().quarter_note_at_bbt_rt (bbt);
-					/* quarter note at sample position (not rounded to note subdivision) */
-					double ppqPos = session->tempo_map().quarter_note_at_sample_rt (now);
-					if (value & (kVstPpqPosValid)) {
-						timeinfo->ppqPos = ppqPos;
-						newflags |= kVstPpqPosValid;
-					}
-
-					if (value & (kVstBarsValid)) {
-						timeinfo->barStartPos = ppqBar;
-						newflags |= kVstBarsValid;
-					}
+				Timecode::BBT_Time bbt = session->tempo_map().bbt_at_sample_rt (now);
+				bbt.beats = 1;
+				bbt.ticks = 0;
+				/* exact quarter note */
+				double ppqBar = session->tempo_map().quarter_note_at_bbt_rt (bbt);
+				/* quarter note at sample position (not rounded to note subdivision) */
+				double ppqPos = session->tempo_map().quarter_note_at_sample_rt (now);
+				if (value & (kVstPpqPosValid)) {
+					timeinfo->ppqPos = ppqPos;
+					newflags |= kVstPpqPosValid;
+				}
 
-				} catch (...) {
-					/* relax */
+				if (value & (kVstBarsValid)) {
+					timeinfo->barStartPos = ppqBar;
+					newflags |= kVstBarsValid;
 				}
 			}
 
@@ -258,12 +251,12 @@ intptr_t Session::vst_callback (
 			if (session->get_play_loop ()) {
 				newflags |= kVstTransportCycleActive;
 				Location * looploc = session->locations ()->auto_loop_location ();
-				if (looploc) try {
+				if (looploc) {
 					timeinfo->cycleStartPos = session->tempo_map ().quarter_note_at_sample_rt (looploc->start ());
 					timeinfo->cycleEndPos = session->tempo_map ().quarter_note_at_sample_rt (looploc->end ());
 
 					newflags |= kVstCyclePosValid;
-				} catch (...) { }
+				}
 			}
 
 		} else {
@@ -22,10 +22,24 @@
 #endif
 
 #include <cstring>
+#include <list>
+#include <map>
+#include <vector>
 #include <cerrno>
 #include <climits>
 #include <cstdarg>
 #include <fcntl.h>
+#ifndef PLATFORM_WINDOWS
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#ifdef __linux__
+#include <sys/vfs.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+#include <sys/param.h>
+#include <sys/mount.h>
+#endif
 
 #include <sys/stat.h>
 
@@ -35,7 +49,12 @@
 #include <glibmm/convert.h>
 #include <glibmm/fileutils.h>
 #include <glibmm/miscutils.h>
+#include <glibmm/threads.h>
 
+#include <boost/weak_ptr.hpp>
+
+#include "ardour/background_sync.h"
+#include "ardour/rc_configuration.h"
 #include "ardour/runtime_functions.h"
 #include "ardour/sndfilesource.h"
 #include "ardour/sndfile_helpers.h"
@@ -57,6 +76,458 @@ const Source::Flag SndFileSource::default_writable_flags = Source::Flag (
 		Source::Removable |
 		Source::RemovableIfEmpty |
 		Source::CanRename );
+const gint64 SndFileSource::max_write_delay_us;
+
+/** Each channel of a multichannel file is a separate SndFileSource, which
+ * (when reading channel by channel) would decode the same interleaved
+ * data once per channel.
+ *
+ * All read-only SndFileSources of a given file share one SharedReader.
+ * The first channel to read a range decodes it, the other channels only
+ * copy their slice. A DiskReader refills all channels of a track (and the
+ * butler all tracks) for the same position, so this turns N passes over
+ * the file into one. It is only used for files with more than two
+ * channels: for stereo, decoding twice costs less than keeping the data.
+ *
+ * Decoded blocks of all readers share one least-recently-used list and
+ * one memory budget, so that many open files can not add up. Blocks are
+ * immutable once decoded, and decoding happens without the lock.
+ */
+class SndFileSource::SharedReader
+{
+public:
+	~SharedReader ()
+	{
+		invalidate ();
+	}
+
+	uint32_t n_channels () const { return _n_channels; }
+
+	/** Largest read (in samples per channel) that goes via the shared blocks */
+	samplecnt_t max_read () const { return max_block_samples / _n_channels; }
+
+	/** Read @a cnt samples of channel @a chn starting at @a start, using
+	 * @a sf to decode if the range is not already available.
+	 * @return number of samples read, or -1 if seeking failed.
+	 */
+	samplecnt_t read (SNDFILE* sf, Sample* dst, uint32_t chn, samplepos_t start, samplecnt_t cnt, gain_t gain)
+	{
+		boost::shared_ptr<Block const> block = find (start, cnt);
+
+		if (!block) {
+			boost::shared_ptr<Block> b (new Block (this));
+			b->data.resize (cnt * _n_channels);
+
+			if (sf_seek (sf, (sf_count_t) start, SEEK_SET|SFM_READ) != (sf_count_t) start) {
+				return -1;
+			}
+
+			b->start = start;
+			b->cnt = sf_read_float (sf, &b->data[0], cnt * _n_channels) / _n_channels;
+
+			add_block (b);
+			block = b;
+		}
+
+		samplecnt_t const offset = start - block->start;
+		samplecnt_t const nread = std::min (cnt, block->cnt - offset);
+		Sample const* ptr = &block->data[0] + offset * _n_channels + chn;
+
+		/* stride through the interleaved data */
+
+		if (gain != 1.f) {
+			for (samplecnt_t n = 0; n < nread; ++n) {
+				dst[n] = *ptr * gain;
+				ptr += _n_channels;
+			}
+		} else {
+			for (samplecnt_t n = 0; n < nread; ++n) {
+				dst[n] = *ptr;
+				ptr += _n_channels;
+			}
+		}
+
+		return nread;
+	}
+
+	/** @return the reader of the file open as @a fd at @a path */
+	static boost::shared_ptr<SharedReader> get (std::string const& path, uint32_t n_channels, int fd)
+	{
+		struct stat st;
+
+		if (fstat (fd, &st) != 0) {
+			return boost::shared_ptr<SharedReader> ();
+		}
+
+		Glib::Threads::Mutex::Lock lm (_readers_lock);
+
+		for (ReaderMap::iterator i = _readers.begin (); i != _readers.end (); ) {
+			if (i->second.expired ()) {
+				_readers.erase (i++);
+			} else {
+				++i;
+			}
+		}
+
+		boost::shared_ptr<SharedReader> r;
+		ReaderMap::iterator i = _readers.find (path);
+
+		if (i != _readers.end ()) {
+			r = i->second.lock ();
+		}
+
+		if (!r || r->_n_channels != n_channels || r->_dev != st.st_dev || r->_ino != st.st_ino) {
+			/* the path may now name another file */
+			if (r) {
+				r->invalidate ();
+			}
+			r.reset (new SharedReader (n_channels, st));
+			_readers[path] = r;
+		}
+
+		return r;
+	}
+
+	/** Stop using the reader of @a path, because the file is being
+	 *  replaced or renamed. Channels that still use it decode without
+	 *  keeping the data, until they get a reader of the new file.
+	 */
+	static void forget (std::string const& path)
+	{
+		Glib::Threads::Mutex::Lock lm (_readers_lock);
+
+		ReaderMap::iterator i = _readers.find (path);
+
+		if (i == _readers.end ()) {
+			return;
+		}
+
+		boost::shared_ptr<SharedReader> r = i->second.lock ();
+		if (r) {
+			r->invalidate ();
+		}
+		_readers.erase (i);
+	}
+
+private:
+	SharedReader (uint32_t n_channels, struct stat const& st)
+		: _n_channels (n_channels)
+		, _dev (st.st_dev)
+		, _ino (st.st_ino)
+		, _valid (true)
+	{}
+
+	/* 4 MB per block, 64 MB for the blocks of all files */
+	static const samplecnt_t max_block_samples = 1048576;
+	static const size_t      max_bytes = 67108864;
+
+	struct Block {
+		Block (SharedReader const* o) : owner (o), start (0), cnt (0) {}
+
+		SharedReader const* owner;
+		samplepos_t         start;
+		samplecnt_t         cnt; ///< samples per channel
+		std::vector<Sample> data;
+	};
+
+	typedef std::list<boost::shared_ptr<Block const> > Blocks;
+
+	/** @return the block that holds all of [start, start + cnt), if any */
+	boost::shared_ptr<Block const> find (samplepos_t start, samplecnt_t cnt)
+	{
+		Glib::Threads::Mutex::Lock lm (_blocks_lock);
+
+		for (Blocks::iterator i = _blocks.begin (); i != _blocks.end (); ++i) {
+			if ((*i)->owner == this && start >= (*i)->start && start + cnt <= (*i)->start + (*i)->cnt) {
+				_blocks.splice (_blocks.begin (), _blocks, i);
+				return _blocks.front ();
+			}
+		}
+
+		return boost::shared_ptr<Block const> ();
+	}
+
+	void add_block (boost::shared_ptr<Block const> b)
+	{
+		Glib::Threads::Mutex::Lock lm (_blocks_lock);
+
+		if (!_valid) {
+			return;
+		}
+
+		_blocks.push_front (b);
+		_bytes += b->data.size () * sizeof (Sample);
+
+		while (_bytes > max_bytes && _blocks.size () > 1) {
+			_bytes -= _blocks.back ()->data.size () * sizeof (Sample);
+			_blocks.pop_back ();
+		}
+	}
+
+	/** Drop all blocks of this reader, and keep no new ones */
+	void invalidate ()
+	{
+		Glib::Threads::Mutex::Lock lm (_blocks_lock);
+
+		_valid = false;
+
+		for (Blocks::iterator i = _blocks.begin (); i != _blocks.end (); ) {
+			if ((*i)->owner == this) {
+				_bytes -= (*i)->data.size () * sizeof (Sample);
+				i = _blocks.erase (i);
+			} else {
+				++i;
+			}
+		}
+	}
+
+	typedef std::map<std::string, boost::weak_ptr<SharedReader> > ReaderMap;
+	static ReaderMap _readers;
+	static Glib::Threads::Mutex _readers_lock;
+
+	static Blocks _blocks; ///< of all readers, most recently used first
+	static size_t _bytes;
+	static Glib::Threads::Mutex _blocks_lock; ///< protects _blocks, _bytes and _valid, not the blocks themselves
+
+	uint32_t const _n_channels;
+	dev_t const    _dev;
+	ino_t const    _ino;
+	bool           _valid;
+};
+
+SndFileSource::SharedReader::ReaderMap SndFileSource::SharedReader::_readers;
+Glib::Threads::Mutex SndFileSource::SharedReader::_readers_lock;
+SndFileSource::SharedReader::Blocks SndFileSource::SharedReader::_blocks;
+size_t SndFileSource::SharedReader::_bytes = 0;
+Glib::Threads::Mutex SndFileSource::SharedReader::_blocks_lock;
+
+/** Read access to the sample data of an uncompressed, little-endian PCM
+ * file through a read-only memory mapping of the whole file. A read is a
+ * conversion from the page cache straight into the destination buffer,
+ * with neither a seek nor a read system call, nor an intermediate copy.
+ *
+ * The conversion loops are plain enough for the compiler to vectorize.
+ * All channels (SndFileSources) of a file share one mapping.
+ *
+ * Reading a page of the mapping that the file no longer has (because it
+ * was truncated, or its medium went away) raises SIGBUS rather than
+ * failing a read, so this is only used for files on local filesystems,
+ * and only if "mmap-audio-files" is enabled.
+ */
+class SndFileSource::MappedReader
+{
+public:
+	~MappedReader ()
+	{
+#ifndef PLATFORM_WINDOWS
+		munmap (_map, _map_size);
+#endif
+	}
+
+	/** @return a reader for the file at @a path, or a null pointer if the
+	 *  format is not supported or the file cannot be mapped.
+	 */
+	static boost::shared_ptr<MappedReader> get (std::string const& path, SF_INFO const& info, off_t data_offset)
+	{
+		boost::shared_ptr<MappedReader> r;
+
+#if !defined(PLATFORM_WINDOWS) && G_BYTE_ORDER == G_LITTLE_ENDIAN
+		if (sizeof (void*) < 8) {
+			/* leave the address space of 32 bit systems alone */
+			return r;
+		}
+
+		switch (info.format & SF_FORMAT_TYPEMASK) {
+		case SF_FORMAT_WAV:
+		case SF_FORMAT_WAVEX:
+		case SF_FORMAT_W64:
+		case SF_FORMAT_RF64:
+			break;
+		default:
+			return r;
+		}
+
+		if ((info.format & SF_FORMAT_ENDMASK) != SF_ENDIAN_FILE && (info.format & SF_FORMAT_ENDMASK) != SF_ENDIAN_LITTLE) {
+			return r;
+		}
+
+		int width;
+
+		switch (info.format & SF_FORMAT_SUBMASK) {
+		case SF_FORMAT_PCM_16:
+			width = 2;
+			break;
+		case SF_FORMAT_PCM_24:
+			width = 3;
+			break;
+		case SF_FORMAT_PCM_32:
+		case SF_FORMAT_FLOAT:
+			width = 4;
+			break;
+		default:
+			return r;
+		}
+
+		Glib::Threads::Mutex::Lock lm (_readers_lock);
+
+		int const fd = ::open (path.c_str(), O_RDONLY);
+
+		if (fd < 0) {
+			return r;
+		}
+
+		size_t const size = data_offset + (size_t) info.frames * info.channels * width;
+		struct stat st;
+
+		if (fstat (fd, &st) != 0 || (size_t) st.st_size < size || size == 0 || !local_file (fd)) {
+			::close (fd);
+			return r;
+		}
+
+		ReaderMap::iterator i = _readers.find (path);
+
+		if (i != _readers.end ()) {
+			r = i->second.lock ();
+			if (r && r->_dev == st.st_dev && r->_ino == st.st_ino && r->_map_size == size) {
+				::close (fd);
+				return r;
+			}
+			/* gone, or the path now names another file */
+			r.reset ();
+			_readers.erase (i);
+		}
+
+		void* map = mmap (0, size, PROT_READ, MAP_SHARED, fd, 0);
+		::close (fd);
+
+		if (map == MAP_FAILED) {
+			return r;
+		}
+
+		r.reset (new MappedReader (map, size, data_offset, info, width, st));
+		_readers[path] = r;
+#endif
+
+		return r;
+	}
+
+	/** Stop handing out the reader of @a path to new sources, because the
+	 *  file is being replaced or renamed. Existing users keep it.
+	 */
+	static void forget (std::string const& path)
+	{
+		Glib::Threads::Mutex::Lock lm (_readers_lock);
+		_readers.erase (path);
+	}
+
+	/** Read @a cnt samples of channel @a chn starting at @a start, which
+	 *  must be within the file.
+	 */
+	samplecnt_t read (Sample* dst, uint32_t chn, samplepos_t start, samplecnt_t cnt, gain_t gain) const
+	{
+		size_t const stride = _channels * _width;
+		uint8_t const* p = _data + (size_t) start * stride + chn * _width;
+
+		switch (_subtype) {
+		case SF_FORMAT_PCM_16:
+			gain /= 32768.f;
+			for (samplecnt_t n = 0; n < cnt; ++n, p += stride) {
+				int16_t v;
+				memcpy (&v, p, sizeof (v));
+				dst[n] = v * gain;
+			}
+			break;
+		case SF_FORMAT_PCM_24:
+			gain /= 8388608.f;
+			for (samplecnt_t n = 0; n < cnt; ++n, p += stride) {
+				int32_t const v = (int32_t) (((uint32_t) p[0] << 8) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 24)) >> 8;
+				dst[n] = v * gain;
+			}
+			break;
+		case SF_FORMAT_PCM_32:
+			gain /= 2147483648.f;
+			for (samplecnt_t n = 0; n < cnt; ++n, p += stride) {
+				int32_t v;
+				memcpy (&v, p, sizeof (v));
+				dst[n] = v * gain;
+			}
+			break;
+		case SF_FORMAT_FLOAT:
+			for (samplecnt_t n = 0; n < cnt; ++n, p += stride) {
+				float v;
+				memcpy (&v, p, sizeof (v));
+				dst[n] = v * gain;
+			}
+			break;
+		}
+
+		return cnt;
+	}
+
+private:
+	MappedReader (void* map, size_t size, off_t data_offset, SF_INFO const& info, int width, struct stat const& st)
+		: _map (map)
+		, _map_size (size)
+		, _data ((uint8_t const*) map + data_offset)
+		, _channels (info.channels)
+		, _width (width)
+		, _subtype (info.format & SF_FORMAT_SUBMASK)
+		, _dev (st.st_dev)
+		, _ino (st.st_ino)
+	{}
+
+	/** @return true if @a fd is a file on a local filesystem, where it
+	 *  can not go away or shrink behind our back without a user doing so.
+	 */
+	static bool local_file (int fd)
+	{
+#if defined(__linux__)
+		struct statfs sfs;
+
+		if (fstatfs (fd, &sfs) != 0) {
+			return false;
+		}
+
+		switch ((uint32_t) sfs.f_type) {
+		case 0x6969:     /* NFS */
+		case 0x517b:     /* SMB */
+		case 0xff534d42: /* CIFS */
+		case 0xfe534d42: /* SMB2 */
+		case 0x65735546: /* FUSE (sshfs, ntfs-3g, ...) */
+		case 0x73757245: /* CODA */
+		case 0x5346414f: /* AFS */
+		case 0x01021997: /* 9P */
+		case 0x00c36400: /* CEPH */
+		case 0x47504653: /* GPFS */
+			return false;
+		default:
+			return true;
+		}
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+		struct statfs sfs;
+
+		return fstatfs (fd, &sfs) == 0 && (sfs.f_flags & MNT_LOCAL);
+#else
+		return false;
+#endif
+	}
+
+	typedef std::map<std::string, boost::weak_ptr<MappedReader> > ReaderMap;
+	static ReaderMap _readers;
+	static Glib::Threads::Mutex _readers_lock;
+
+	void*          _map;
+	size_t         _map_size;
+	uint8_t const* _data;
+	int            _channels;
+	int            _width;
+	int            _subtype;
+	dev_t          _dev;
+	ino_t          _ino;
+};
+
+SndFileSource::MappedReader::ReaderMap SndFileSource::MappedReader::_readers;
+Glib::Threads::Mutex SndFileSource::MappedReader::_readers_lock;
 
 SndFileSource::SndFileSource (Session& s, const XMLNode& node)
 	: Source(s, node)
@@ -127,7 +598,7 @@ SndFileSource::SndFileSource (Session& s, const string& path, const string& orig
 
 	_file_is_new = true;
 
-	switch (hf) {
+	switch (writable_header_format (hf, _flags & Destructive)) {
 	case CAF:
 		fmt = SF_FORMAT_CAF;
 		_flags = Flag (_flags & ~Broadcast);
@@ -170,6 +641,11 @@ SndFileSource::SndFileSource (Session& s, const string& path, const string& orig
 		_flags = Flag (_flags & ~Broadcast);
 		break;
 
+	case FLAC:
+		fmt = SF_FORMAT_FLAC;
+		_flags = Flag (_flags & ~Broadcast);
+		break;
+
 	default:
 		fatal << string_compose (_("programming error: %1"), X_("unsupported audio header format requested")) << endmsg;
 		abort(); /*NOTREACHED*/
@@ -191,6 +667,11 @@ SndFileSource::SndFileSource (Session& s, const string& path, const string& orig
 		break;
 	}
 
+	if ((fmt & SF_FORMAT_TYPEMASK) == SF_FORMAT_FLAC && (fmt & SF_FORMAT_SUBMASK) == SF_FORMAT_FLOAT) {
+		/* FLAC has no floating point samples */
+		fmt = SF_FORMAT_FLAC | SF_FORMAT_PCM_24;
+	}
+
 	_info.channels = 1;
 	_info.samplerate = rate;
 	_info.format = fmt;
@@ -339,6 +820,17 @@ SndFileSource::init_sndfile ()
 
 	memset (&_info, 0, sizeof(_info));
 
+	_data_offset = -1;
+	_bytes_per_frame = 0;
+
+	_write_buf = 0;
+	_write_buf_size = 0;
+	_write_pending = 0;
+	_write_pending_pos = 0;
+	_write_pending_since = 0;
+	_write_fd = -1;
+	_preallocated = 0;
+
 	if (destructive()) {
 		xfade_buf = new Sample[xfade_samples];
 		_timeline_position = header_position_offset;
@@ -347,12 +839,226 @@ SndFileSource::init_sndfile ()
 	AudioFileSource::HeaderPositionOffsetChanged.connect_same_thread (header_position_connection, boost::bind (&SndFileSource::handle_header_position_change, this));
 }
 
+#ifndef PLATFORM_WINDOWS
+static uint32_t
+get_u32 (unsigned char const* p, bool big_endian)
+{
+	if (big_endian) {
+		return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+	}
+	return ((uint32_t) p[3] << 24) | ((uint32_t) p[2] << 16) | ((uint32_t) p[1] << 8) | (uint32_t) p[0];
+}
+
+static uint64_t
+get_u64 (unsigned char const* p, bool big_endian)
+{
+	if (big_endian) {
+		return ((uint64_t) get_u32 (p, true) << 32) | get_u32 (p + 4, true);
+	}
+	return ((uint64_t) get_u32 (p + 4, false) << 32) | get_u32 (p, false);
+}
+
+/** Walk the chunks of a WAV, RF64, W64, AIFF or CAF file to find where
+ *  its sample data starts.
+ *  @param type major format (SF_FORMAT_TYPEMASK) as reported by libsndfile
+ *  @return offset of the first sample, or -1 if it was not found
+ */
+static off_t
+pcm_data_offset (int fd, int type, off_t file_size)
+{
+	unsigned char h[24];
+	off_t pos;
+	bool big_endian;
+
+	if (pread (fd, h, 12, 0) != 12) {
+		return -1;
+	}
+
+	switch (type) {
+	case SF_FORMAT_WAV:
+	case SF_FORMAT_WAVEX:
+	case SF_FORMAT_RF64:
+		/* RF64 files may have been written as plain WAV, and vice versa */
+		if (memcmp (h, "RIFF", 4) && memcmp (h, "RIFX", 4) && memcmp (h, "RF64", 4) && memcmp (h, "BW64", 4)) {
+			return -1;
+		}
+		if (memcmp (h + 8, "WAVE", 4)) {
+			return -1;
+		}
+		big_endian = !memcmp (h, "RIFX", 4);
+		pos = 12;
+		break;
+	case SF_FORMAT_AIFF:
+		if (memcmp (h, "FORM", 4) || (memcmp (h + 8, "AIFF", 4) && memcmp (h + 8, "AIFC", 4))) {
+			return -1;
+		}
+		big_endian = true;
+		pos = 12;
+		break;
+	case SF_FORMAT_W64:
+		/* the GUIDs of all W64 chunks start with their RIFF name */
+		if (memcmp (h, "riff", 4)) {
+			return -1;
+		}
+		big_endian = false;
+		pos = 40;
+		break;
+	case SF_FORMAT_CAF:
+		if (memcmp (h, "caff", 4)) {
+			return -1;
+		}
+		big_endian = true;
+		pos = 8;
+		break;
+	default:
+		return -1;
+	}
+
+	for (int n = 0; n < 1024 && pos < file_size; ++n) {
+
+		switch (type) {
+		case SF_FORMAT_W64:
+			if (pread (fd, h, 24, pos) != 24) {
+				return -1;
+			}
+			if (!memcmp (h, "data", 4)) {
+				return pos + 24;
+			}
+			/* the size includes the chunk header; chunks are 8-byte aligned */
+			if (get_u64 (h + 16, false) < 24) {
+				return -1;
+			}
+			pos += (get_u64 (h + 16, false) + 7) & ~7;
+			break;
+
+		case SF_FORMAT_CAF:
+			if (pread (fd, h, 12, pos) != 12) {
+				return -1;
+			}
+			if (!memcmp (h, "data", 4)) {
+				/* the data starts with an edit count */
+				return pos + 12 + 4;
+			}
+			pos += 12 + get_u64 (h + 4, true);
+			break;
+
+		case SF_FORMAT_AIFF:
+			if (pread (fd, h, 16, pos) < 8) {
+				return -1;
+			}
+			if (!memcmp (h, "SSND", 4)) {
+				/* offset and block size come first */
+				return pos + 16 + get_u32 (h + 8, true);
+			}
+			pos += 8 + ((get_u32 (h + 4, true) + 1) & ~1);
+			break;
+
+		default:
+			if (pread (fd, h, 8, pos) != 8) {
+				return -1;
+			}
+			if (!memcmp (h, "data", 4)) {
+				return pos + 8;
+			}
+			pos += 8 + ((get_u32 (h + 4, big_endian) + 1) & ~1);
+			break;
+		}
+	}
+
+	return -1;
+}
+#endif
+
+/** For uncompressed PCM files, find where the sample data starts,
+ *  so that file_byte_range() can tell which bytes a read will touch.
+ *  The header is parsed here rather than asking libsndfile, which does not
+ *  tell where the data is.
+ *  @param fd descriptor that _sndfile was opened with
+ */
+void
+SndFileSource::find_data_offset (int fd)
+{
+	_data_offset = -1;
+
+	switch (_info.format & SF_FORMAT_TYPEMASK) {
+	case SF_FORMAT_WAV:
+	case SF_FORMAT_WAVEX:
+	case SF_FORMAT_W64:
+	case SF_FORMAT_RF64:
+	case SF_FORMAT_CAF:
+	case SF_FORMAT_AIFF:
+		break;
+	default:
+		return;
+	}
+
+	uint32_t width;
+
+	switch (_info.format & SF_FORMAT_SUBMASK) {
+	case SF_FORMAT_PCM_S8:
+	case SF_FORMAT_PCM_U8:
+		width = 1;
+		break;
+	case SF_FORMAT_PCM_16:
+		width = 2;
+		break;
+	case SF_FORMAT_PCM_24:
+		width = 3;
+		break;
+	case SF_FORMAT_PCM_32:
+	case SF_FORMAT_FLOAT:
+		width = 4;
+		break;
+	case SF_FORMAT_DOUBLE:
+		width = 8;
+		break;
+	default:
+		return;
+	}
+
+#ifndef PLATFORM_WINDOWS
+	struct stat st;
+
+	if (fstat (fd, &st) != 0) {
+		return;
+	}
+
+	off_t const pos = pcm_data_offset (fd, _info.format & SF_FORMAT_TYPEMASK, st.st_size);
+	uint32_t const bpf = width * _info.channels;
+
+	/* a header that we misread would not leave room for all samples */
+	if (pos > 0 && pos + (off_t) _info.frames * bpf <= st.st_size) {
+		_data_offset = pos;
+		_bytes_per_frame = bpf;
+	}
+#endif
+}
+
+bool
+SndFileSource::file_byte_range (samplepos_t start, samplecnt_t cnt, std::string& path, off_t& offset, size_t& length) const
+{
+	if (_data_offset < 0 || writable () || start >= _length) {
+		return false;
+	}
+
+	cnt = min (cnt, _length - start);
+
+	path = _path;
+	offset = _data_offset + (off_t) start * _bytes_per_frame;
+	length = (size_t) cnt * _bytes_per_frame;
+
+	return cnt > 0;
+}
+
 void
 SndFileSource::close ()
 {
 	if (_sndfile) {
+		flush_pending_writes ();
+		release_preallocation ();
 		sf_close (_sndfile);
 		_sndfile = 0;
+		_write_fd = -1;
 		file_closed ();
 	}
 }
@@ -384,8 +1090,11 @@ SndFileSource::open ()
 	}
 
 	if ((_info.format & SF_FORMAT_TYPEMASK ) == SF_FORMAT_FLAC) {
-		assert (!writable());
-		_sndfile = sf_open_fd (fd, SFM_READ, &_info, true);
+		/* FLAC is either read or written, never both: a new file is
+		   written until finish_flac_stream(), after that it is read-only.
+		*/
+		assert (!writable() || !destructive());
+		_sndfile = sf_open_fd (fd, flac_encoding () ? SFM_WRITE : SFM_READ, &_info, true);
 	} else {
 		_sndfile = sf_open_fd (fd, writable() ? SFM_RDWR : SFM_READ, &_info, true);
 	}
@@ -417,6 +1126,24 @@ SndFileSource::open ()
 
 	_length = _info.frames;
 
+#ifndef PLATFORM_WINDOWS
+	if (writable()) {
+		_write_fd = fd;
+		_preallocated = 0;
+	}
+#endif
+
+	if (!writable() && _info.channels > 2 && !_shared_reader) {
+		_shared_reader = SharedReader::get (_path, _info.channels, fd);
+	}
+
+	if (!writable()) {
+		find_data_offset (fd);
+		if (_data_offset >= 0 && !_mapped_reader && Config->get_mmap_audio_files ()) {
+			_mapped_reader = MappedReader::get (_path, _info, _data_offset);
+		}
+	}
+
 #ifdef HAVE_RF64_RIFF
 	if (_file_is_new && _length == 0 && writable()) {
 		if (_flags & RF64_RIFF) {
@@ -462,6 +1189,11 @@ SndFileSource::open ()
 		_flags = Flag (_flags | Broadcast);
 	}
 
+	if (flac_encoding ()) {
+		/* integer samples: clip rather than wrap around */
+		sf_command (_sndfile, SFC_SET_CLIPPING, 0, SF_TRUE);
+	}
+
 	if (writable()) {
 		sf_command (_sndfile, SFC_SET_UPDATE_HEADER_AUTO, 0, SF_FALSE);
 
@@ -493,6 +1225,7 @@ SndFileSource::~SndFileSource ()
 	close ();
 	delete _broadcast_info;
 	delete [] xfade_buf;
+	delete [] _write_buf;
 }
 
 float
@@ -517,6 +1250,12 @@ SndFileSource::read_unlocked (Sample *dst, samplepos_t start, samplecnt_t cnt) c
                 return cnt;
         }
 
+	if (flac_encoding ()) {
+		/* nothing can be read back until the stream is complete */
+		memset (dst, 0, sizeof (Sample) * cnt);
+		return cnt;
+	}
+
         if (const_cast<SndFileSource*>(this)->open()) {
 		error << string_compose (_("could not open file %1 for reading."), _path) << endmsg;
 		return 0;
@@ -548,6 +1287,39 @@ SndFileSource::read_unlocked (Sample *dst, samplepos_t start, samplecnt_t cnt) c
 		memset (dst+file_cnt, 0, sizeof (Sample) * delta);
 	}
 
+	/* the end of the data may not have been written yet, see
+	   write_unlocked(); take that part from the write buffer.
+	   (files being written are always mono)
+	*/
+	samplecnt_t from_write_buf = 0;
+
+	if (_write_pending && start + file_cnt > _write_pending_pos) {
+		samplepos_t const from = max (start, _write_pending_pos);
+		from_write_buf = start + file_cnt - from;
+		for (samplecnt_t i = 0; i < from_write_buf; ++i) {
+			dst[from - start + i] = _write_buf[from - _write_pending_pos + i] * _gain;
+		}
+		file_cnt -= from_write_buf;
+		if (file_cnt == 0) {
+			return from_write_buf;
+		}
+	}
+
+	if (file_cnt && _mapped_reader) {
+		return _mapped_reader->read (dst, _channel, start, file_cnt, _gain);
+	}
+
+	if (file_cnt && _shared_reader && file_cnt <= _shared_reader->max_read ()) {
+		samplecnt_t const ret = _shared_reader->read (_sndfile, dst, _channel, start, file_cnt, _gain);
+		if (ret < 0) {
+			char errbuf[256];
+			sf_error_str (0, errbuf, sizeof (errbuf) - 1);
+			error << string_compose(_("SndFileSource: could not seek to sample %1 within %2 (%3)"), start, _name.val().substr (1), errbuf) << endmsg;
+			return 0;
+		}
+		return ret;
+	}
+
 	if (file_cnt) {
 
 		if (sf_seek (_sndfile, (sf_count_t) start, SEEK_SET|SFM_READ) != (sf_count_t) start) {
@@ -569,7 +1341,7 @@ SndFileSource::read_unlocked (Sample *dst, samplepos_t start, samplecnt_t cnt) c
 					dst[i] *= _gain;
 				}
 			}
-			return ret;
+			return ret == file_cnt ? ret + from_write_buf : ret;
 		}
 	}
 
@@ -628,8 +1400,42 @@ SndFileSource::nondestructive_write_unlocked (Sample *data, samplecnt_t cnt)
 
 	samplepos_t sample_pos = _length;
 
-	if (write_float (data, sample_pos, cnt) != cnt) {
-		return 0;
+	if (!_write_buf && (_info.format & SF_FORMAT_TYPEMASK) != SF_FORMAT_FLAC) {
+		_write_buf_size = Config->get_capture_write_block_kb () * 1024 / sizeof (Sample);
+		if (_write_buf_size > 0) {
+			_write_buf = new Sample[_write_buf_size];
+		}
+	}
+
+	if (!_write_buf) {
+		if (write_block (data, sample_pos, cnt) != cnt) {
+			return 0;
+		}
+	} else {
+		/* collect small writes (one butler chunk at a time, per
+		   track) into large ones, which keeps the file contiguous
+		   and the number of system calls low.
+		*/
+		for (samplecnt_t done = 0; done < cnt; ) {
+			if (_write_pending == 0) {
+				_write_pending_pos = sample_pos + done;
+				_write_pending_since = g_get_monotonic_time ();
+			}
+			samplecnt_t const n = min (cnt - done, _write_buf_size - _write_pending);
+			memcpy (_write_buf + _write_pending, data + done, n * sizeof (Sample));
+			_write_pending += n;
+			done += n;
+			if (_write_pending == _write_buf_size && flush_pending_writes ()) {
+				return 0;
+			}
+		}
+
+		/* don't keep captured data in memory only for long, whatever
+		   the block size: a crash would lose it.
+		*/
+		if (_write_pending && g_get_monotonic_time () - _write_pending_since > max_write_delay_us && flush_pending_writes ()) {
+			return 0;
+		}
 	}
 
 	update_length (_length + cnt);
@@ -757,6 +1563,17 @@ SndFileSource::flush_header ()
 		return -1;
 	}
 
+	if (flac_encoding ()) {
+		/* the header is written when the stream is complete, which it
+		   is by now (see DiskWriter::transport_stopped_wallclock()
+		   and Session::write_one_track()).
+		*/
+		return finish_flac_stream ();
+	}
+
+	/* the header describes all data, including what has not been written yet */
+	flush_pending_writes ();
+
 	int const r = sf_command (_sndfile, SFC_UPDATE_HEADER_NOW, 0, 0) != SF_TRUE;
 
 	return r;
@@ -775,6 +1592,8 @@ SndFileSource::flush ()
 		return;
 	}
 
+	flush_pending_writes ();
+
 	// Hopefully everything OK
 	sf_write_sync (_sndfile);
 }
@@ -846,6 +1665,176 @@ SndFileSource::write_float (Sample* data, samplepos_t sample_pos, samplecnt_t cn
 	return cnt;
 }
 
+/** Write @a cnt samples at @a pos, reserve space for the data that follows
+ *  and ask the kernel to start writing the new data out, without waiting.
+ */
+samplecnt_t
+SndFileSource::write_block (Sample* data, samplepos_t pos, samplecnt_t cnt)
+{
+	struct stat st;
+	off_t before = -1;
+
+	if (_write_fd >= 0 && fstat (_write_fd, &st) == 0) {
+		before = st.st_size;
+	}
+
+	if (write_float (data, pos, cnt) != cnt) {
+		return 0;
+	}
+
+	if (before < 0 || fstat (_write_fd, &st) != 0 || st.st_size <= before) {
+		return cnt;
+	}
+
+	preallocate (st.st_size);
+
+	/* elsewhere, there is neither range writeback nor page cache control */
+#ifdef __linux__
+	sync_file_range (_write_fd, before, st.st_size - before, SYNC_FILE_RANGE_WRITE);
+
+	if (Config->get_capture_bypass_page_cache ()) {
+		/* the data is not going to be read back soon; once it is on
+		   disk, it need not take page cache from playback.
+		*/
+		_session.background_sync ().queue (_write_fd, before, st.st_size - before, true);
+	}
+#endif
+
+	return cnt;
+}
+
+/** Write all samples that were collected by write_unlocked().
+ *  @return 0 on success
+ */
+int
+SndFileSource::flush_pending_writes ()
+{
+	if (_write_pending == 0) {
+		return 0;
+	}
+
+	samplecnt_t const cnt = _write_pending;
+	_write_pending = 0;
+
+	if (write_block (_write_buf, _write_pending_pos, cnt) != cnt) {
+		error << string_compose (_("%1: cannot write %2 samples"), _path, cnt) << endmsg;
+		return -1;
+	}
+
+	return 0;
+}
+
+/** Make sure that the file can grow beyond @a file_end without the file
+ *  system having to find space for every block as it is written: space
+ *  is reserved in large steps (Config->get_capture_preallocate_mb()), so
+ *  that a long take ends up in few extents.
+ */
+void
+SndFileSource::preallocate (off_t file_end)
+{
+#ifdef __linux__
+	off_t const step = (off_t) Config->get_capture_preallocate_mb () * 1048576;
+
+	if (_preallocated < 0 || step == 0 || file_end + step / 2 < _preallocated) {
+		return;
+	}
+
+	off_t const from = max (file_end, _preallocated);
+
+	/* FALLOC_FL_KEEP_SIZE: the file size (and hence what the header and
+	   readers see) does not change, only space is allocated.
+	*/
+	if (fallocate (_write_fd, FALLOC_FL_KEEP_SIZE, from, file_end + step - from) == 0) {
+		_preallocated = file_end + step;
+	} else {
+		/* not supported by the file system, don't try again */
+		_preallocated = -1;
+	}
+#else
+	(void) file_end;
+#endif
+}
+
+/** Give back the space that was preallocated beyond the end of the file */
+void
+SndFileSource::release_preallocation ()
+{
+#ifdef __linux__
+	struct stat st;
+
+	if (_write_fd < 0 || _preallocated <= 0) {
+		return;
+	}
+
+	if (fstat (_write_fd, &st) == 0 && st.st_size < _preallocated) {
+		/* truncating to the current size frees the blocks beyond it */
+		if (ftruncate (_write_fd, st.st_size)) {
+			warning << string_compose (_("%1: cannot release preallocated space (%2)"), _path, strerror (errno)) << endmsg;
+		}
+	}
+
+	_preallocated = 0;
+#endif
+}
+
+/** @return true if this is a new FLAC file that is still being written */
+bool
+SndFileSource::flac_encoding () const
+{
+	return (_info.format & SF_FORMAT_TYPEMASK) == SF_FORMAT_FLAC && writable () && _file_is_new;
+}
+
+/** Complete a FLAC file that was written (the encoder writes the stream
+ *  info on close), and re-open it for reading, so that the data can be
+ *  played back right away.
+ *  @return 0 on success
+ */
+int
+SndFileSource::finish_flac_stream ()
+{
+	if (!flac_encoding () || !_sndfile) {
+		return 0;
+	}
+
+	/* open() takes the position from the file, which has none */
+	samplepos_t const pos = _timeline_position;
+
+	close ();
+	_file_is_new = false;
+
+	if (open ()) {
+		return -1;
+	}
+
+	set_timeline_position (pos);
+
+	return 0;
+}
+
+void
+SndFileSource::mark_streaming_write_completed (const Lock& lock)
+{
+	if (writable ()) {
+		finish_flac_stream ();
+		flush_pending_writes ();
+		release_preallocation ();
+
+		delete [] _write_buf;
+		_write_buf = 0;
+		_write_buf_size = 0;
+
+		if (_write_fd >= 0 && Config->get_capture_background_sync ()) {
+			/* the header has been updated by now (see
+			   DiskWriter::transport_stopped_wallclock()); have the
+			   whole take reach the disk, but don't wait for it.
+			*/
+			_session.background_sync ().queue (_write_fd, 0, 0, Config->get_capture_bypass_page_cache ());
+		}
+	}
+
+	AudioFileSource::mark_streaming_write_completed (lock);
+}
+
 samplepos_t
 SndFileSource::natural_position() const
 {
@@ -1138,6 +2127,20 @@ SndFileSource::file_closed ()
 void
 SndFileSource::set_path (const string& p)
 {
+	MappedReader::forget (_path);
+	SharedReader::forget (_path);
         FileSource::set_path (p);
+	_shared_reader.reset ();
+	_mapped_reader.reset ();
+}
+
+void
+SndFileSource::replace_file (const string& p)
+{
+	MappedReader::forget (_path);
+	SharedReader::forget (_path);
+	_shared_reader.reset ();
+	_mapped_reader.reset ();
+	AudioFileSource::replace_file (p);
 }
 
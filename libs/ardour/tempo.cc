@@ -49,6 +49,14 @@ using Timecode::BBT_Time;
 Meter    TempoMap::_default_meter (4.0, 4.0);
 Tempo    TempoMap::_default_tempo (120.0, 4.0, 120.0);
 
+static void
+do_not_delete_the_snapshot (void*)
+{
+	/* snapshots are owned by the RCU manager, not by the thread */
+}
+
+Glib::Threads::Private<TempoMap::Snapshot> TempoMap::_rt_snapshot (do_not_delete_the_snapshot);
+
 samplepos_t
 MetricSection::sample_at_minute (const double& time) const
 {
@@ -714,7 +722,276 @@ struct MetricSectionFrameSorter {
     }
 };
 
+/* comparators for binary searches in TempoMap::_index, with the same
+ * "section is past the position" tests as the searches in the list.
+ */
+struct SectionAfterMinute {
+	bool operator() (double minute, const MetricSection* s) const { return s->minute() > minute; }
+};
+
+struct SectionAfterPulse {
+	bool operator() (double pulse, const MetricSection* s) const { return s->pulse() > pulse; }
+};
+
+struct SectionAfterSample {
+	bool operator() (samplepos_t sample, const MetricSection* s) const { return s->sample() > sample; }
+};
+
+struct MeterAfterBeat {
+	bool operator() (double beat, const MeterSection* m) const { return m->beat() > beat; }
+};
+
+struct MeterAfterBBT {
+	bool operator() (BBT_Time const& bbt, const MeterSection* m) const {
+		return m->bbt().bars > bbt.bars || (m->bbt().bars == bbt.bars && m->bbt().beats > bbt.beats);
+	}
+};
+
+struct MeterAfterBar {
+	bool operator() (uint32_t bars, const MeterSection* m) const { return m->bbt().bars > bars; }
+};
+
+/** tempo sections in meter-based beats, relative to the meter the beat is in */
+struct TempoAfterBeat {
+	TempoAfterBeat (const MeterSection* m) : meter (m) {}
+	bool operator() (double beat, const TempoSection* t) const {
+		return ((t->pulse() - meter->pulse()) * meter->note_divisor()) + meter->beat() > beat;
+	}
+	const MeterSection* meter;
+};
+
+/** @return iterator to the first of @a sections past @a pos, ignoring the first
+ *  one: like in the list searches, that one applies to anything before it, too.
+ *  The section in effect at @a pos is the one before the result.
+ */
+template<typename Section, typename Pos, typename After>
+static typename std::vector<Section*>::const_iterator
+section_after (std::vector<Section*> const& sections, Pos const& pos, After const& after)
+{
+	return upper_bound (sections.begin() + 1, sections.end(), pos, after);
+}
+
+/* the arithmetic of some lookups, once the sections have been found,
+ * shared by TempoMap and TempoMap::Snapshot.
+ */
+
+/** @param prev_t the tempo section @a minute is in
+ *  @param next_t the (active) one after it, or 0
+ */
+static double
+pulse_at_minute_in (const TempoSection* prev_t, const TempoSection* next_t, double minute)
+{
+	if (next_t) {
+		/*the previous ts is the one containing the sample */
+		const double ret = prev_t->pulse_at_minute (minute);
+		/* audio locked section in new meter*/
+		if (next_t->pulse() < ret) {
+			return next_t->pulse();
+		}
+		return ret;
+	}
+
+	/* treated as constant for this ts */
+	const double pulses_in_section = ((minute - prev_t->minute()) * prev_t->note_types_per_minute()) / prev_t->note_type();
+
+	return pulses_in_section + prev_t->pulse();
+}
+
+/** @param prev_m the meter section @a bbt is in */
+static double
+pulse_at_bbt_in (const MeterSection* prev_m, const BBT_Time& bbt)
+{
+	const double remaining_bars = bbt.bars - prev_m->bbt().bars;
+	const double remaining_pulses = remaining_bars * prev_m->divisions_per_bar() / prev_m->note_divisor();
+	const double ret = remaining_pulses + prev_m->pulse() + (((bbt.beats - 1) + (bbt.ticks / BBT_Time::ticks_per_beat)) / prev_m->note_divisor());
+
+	return ret;
+}
+
+/** @param ts the tempo section @a minute is in
+ *  @param prev_m the meter section @a minute is in
+ *  @param next_m the one after it, or 0
+ */
+static BBT_Time
+bbt_at_minute_in (const TempoSection& ts, const MeterSection* prev_m, const MeterSection* next_m, double minute)
+{
+	if (minute < 0) {
+		BBT_Time bbt;
+		bbt.bars = 1;
+		bbt.beats = 1;
+		bbt.ticks = 0;
+		return bbt;
+	}
+
+	double beat = prev_m->beat() + (ts.pulse_at_minute (minute) - prev_m->pulse()) * prev_m->note_divisor();
+
+	/* handle sample before first meter */
+	if (minute < prev_m->minute()) {
+		beat = 0.0;
+	}
+	/* audio locked meters fake their beat */
+	if (next_m && next_m->beat() < beat) {
+		beat = next_m->beat();
+	}
+
+	beat = max (0.0, beat);
+
+	const double beats_in_ms = beat - prev_m->beat();
+	const uint32_t bars_in_ms = (uint32_t) floor (beats_in_ms / prev_m->divisions_per_bar());
+	const uint32_t total_bars = bars_in_ms + (prev_m->bbt().bars - 1);
+	const double remaining_beats = beats_in_ms - (bars_in_ms * prev_m->divisions_per_bar());
+	const double remaining_ticks = (remaining_beats - floor (remaining_beats)) * BBT_Time::ticks_per_beat;
+
+	BBT_Time ret;
+
+	ret.ticks = (uint32_t) floor (remaining_ticks + 0.5);
+	ret.beats = (uint32_t) floor (remaining_beats);
+	ret.bars = total_bars;
+
+	/* 0 0 0 to 1 1 0 - based mapping*/
+	++ret.bars;
+	++ret.beats;
+
+	if (ret.ticks >= BBT_Time::ticks_per_beat) {
+		++ret.beats;
+		ret.ticks -= BBT_Time::ticks_per_beat;
+	}
+
+	if (ret.beats >= prev_m->divisions_per_bar() + 1) {
+		++ret.bars;
+		ret.beats = 1;
+	}
+
+	return ret;
+}
+
+void
+TempoMap::MetricIndex::build (const Metrics& metrics)
+{
+	tempos.clear ();
+	all_tempos.clear ();
+	meters.clear ();
+
+	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+		if ((*i)->is_tempo()) {
+			TempoSection* t = static_cast<TempoSection*> (*i);
+			all_tempos.push_back (t);
+			if (t->active()) {
+				tempos.push_back (t);
+			}
+		} else {
+			meters.push_back (static_cast<MeterSection*> (*i));
+		}
+	}
+
+	valid = !tempos.empty() && !meters.empty();
+}
+
+TempoMap::Snapshot::Snapshot (Snapshot const& other)
+	: _sample_rate (other._sample_rate)
+{
+	set (other._metrics, other._sample_rate);
+}
+
+TempoMap::Snapshot::~Snapshot ()
+{
+	clear ();
+}
+
+void
+TempoMap::Snapshot::clear ()
+{
+	for (Metrics::const_iterator i = _metrics.begin(); i != _metrics.end(); ++i) {
+		delete (*i);
+	}
+	_metrics.clear ();
+	_index.build (_metrics);
+}
+
+void
+TempoMap::Snapshot::set (const Metrics& metrics, samplecnt_t sample_rate)
+{
+	clear ();
+
+	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+		if ((*i)->is_tempo()) {
+			_metrics.push_back (new TempoSection (*static_cast<const TempoSection*> (*i)));
+		} else {
+			_metrics.push_back (new MeterSection (*static_cast<const MeterSection*> (*i)));
+		}
+	}
+
+	_index.build (_metrics);
+	_sample_rate = sample_rate;
+}
+
+double
+TempoMap::Snapshot::pulse_at_minute (double minute) const
+{
+	assert (_index.valid);
+
+	vector<TempoSection*>::const_iterator i = section_after (_index.tempos, minute, SectionAfterMinute());
+
+	return pulse_at_minute_in (*(i - 1), (i != _index.tempos.end()) ? *i : 0, minute);
+}
+
+double
+TempoMap::Snapshot::pulse_at_bbt (const BBT_Time& bbt) const
+{
+	assert (_index.valid);
+
+	return pulse_at_bbt_in (*(section_after (_index.meters, bbt.bars, MeterAfterBar()) - 1), bbt);
+}
+
+double
+TempoMap::Snapshot::minute_at_pulse (double pulse) const
+{
+	assert (_index.valid);
+
+	vector<TempoSection*>::const_iterator i = section_after (_index.tempos, pulse, SectionAfterPulse());
+	const TempoSection* prev_t = *(i - 1);
+
+	if (i != _index.tempos.end()) {
+		return prev_t->minute_at_pulse (pulse);
+	}
+
+	/* must be treated as constant, irrespective of _type */
+	return (((pulse - prev_t->pulse()) * prev_t->note_type()) / prev_t->note_types_per_minute()) + prev_t->minute();
+}
+
+double
+TempoMap::Snapshot::quarter_notes_between (double start_minute, double end_minute) const
+{
+	assert (_index.valid);
+
+	const TempoSection* start_t = *(section_after (_index.tempos, start_minute, SectionAfterMinute()) - 1);
+	const TempoSection* end_t = *(section_after (_index.tempos, end_minute, SectionAfterMinute()) - 1);
+
+	return (end_t->pulse_at_minute (end_minute) - start_t->pulse_at_minute (start_minute)) * 4.0;
+}
+
+BBT_Time
+TempoMap::Snapshot::bbt_at_minute (double minute) const
+{
+	assert (_index.valid);
+
+	const TempoSection* ts = *(section_after (_index.tempos, minute, SectionAfterMinute()) - 1);
+	vector<MeterSection*>::const_iterator m = section_after (_index.meters, minute, SectionAfterMinute());
+
+	return bbt_at_minute_in (*ts, *(m - 1), (m != _index.meters.end()) ? *m : 0, minute);
+}
+
+Meter
+TempoMap::Snapshot::meter_at_minute (double minute) const
+{
+	assert (_index.valid);
+
+	return **(section_after (_index.meters, minute, SectionAfterMinute()) - 1);
+}
+
 TempoMap::TempoMap (samplecnt_t fr)
+	: _snapshot (new Snapshot)
+	, _snapshot_dirty (false)
 {
 	_sample_rate = fr;
 	BBT_Time start (1, 1, 0);
@@ -732,6 +1009,8 @@ TempoMap::TempoMap (samplecnt_t fr)
 	_metrics.push_back (t);
 	_metrics.push_back (m);
 
+	rebuild_index ();
+	publish_snapshot ();
 }
 
 TempoMap&
@@ -739,7 +1018,7 @@ TempoMap::operator= (TempoMap const & other)
 {
 	if (&other != this) {
 		Glib::Threads::RWLock::ReaderLock lr (other.lock);
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 		_sample_rate = other._sample_rate;
 
 		Metrics::const_iterator d = _metrics.begin();
@@ -748,6 +1027,7 @@ TempoMap::operator= (TempoMap const & other)
 			++d;
 		}
 		_metrics.clear();
+		invalidate_index ();
 
 		for (Metrics::const_iterator m = other._metrics.begin(); m != other._metrics.end(); ++m) {
 			TempoSection const * const ts = dynamic_cast<TempoSection const * const> (*m);
@@ -761,6 +1041,8 @@ TempoMap::operator= (TempoMap const & other)
 				_metrics.push_back (new_section);
 			}
 		}
+
+		rebuild_index ();
 	}
 
 	PropertyChanged (PropertyChange());
@@ -796,7 +1078,7 @@ TempoMap::remove_tempo (const TempoSection& tempo, bool complete_operation)
 	bool removed = false;
 
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 		if ((removed = remove_tempo_locked (tempo))) {
 			if (complete_operation) {
 				recompute_map (_metrics);
@@ -820,6 +1102,7 @@ TempoMap::remove_tempo_locked (const TempoSection& tempo)
 				if (!(*i)->initial()) {
 					delete (*i);
 					_metrics.erase (i);
+					invalidate_index ();
 					return true;
 				}
 			}
@@ -835,7 +1118,7 @@ TempoMap::remove_meter (const MeterSection& tempo, bool complete_operation)
 	bool removed = false;
 
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 		if ((removed = remove_meter_locked (tempo))) {
 			if (complete_operation) {
 				recompute_map (_metrics);
@@ -860,6 +1143,7 @@ TempoMap::remove_meter_locked (const MeterSection& meter)
 				if (t->locked_to_meter() && meter.sample() == (*i)->sample()) {
 					delete (*i);
 					_metrics.erase (i);
+					invalidate_index ();
 					break;
 				}
 			}
@@ -872,6 +1156,7 @@ TempoMap::remove_meter_locked (const MeterSection& meter)
 				if (!(*i)->initial()) {
 					delete (*i);
 					_metrics.erase (i);
+					invalidate_index ();
 					return true;
 				}
 			}
@@ -936,6 +1221,7 @@ TempoMap::do_insert (MetricSection* section)
 				} else {
 					delete (*i);
 					_metrics.erase (i);
+					invalidate_index ();
 				}
 				break;
 			}
@@ -961,6 +1247,7 @@ TempoMap::do_insert (MetricSection* section)
 				} else {
 					delete (*i);
 					_metrics.erase (i);
+					invalidate_index ();
 				}
 
 				break;
@@ -1014,6 +1301,7 @@ TempoMap::do_insert (MetricSection* section)
 		}
 
 		_metrics.insert (i, section);
+		invalidate_index ();
 		//dump (std::cout);
 	}
 }
@@ -1028,7 +1316,7 @@ TempoMap::add_tempo (const Tempo& tempo, const double& pulse, const samplepos_t
 
 	TempoSection* ts = 0;
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 		/* here we default to not clamped for a new tempo section. preference? */
 		ts = add_tempo_locked (tempo, pulse, minute_at_sample (sample), pls, true, false, false);
 
@@ -1053,7 +1341,7 @@ TempoMap::replace_tempo (TempoSection& ts, const Tempo& tempo, const double& pul
 	TempoSection* new_ts = 0;
 
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 		TempoSection& first (first_tempo());
 		if (!ts.initial()) {
 			if (locked_to_meter) {
@@ -1130,7 +1418,7 @@ TempoMap::add_meter (const Meter& meter, const Timecode::BBT_Time& where, sample
 {
 	MeterSection* m = 0;
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 		m = add_meter_locked (meter, where, sample, pls, true);
 	}
 
@@ -1149,7 +1437,7 @@ void
 TempoMap::replace_meter (const MeterSection& ms, const Meter& meter, const BBT_Time& where, samplepos_t sample, PositionLockStyle pls)
 {
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 
 		if (!ms.initial()) {
 			remove_meter_locked (ms);
@@ -1244,7 +1532,7 @@ TempoMap::change_initial_tempo (double note_types_per_minute, double note_type,
 				continue;
 			}
 			{
-				Glib::Threads::RWLock::WriterLock lm (lock);
+				WriteLock lm (*this);
 				*((Tempo*) t) = newtempo;
 				recompute_map (_metrics);
 			}
@@ -1297,7 +1585,7 @@ TempoMap::change_existing_tempo_at (samplepos_t where, double note_types_per_min
 	/* reset */
 
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 		/* cannot move the first tempo section */
 		*((Tempo*)prev) = newtempo;
 		recompute_map (_metrics);
@@ -1384,10 +1672,15 @@ TempoMap::first_tempo ()
 	return *t;
 }
 void
-TempoMap::recompute_tempi (Metrics& metrics)
+TempoMap::recompute_tempi (Metrics& metrics, bool reindex)
 {
 	TempoSection* prev_t = 0;
 
+	/* positions are in flux until we're done, so search linearly meanwhile */
+	if (&metrics == &_metrics) {
+		invalidate_index ();
+	}
+
 	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
 		TempoSection* t;
 
@@ -1422,6 +1715,10 @@ TempoMap::recompute_tempi (Metrics& metrics)
 	}
 	assert (prev_t);
 	prev_t->set_c (0.0);
+
+	if (reindex && &metrics == &_metrics) {
+		rebuild_index ();
+	}
 }
 
 /* tempos must be positioned correctly.
@@ -1435,6 +1732,11 @@ TempoMap::recompute_meters (Metrics& metrics)
 	MeterSection* meter = 0;
 	MeterSection* prev_m = 0;
 
+	/* positions are in flux until we're done, so search linearly meanwhile */
+	if (&metrics == &_metrics) {
+		invalidate_index ();
+	}
+
 	for (Metrics::const_iterator mi = metrics.begin(); mi != metrics.end(); ++mi) {
 		if (!(*mi)->is_tempo()) {
 			meter = static_cast<MeterSection*> (*mi);
@@ -1504,6 +1806,10 @@ TempoMap::recompute_meters (Metrics& metrics)
 			prev_m = meter;
 		}
 	}
+
+	if (&metrics == &_metrics) {
+		rebuild_index ();
+	}
 }
 
 void
@@ -1519,16 +1825,76 @@ TempoMap::recompute_map (Metrics& metrics, samplepos_t end)
 		return;
 	}
 
-	recompute_tempi (metrics);
+	/* the meters rebuild the index, no need to publish the map in between */
+	recompute_tempi (metrics, false);
 	recompute_meters (metrics);
 }
 
+void
+TempoMap::rebuild_index ()
+{
+	/* CALLER MUST HOLD WRITE LOCK */
+
+	_index.build (_metrics);
+	_snapshot_dirty = true;
+}
+
+void
+TempoMap::publish_snapshot ()
+{
+	/* CALLER MUST HOLD WRITE LOCK */
+
+	if (!_index.valid) {
+		/* an edit that did not end in a recompute */
+		rebuild_index ();
+	}
+
+	if (!_snapshot_dirty || !_index.valid) {
+		return;
+	}
+
+	/* the previous snapshot stays in the RCU manager's dead wood until a
+	   later replace() in a writer's thread finds it unused, so it is
+	   never deleted by a reader.
+	*/
+	boost::shared_ptr<Snapshot> s (new Snapshot);
+	s->set (_metrics, _sample_rate);
+	_snapshot.replace (s);
+
+	_snapshot_dirty = false;
+}
+
 TempoMetric
 TempoMap::metric_at (samplepos_t sample, Metrics::const_iterator* last) const
 {
 	Glib::Threads::RWLock::ReaderLock lm (lock);
 	TempoMetric m (first_meter(), first_tempo());
 
+	if (!last && _index.valid) {
+		vector<TempoSection*>::const_iterator t = upper_bound (_index.all_tempos.begin(), _index.all_tempos.end(), sample, SectionAfterSample());
+		vector<MeterSection*>::const_iterator ms = upper_bound (_index.meters.begin(), _index.meters.end(), sample, SectionAfterSample());
+		const MetricSection* latest = 0;
+
+		if (t != _index.all_tempos.begin()) {
+			--t;
+			m.set_tempo (**t);
+			latest = *t;
+		}
+		if (ms != _index.meters.begin()) {
+			--ms;
+			m.set_meter (**ms);
+			if (!latest || (*ms)->sample() >= latest->sample()) {
+				latest = *ms;
+			}
+		}
+		if (latest) {
+			m.set_minute (latest->minute());
+			m.set_pulse (latest->pulse());
+		}
+
+		return m;
+	}
+
 	if (last) {
 		*last = ++_metrics.begin();
 	}
@@ -1570,6 +1936,14 @@ TempoMap::metric_at (BBT_Time bbt) const
 	   now see if we can find better candidates.
 	*/
 
+	if (_index.valid) {
+		vector<MeterSection*>::const_iterator i = upper_bound (_index.meters.begin(), _index.meters.end(), bbt, MeterAfterBBT());
+		if (i != _index.meters.begin()) {
+			m.set_metric (*(i - 1));
+		}
+		return m;
+	}
+
 	for (Metrics::const_iterator i = _metrics.begin(); i != _metrics.end(); ++i) {
 		MeterSection* mw;
 		if (!(*i)->is_tempo()) {
@@ -1612,13 +1986,21 @@ TempoMap::beat_at_minute_locked (const Metrics& metrics, const double& minute) c
 	MeterSection* prev_m = 0;
 	MeterSection* next_m = 0;
 
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
-		if (!(*i)->is_tempo()) {
-			if (prev_m && (*i)->minute() > minute) {
-				next_m = static_cast<MeterSection*> (*i);
-				break;
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		vector<MeterSection*>::const_iterator i = section_after (index->meters, minute, SectionAfterMinute());
+		prev_m = *(i - 1);
+		next_m = (i != index->meters.end()) ? *i : 0;
+	} else {
+		for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+			if (!(*i)->is_tempo()) {
+				if (prev_m && (*i)->minute() > minute) {
+					next_m = static_cast<MeterSection*> (*i);
+					break;
+				}
+				prev_m = static_cast<MeterSection*> (*i);
 			}
-			prev_m = static_cast<MeterSection*> (*i);
 		}
 	}
 
@@ -1650,40 +2032,8 @@ TempoMap::sample_at_beat (const double& beat) const
 double
 TempoMap::minute_at_beat_locked (const Metrics& metrics, const double& beat) const
 {
-	MeterSection* prev_m = 0;
-	TempoSection* prev_t = 0;
-
-	MeterSection* m;
-
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
-		if (!(*i)->is_tempo()) {
-			m = static_cast<MeterSection*> (*i);
-			if (prev_m && m->beat() > beat) {
-				break;
-			}
-			prev_m = m;
-		}
-	}
-	assert (prev_m);
-
-	TempoSection* t;
-
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
-		if ((*i)->is_tempo()) {
-			t = static_cast<TempoSection*> (*i);
-
-			if (!t->active()) {
-				continue;
-			}
-
-			if (prev_t && ((t->pulse() - prev_m->pulse()) * prev_m->note_divisor()) + prev_m->beat() > beat) {
-				break;
-			}
-			prev_t = t;
-		}
-
-	}
-	assert (prev_t);
+	const MeterSection* prev_m = &meter_section_at_beat_locked (metrics, beat);
+	const TempoSection* prev_t = &tempo_section_at_beat_locked (metrics, beat);
 
 	return prev_t->minute_at_pulse (((beat - prev_m->beat()) / prev_m->note_divisor()) + prev_m->pulse());
 }
@@ -1706,6 +2056,17 @@ TempoMap::tempo_at_minute_locked (const Metrics& metrics, const double& minute)
 {
 	TempoSection* prev_t = 0;
 
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		vector<TempoSection*>::const_iterator i = section_after (index->tempos, minute, SectionAfterMinute());
+		prev_t = *(i - 1);
+		if (i != index->tempos.end()) {
+			return prev_t->tempo_at_minute (minute);
+		}
+		return Tempo (prev_t->note_types_per_minute(), prev_t->note_type(), prev_t->end_note_types_per_minute());
+	}
+
 	TempoSection* t;
 
 	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
@@ -1783,6 +2144,17 @@ TempoMap::tempo_at_pulse_locked (const Metrics& metrics, const double& pulse) co
 {
 	TempoSection* prev_t = 0;
 
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		vector<TempoSection*>::const_iterator i = section_after (index->tempos, pulse, SectionAfterPulse());
+		prev_t = *(i - 1);
+		if (i != index->tempos.end()) {
+			return prev_t->tempo_at_pulse (pulse);
+		}
+		return Tempo (prev_t->note_types_per_minute(), prev_t->note_type(), prev_t->end_note_types_per_minute());
+	}
+
 	TempoSection* t;
 
 	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
@@ -1894,14 +2266,20 @@ TempoMap::beat_at_pulse_locked (const Metrics& metrics, const double& pulse) con
 {
 	MeterSection* prev_m = 0;
 
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
-		MeterSection* m;
-		if (!(*i)->is_tempo()) {
-			m = static_cast<MeterSection*> (*i);
-			if (prev_m && m->pulse() > pulse) {
-				break;
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		prev_m = *(section_after (index->meters, pulse, SectionAfterPulse()) - 1);
+	} else {
+		for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+			MeterSection* m;
+			if (!(*i)->is_tempo()) {
+				m = static_cast<MeterSection*> (*i);
+				if (prev_m && m->pulse() > pulse) {
+					break;
+				}
+				prev_m = m;
 			}
-			prev_m = m;
 		}
 	}
 	assert (prev_m);
@@ -1916,31 +2294,32 @@ TempoMap::pulse_at_minute_locked (const Metrics& metrics, const double& minute)
 {
 	/* HOLD (at least) THE READER LOCK */
 	TempoSection* prev_t = 0;
+	TempoSection* next_t = 0;
 
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
-		TempoSection* t;
-		if ((*i)->is_tempo()) {
-			t = static_cast<TempoSection*> (*i);
-			if (!t->active()) {
-				continue;
-			}
-			if (prev_t && t->minute() > minute) {
-				/*the previous ts is the one containing the sample */
-				const double ret = prev_t->pulse_at_minute (minute);
-				/* audio locked section in new meter*/
-				if (t->pulse() < ret) {
-					return t->pulse();
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		vector<TempoSection*>::const_iterator i = section_after (index->tempos, minute, SectionAfterMinute());
+		prev_t = *(i - 1);
+		next_t = (i != index->tempos.end()) ? *i : 0;
+	} else {
+		for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+			TempoSection* t;
+			if ((*i)->is_tempo()) {
+				t = static_cast<TempoSection*> (*i);
+				if (!t->active()) {
+					continue;
 				}
-				return ret;
+				if (prev_t && t->minute() > minute) {
+					next_t = t;
+					break;
+				}
+				prev_t = t;
 			}
-			prev_t = t;
 		}
 	}
 
-	/* treated as constant for this ts */
-	const double pulses_in_section = ((minute - prev_t->minute()) * prev_t->note_types_per_minute()) / prev_t->note_type();
-
-	return pulses_in_section + prev_t->pulse();
+	return pulse_at_minute_in (prev_t, next_t, minute);
 }
 
 /* tempo section based */
@@ -1951,19 +2330,29 @@ TempoMap::minute_at_pulse_locked (const Metrics& metrics, const double& pulse) c
 
 	const TempoSection* prev_t = 0;
 
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
-		TempoSection* t;
+	MetricIndex const* const index = index_for (metrics);
 
-		if ((*i)->is_tempo()) {
-			t = static_cast<TempoSection*> (*i);
-			if (!t->active()) {
-				continue;
-			}
-			if (prev_t && t->pulse() > pulse) {
-				return prev_t->minute_at_pulse (pulse);
-			}
+	if (index) {
+		vector<TempoSection*>::const_iterator i = section_after (index->tempos, pulse, SectionAfterPulse());
+		prev_t = *(i - 1);
+		if (i != index->tempos.end()) {
+			return prev_t->minute_at_pulse (pulse);
+		}
+	} else {
+		for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+			TempoSection* t;
 
-			prev_t = t;
+			if ((*i)->is_tempo()) {
+				t = static_cast<TempoSection*> (*i);
+				if (!t->active()) {
+					continue;
+				}
+				if (prev_t && t->pulse() > pulse) {
+					return prev_t->minute_at_pulse (pulse);
+				}
+
+				prev_t = t;
+			}
 		}
 	}
 	/* must be treated as constant, irrespective of _type */
@@ -1997,16 +2386,36 @@ TempoMap::beat_at_bbt_locked (const Metrics& metrics, const Timecode::BBT_Time&
 	*/
 	MeterSection* m;
 
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
-		if (!(*i)->is_tempo()) {
-			m = static_cast<MeterSection*> (*i);
-			if (prev_m) {
-				const double bars_to_m = (m->beat() - prev_m->beat()) / prev_m->divisions_per_bar();
-				if ((bars_to_m + (prev_m->bbt().bars - 1)) > (bbt.bars - 1)) {
-					break;
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		/* the bar of each meter is measured from the one before it */
+		vector<MeterSection*> const& meters (index->meters);
+		size_t lo = 1;
+		size_t hi = meters.size();
+
+		while (lo < hi) {
+			const size_t mid = lo + (hi - lo) / 2;
+			const double bars_to_m = (meters[mid]->beat() - meters[mid - 1]->beat()) / meters[mid - 1]->divisions_per_bar();
+			if ((bars_to_m + (meters[mid - 1]->bbt().bars - 1)) > (bbt.bars - 1)) {
+				hi = mid;
+			} else {
+				lo = mid + 1;
+			}
+		}
+		prev_m = meters[lo - 1];
+	} else {
+		for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+			if (!(*i)->is_tempo()) {
+				m = static_cast<MeterSection*> (*i);
+				if (prev_m) {
+					const double bars_to_m = (m->beat() - prev_m->beat()) / prev_m->divisions_per_bar();
+					if ((bars_to_m + (prev_m->bbt().bars - 1)) > (bbt.bars - 1)) {
+						break;
+					}
 				}
+				prev_m = m;
 			}
-			prev_m = m;
 		}
 	}
 
@@ -2038,17 +2447,23 @@ TempoMap::bbt_at_beat_locked (const Metrics& metrics, const double& b) const
 
 	MeterSection* m = 0;
 
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
-		if (!(*i)->is_tempo()) {
-			m = static_cast<MeterSection*> (*i);
-			if (prev_m) {
-				if (m->beat() > beats) {
-					/* this is the meter after the one our beat is on*/
-					break;
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		prev_m = *(section_after (index->meters, beats, MeterAfterBeat()) - 1);
+	} else {
+		for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+			if (!(*i)->is_tempo()) {
+				m = static_cast<MeterSection*> (*i);
+				if (prev_m) {
+					if (m->beat() > beats) {
+						/* this is the meter after the one our beat is on*/
+						break;
+					}
 				}
-			}
 
-			prev_m = m;
+				prev_m = m;
+			}
 		}
 	}
 	assert (prev_m);
@@ -2101,13 +2516,9 @@ TempoMap::quarter_note_at_bbt (const Timecode::BBT_Time& bbt)
 double
 TempoMap::quarter_note_at_bbt_rt (const Timecode::BBT_Time& bbt)
 {
-	Glib::Threads::RWLock::ReaderLock lm (lock, Glib::Threads::TRY_LOCK);
-
-	if (!lm.locked()) {
-		throw std::logic_error ("TempoMap::quarter_note_at_bbt_rt() could not lock tempo map");
-	}
+	boost::shared_ptr<Snapshot> s (_snapshot.reader ());
 
-	return pulse_at_bbt_locked (_metrics, bbt) * 4.0;
+	return s->pulse_at_bbt (bbt) * 4.0;
 }
 
 double
@@ -2122,23 +2533,25 @@ TempoMap::pulse_at_bbt_locked (const Metrics& metrics, const Timecode::BBT_Time&
 	*/
 	MeterSection* m;
 
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
-		if (!(*i)->is_tempo()) {
-			m = static_cast<MeterSection*> (*i);
-			if (prev_m) {
-				if (m->bbt().bars > bbt.bars) {
-					break;
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		prev_m = *(section_after (index->meters, bbt.bars, MeterAfterBar()) - 1);
+	} else {
+		for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+			if (!(*i)->is_tempo()) {
+				m = static_cast<MeterSection*> (*i);
+				if (prev_m) {
+					if (m->bbt().bars > bbt.bars) {
+						break;
+					}
 				}
+				prev_m = m;
 			}
-			prev_m = m;
 		}
 	}
 
-	const double remaining_bars = bbt.bars - prev_m->bbt().bars;
-	const double remaining_pulses = remaining_bars * prev_m->divisions_per_bar() / prev_m->note_divisor();
-	const double ret = remaining_pulses + prev_m->pulse() + (((bbt.beats - 1) + (bbt.ticks / BBT_Time::ticks_per_beat)) / prev_m->note_divisor());
-
-	return ret;
+	return pulse_at_bbt_in (prev_m, bbt);
 }
 
 /** Returns the BBT time corresponding to the supplied quarter-note beat.
@@ -2172,20 +2585,26 @@ TempoMap::bbt_at_pulse_locked (const Metrics& metrics, const double& pulse) cons
 
 	MeterSection* m = 0;
 
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+	MetricIndex const* const index = index_for (metrics);
 
-		if (!(*i)->is_tempo()) {
-			m = static_cast<MeterSection*> (*i);
+	if (index) {
+		prev_m = *(section_after (index->meters, pulse, SectionAfterPulse()) - 1);
+	} else {
+		for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
 
-			if (prev_m) {
-				double const pulses_to_m = m->pulse() - prev_m->pulse();
-				if (prev_m->pulse() + pulses_to_m > pulse) {
-					/* this is the meter after the one our beat is on*/
-					break;
+			if (!(*i)->is_tempo()) {
+				m = static_cast<MeterSection*> (*i);
+
+				if (prev_m) {
+					double const pulses_to_m = m->pulse() - prev_m->pulse();
+					if (prev_m->pulse() + pulses_to_m > pulse) {
+						/* this is the meter after the one our beat is on*/
+						break;
+					}
 				}
-			}
 
-			prev_m = m;
+				prev_m = m;
+			}
 		}
 	}
 
@@ -2249,85 +2668,40 @@ TempoMap::bbt_at_sample (samplepos_t sample)
 BBT_Time
 TempoMap::bbt_at_sample_rt (samplepos_t sample)
 {
-	const double minute =  minute_at_sample (sample);
-
-	Glib::Threads::RWLock::ReaderLock lm (lock, Glib::Threads::TRY_LOCK);
+	boost::shared_ptr<Snapshot> s (_snapshot.reader ());
 
-	if (!lm.locked()) {
-		throw std::logic_error ("TempoMap::bbt_at_sample_rt() could not lock tempo map");
-	}
-
-	return bbt_at_minute_locked (_metrics, minute);
+	return s->bbt_at_minute (s->minute_at_sample (sample));
 }
 
 Timecode::BBT_Time
 TempoMap::bbt_at_minute_locked (const Metrics& metrics, const double& minute) const
 {
-	if (minute < 0) {
-		BBT_Time bbt;
-		bbt.bars = 1;
-		bbt.beats = 1;
-		bbt.ticks = 0;
-		return bbt;
-	}
-
 	const TempoSection& ts = tempo_section_at_minute_locked (metrics, minute);
 	MeterSection* prev_m = 0;
 	MeterSection* next_m = 0;
 
 	MeterSection* m;
 
-	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
-		if (!(*i)->is_tempo()) {
-			m = static_cast<MeterSection*> (*i);
-			if (prev_m && m->minute() > minute) {
-				next_m = m;
-				break;
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		vector<MeterSection*>::const_iterator i = section_after (index->meters, minute, SectionAfterMinute());
+		prev_m = *(i - 1);
+		next_m = (i != index->meters.end()) ? *i : 0;
+	} else {
+		for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
+			if (!(*i)->is_tempo()) {
+				m = static_cast<MeterSection*> (*i);
+				if (prev_m && m->minute() > minute) {
+					next_m = m;
+					break;
+				}
+				prev_m = m;
 			}
-			prev_m = m;
 		}
 	}
 
-	double beat = prev_m->beat() + (ts.pulse_at_minute (minute) - prev_m->pulse()) * prev_m->note_divisor();
-
-	/* handle sample before first meter */
-	if (minute < prev_m->minute()) {
-		beat = 0.0;
-	}
-	/* audio locked meters fake their beat */
-	if (next_m && next_m->beat() < beat) {
-		beat = next_m->beat();
-	}
-
-	beat = max (0.0, beat);
-
-	const double beats_in_ms = beat - prev_m->beat();
-	const uint32_t bars_in_ms = (uint32_t) floor (beats_in_ms / prev_m->divisions_per_bar());
-	const uint32_t total_bars = bars_in_ms + (prev_m->bbt().bars - 1);
-	const double remaining_beats = beats_in_ms - (bars_in_ms * prev_m->divisions_per_bar());
-	const double remaining_ticks = (remaining_beats - floor (remaining_beats)) * BBT_Time::ticks_per_beat;
-
-	BBT_Time ret;
-
-	ret.ticks = (uint32_t) floor (remaining_ticks + 0.5);
-	ret.beats = (uint32_t) floor (remaining_beats);
-	ret.bars = total_bars;
-
-	/* 0 0 0 to 1 1 0 - based mapping*/
-	++ret.bars;
-	++ret.beats;
-
-	if (ret.ticks >= BBT_Time::ticks_per_beat) {
-		++ret.beats;
-		ret.ticks -= BBT_Time::ticks_per_beat;
-	}
-
-	if (ret.beats >= prev_m->divisions_per_bar() + 1) {
-		++ret.bars;
-		ret.beats = 1;
-	}
-
-	return ret;
+	return bbt_at_minute_in (ts, prev_m, next_m, minute);
 }
 
 /** Returns the sample position corresponding to the supplied BBT time.
@@ -2388,15 +2762,9 @@ TempoMap::quarter_note_at_sample (const samplepos_t sample) const
 double
 TempoMap::quarter_note_at_sample_rt (const samplepos_t sample) const
 {
-	const double minute =  minute_at_sample (sample);
-
-	Glib::Threads::RWLock::ReaderLock lm (lock, Glib::Threads::TRY_LOCK);
+	boost::shared_ptr<Snapshot> s (_snapshot.reader ());
 
-	if (!lm.locked()) {
-		throw std::logic_error ("TempoMap::quarter_note_at_sample_rt() could not lock tempo map");
-	}
-
-	return pulse_at_minute_locked (_metrics, minute) * 4.0;
+	return s->pulse_at_minute (s->minute_at_sample (sample)) * 4.0;
 }
 
 /**
@@ -2590,6 +2958,10 @@ TempoMap::check_solved (const Metrics& metrics) const
 bool
 TempoMap::set_active_tempi (const Metrics& metrics, const samplepos_t sample)
 {
+	if (&metrics == &_metrics) {
+		invalidate_index ();
+	}
+
 	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
 		TempoSection* t;
 		if ((*i)->is_tempo()) {
@@ -2614,6 +2986,10 @@ TempoMap::set_active_tempi (const Metrics& metrics, const samplepos_t sample)
 bool
 TempoMap::solve_map_minute (Metrics& imaginary, TempoSection* section, const double& minute)
 {
+	if (&imaginary == &_metrics) {
+		invalidate_index ();
+	}
+
 	TempoSection* prev_t = 0;
 	TempoSection* section_prev = 0;
 	double first_m_minute = 0.0;
@@ -2697,6 +3073,10 @@ TempoMap::solve_map_minute (Metrics& imaginary, TempoSection* section, const dou
 bool
 TempoMap::solve_map_pulse (Metrics& imaginary, TempoSection* section, const double& pulse)
 {
+	if (&imaginary == &_metrics) {
+		invalidate_index ();
+	}
+
 	TempoSection* prev_t = 0;
 	TempoSection* section_prev = 0;
 
@@ -2763,6 +3143,10 @@ TempoMap::solve_map_pulse (Metrics& imaginary, TempoSection* section, const doub
 bool
 TempoMap::solve_map_minute (Metrics& imaginary, MeterSection* section, const double& minute)
 {
+	if (&imaginary == &_metrics) {
+		invalidate_index ();
+	}
+
 	/* disallow moving first meter past any subsequent one, and any initial meter before the first one */
 	const MeterSection* other =  &meter_section_at_minute_locked (imaginary, minute);
 	if ((section->initial() && !other->initial()) || (other->initial() && !section->initial() && other->minute() >= minute)) {
@@ -2912,6 +3296,10 @@ TempoMap::solve_map_minute (Metrics& imaginary, MeterSection* section, const dou
 bool
 TempoMap::solve_map_bbt (Metrics& imaginary, MeterSection* section, const BBT_Time& when)
 {
+	if (&imaginary == &_metrics) {
+		invalidate_index ();
+	}
+
 	/* disallow setting section to an existing meter's bbt */
 	for (Metrics::iterator i = imaginary.begin(); i != imaginary.end(); ++i) {
 		MeterSection* m;
@@ -3185,7 +3573,7 @@ TempoMap::gui_set_tempo_position (TempoSection* ts, const samplepos_t sample, co
 	if (ts->position_lock_style() == MusicTime) {
 		{
 			/* if we're snapping to a musical grid, set the pulse exactly instead of via the supplied sample. */
-			Glib::Threads::RWLock::WriterLock lm (lock);
+			WriteLock lm (*this);
 			TempoSection* tempo_copy = copy_metrics_and_point (_metrics, future_map, ts);
 
 			tempo_copy->set_position_lock_style (AudioTime);
@@ -3204,7 +3592,7 @@ TempoMap::gui_set_tempo_position (TempoSection* ts, const samplepos_t sample, co
 	} else {
 
 		{
-			Glib::Threads::RWLock::WriterLock lm (lock);
+			WriteLock lm (*this);
 			TempoSection* tempo_copy = copy_metrics_and_point (_metrics, future_map, ts);
 
 
@@ -3257,7 +3645,7 @@ TempoMap::gui_set_meter_position (MeterSection* ms, const samplepos_t sample)
 	if (ms->position_lock_style() == AudioTime) {
 
 		{
-			Glib::Threads::RWLock::WriterLock lm (lock);
+			WriteLock lm (*this);
 			MeterSection* copy = copy_metrics_and_point (_metrics, future_map, ms);
 
 			if (solve_map_minute (future_map, copy, minute_at_sample (sample))) {
@@ -3267,7 +3655,7 @@ TempoMap::gui_set_meter_position (MeterSection* ms, const samplepos_t sample)
 		}
 	} else {
 		{
-			Glib::Threads::RWLock::WriterLock lm (lock);
+			WriteLock lm (*this);
 			MeterSection* copy = copy_metrics_and_point (_metrics, future_map, ms);
 
 			const double beat = beat_at_minute_locked (_metrics, minute_at_sample (sample));
@@ -3295,7 +3683,7 @@ TempoMap::gui_change_tempo (TempoSection* ts, const Tempo& bpm)
 	Metrics future_map;
 	bool can_solve = false;
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 		TempoSection* tempo_copy = copy_metrics_and_point (_metrics, future_map, ts);
 
 		if (tempo_copy->type() == TempoSection::Constant) {
@@ -3362,7 +3750,7 @@ TempoMap::gui_stretch_tempo (TempoSection* ts, const samplepos_t sample, const s
 	Metrics future_map;
 
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 
 		if (!ts) {
 			return;
@@ -3468,7 +3856,7 @@ TempoMap::gui_stretch_tempo_end (TempoSection* ts, const samplepos_t sample, con
 	Metrics future_map;
 
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 
 		if (!ts) {
 			return;
@@ -3547,7 +3935,7 @@ TempoMap::gui_twist_tempi (TempoSection* ts, const Tempo& bpm, const samplepos_t
 	samplepos_t const min_dframe = 2;
 
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 		if (!ts) {
 			return false;
 		}
@@ -4108,28 +4496,50 @@ TempoMap::get_grid (vector<TempoMap::BBTPoint>& points,
 		    samplepos_t lower, samplepos_t upper, uint32_t bar_mod)
 {
 	Glib::Threads::RWLock::ReaderLock lm (lock);
-	int32_t cnt = ceil (beat_at_minute_locked (_metrics, minute_at_sample (lower)));
+
+	get_grid_locked (_metrics, points, lower, upper, bar_mod);
+}
+
+void
+TempoMap::get_grid_rt (vector<TempoMap::BBTPoint>& points,
+		       samplepos_t lower, samplepos_t upper, uint32_t bar_mod) const
+{
+	boost::shared_ptr<Snapshot> s (_snapshot.reader ());
+
+	/* the lookups get_grid_locked() makes find the snapshot's index
+	 * through this (see index_for()); s keeps it alive meanwhile.
+	 */
+	_rt_snapshot.set (s.get ());
+	get_grid_locked (s->metrics(), points, lower, upper, bar_mod);
+	_rt_snapshot.set (0);
+}
+
+void
+TempoMap::get_grid_locked (const Metrics& metrics, vector<TempoMap::BBTPoint>& points,
+			   samplepos_t lower, samplepos_t upper, uint32_t bar_mod) const
+{
+	int32_t cnt = ceil (beat_at_minute_locked (metrics, minute_at_sample (lower)));
 	samplecnt_t pos = 0;
 	/* although the map handles negative beats, bbt doesn't. */
 	if (cnt < 0.0) {
 		cnt = 0.0;
 	}
 
-	if (minute_at_beat_locked (_metrics, cnt) >= minute_at_sample (upper)) {
+	if (minute_at_beat_locked (metrics, cnt) >= minute_at_sample (upper)) {
 		return;
 	}
 	if (bar_mod == 0) {
 		while (pos >= 0 && pos < upper) {
-			pos = sample_at_minute (minute_at_beat_locked (_metrics, cnt));
-			const MeterSection meter = meter_section_at_minute_locked (_metrics, minute_at_sample (pos));
-			const BBT_Time bbt = bbt_at_beat_locked (_metrics, cnt);
-			const double qn = pulse_at_beat_locked (_metrics, cnt) * 4.0;
+			pos = sample_at_minute (minute_at_beat_locked (metrics, cnt));
+			const MeterSection meter = meter_section_at_minute_locked (metrics, minute_at_sample (pos));
+			const BBT_Time bbt = bbt_at_beat_locked (metrics, cnt);
+			const double qn = pulse_at_beat_locked (metrics, cnt) * 4.0;
 
-			points.push_back (BBTPoint (meter, tempo_at_minute_locked (_metrics, minute_at_sample (pos)), pos, bbt.bars, bbt.beats, qn));
+			points.push_back (BBTPoint (meter, tempo_at_minute_locked (metrics, minute_at_sample (pos)), pos, bbt.bars, bbt.beats, qn));
 			++cnt;
 		}
 	} else {
-		BBT_Time bbt = bbt_at_minute_locked (_metrics, minute_at_sample (lower));
+		BBT_Time bbt = bbt_at_minute_locked (metrics, minute_at_sample (lower));
 		bbt.beats = 1;
 		bbt.ticks = 0;
 
@@ -4139,11 +4549,11 @@ TempoMap::get_grid (vector<TempoMap::BBTPoint>& points,
 		}
 
 		while (pos >= 0 && pos < upper) {
-			pos = sample_at_minute (minute_at_bbt_locked (_metrics, bbt));
-			const MeterSection meter = meter_section_at_minute_locked (_metrics, minute_at_sample (pos));
-			const double qn = pulse_at_bbt_locked (_metrics, bbt) * 4.0;
+			pos = sample_at_minute (minute_at_bbt_locked (metrics, bbt));
+			const MeterSection meter = meter_section_at_minute_locked (metrics, minute_at_sample (pos));
+			const double qn = pulse_at_bbt_locked (metrics, bbt) * 4.0;
 
-			points.push_back (BBTPoint (meter, tempo_at_minute_locked (_metrics, minute_at_sample (pos)), pos, bbt.bars, bbt.beats, qn));
+			points.push_back (BBTPoint (meter, tempo_at_minute_locked (metrics, minute_at_sample (pos)), pos, bbt.bars, bbt.beats, qn));
 			bbt.bars += bar_mod;
 		}
 	}
@@ -4168,6 +4578,12 @@ TempoMap::tempo_section_at_sample (samplepos_t sample)
 const TempoSection&
 TempoMap::tempo_section_at_minute_locked (const Metrics& metrics, double minute) const
 {
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		return **(section_after (index->tempos, minute, SectionAfterMinute()) - 1);
+	}
+
 	TempoSection* prev = 0;
 
 	TempoSection* t;
@@ -4197,6 +4613,12 @@ TempoMap::tempo_section_at_minute_locked (const Metrics& metrics, double minute)
 TempoSection&
 TempoMap::tempo_section_at_minute_locked (const Metrics& metrics, double minute)
 {
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		return **(section_after (index->tempos, minute, SectionAfterMinute()) - 1);
+	}
+
 	TempoSection* prev = 0;
 
 	TempoSection* t;
@@ -4229,6 +4651,12 @@ TempoMap::tempo_section_at_beat_locked (const Metrics& metrics, const double& be
 	TempoSection* prev_t = 0;
 	const MeterSection* prev_m = &meter_section_at_beat_locked (metrics, beat);
 
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		return **(section_after (index->tempos, beat, TempoAfterBeat (prev_m)) - 1);
+	}
+
 	TempoSection* t;
 
 	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
@@ -4348,18 +4776,24 @@ TempoMap::samples_per_quarter_note_at (const samplepos_t sample, const samplecnt
 	Metrics::const_iterator i;
 	TempoSection* t;
 
-	for (i = _metrics.begin(); i != _metrics.end(); ++i) {
+	if (_index.valid) {
+		vector<TempoSection*>::const_iterator a = section_after (_index.tempos, sample, SectionAfterSample());
+		ts_at = *(a - 1);
+		ts_after = (a != _index.tempos.end()) ? *a : 0;
+	} else {
+		for (i = _metrics.begin(); i != _metrics.end(); ++i) {
 
-		if ((*i)->is_tempo()) {
-			t = static_cast<TempoSection*> (*i);
-			if (!t->active()) {
-				continue;
-			}
-			if (ts_at && (*i)->sample() > sample) {
-				ts_after = t;
-				break;
+			if ((*i)->is_tempo()) {
+				t = static_cast<TempoSection*> (*i);
+				if (!t->active()) {
+					continue;
+				}
+				if (ts_at && (*i)->sample() > sample) {
+					ts_after = t;
+					break;
+				}
+				ts_at = t;
 			}
-			ts_at = t;
 		}
 	}
 	assert (ts_at);
@@ -4381,6 +4815,12 @@ TempoMap::meter_section_at_sample (samplepos_t sample) const
 const MeterSection&
 TempoMap::meter_section_at_minute_locked (const Metrics& metrics, double minute) const
 {
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		return **(section_after (index->meters, minute, SectionAfterMinute()) - 1);
+	}
+
 	Metrics::const_iterator i;
 	MeterSection* prev = 0;
 
@@ -4410,6 +4850,12 @@ TempoMap::meter_section_at_minute_locked (const Metrics& metrics, double minute)
 const MeterSection&
 TempoMap::meter_section_at_beat_locked (const Metrics& metrics, const double& beat) const
 {
+	MetricIndex const* const index = index_for (metrics);
+
+	if (index) {
+		return **(section_after (index->meters, beat, MeterAfterBeat()) - 1);
+	}
+
 	MeterSection* prev_m = 0;
 
 	for (Metrics::const_iterator i = metrics.begin(); i != metrics.end(); ++i) {
@@ -4440,6 +4886,14 @@ TempoMap::meter_at_sample (samplepos_t sample) const
 	return m.meter();
 }
 
+Meter
+TempoMap::meter_at_sample_rt (samplepos_t sample) const
+{
+	boost::shared_ptr<Snapshot> s (_snapshot.reader ());
+
+	return s->meter_at_minute (s->minute_at_sample (sample));
+}
+
 void
 TempoMap::fix_legacy_session ()
 {
@@ -4564,12 +5018,13 @@ int
 TempoMap::set_state (const XMLNode& node, int /*version*/)
 {
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 
 		XMLNodeList nlist;
 		XMLNodeConstIterator niter;
 		Metrics old_metrics (_metrics);
 		_metrics.clear();
+		invalidate_index ();
 
 		nlist = node.children();
 
@@ -4769,7 +5224,7 @@ TempoMap::remove_time (samplepos_t where, samplecnt_t amount)
 	bool tempo_after = false; // is there a tempo marker at the first sample after the removed range?
 	bool meter_after = false; // is there a meter marker likewise?
 	{
-		Glib::Threads::RWLock::WriterLock lm (lock);
+		WriteLock lm (*this);
 		for (Metrics::iterator i = _metrics.begin(); i != _metrics.end(); ++i) {
 			if ((*i)->sample() >= where && (*i)->sample() < where+amount) {
 				metric_kill_list.push_back(*i);
@@ -4807,6 +5262,7 @@ TempoMap::remove_time (samplepos_t where, samplecnt_t amount)
 		//remove all the remaining metrics
 		for (std::list<MetricSection*>::iterator i = metric_kill_list.begin(); i != metric_kill_list.end(); ++i) {
 			_metrics.remove(*i);
+			invalidate_index ();
 			moved = true;
 		}
 
@@ -4865,6 +5321,23 @@ TempoMap::framewalk_to_qn (samplepos_t pos, samplecnt_t distance) const
 	return Temporal::Beats (quarter_notes_between_samples_locked (_metrics, pos, pos + distance));
 }
 
+samplepos_t
+TempoMap::samplepos_plus_qn_rt (samplepos_t sample, Temporal::Beats beats) const
+{
+	boost::shared_ptr<Snapshot> s (_snapshot.reader ());
+	const double sample_qn = s->pulse_at_minute (s->minute_at_sample (sample)) * 4.0;
+
+	return sample_at_minute (s->minute_at_pulse ((sample_qn + beats.to_double()) / 4.0));
+}
+
+Temporal::Beats
+TempoMap::framewalk_to_qn_rt (samplepos_t pos, samplecnt_t distance) const
+{
+	boost::shared_ptr<Snapshot> s (_snapshot.reader ());
+
+	return Temporal::Beats (s->quarter_notes_between (s->minute_at_sample (pos), s->minute_at_sample (pos + distance)));
+}
+
 struct bbtcmp {
     bool operator() (const BBT_Time& a, const BBT_Time& b) {
 	    return a < b;
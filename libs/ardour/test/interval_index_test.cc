@@ -0,0 +1,144 @@
+#include <cstdlib>
+#include <vector>
+
+#include "ardour/interval_index.h"
+
+#include "interval_index_test.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION (IntervalIndexTest);
+
+using namespace std;
+using namespace ARDOUR;
+
+void
+IntervalIndexTest::emptyTest ()
+{
+	IntervalIndex<int> idx;
+	idx.build ();
+
+	vector<int> out;
+	idx.overlapping (0, 1000, out);
+	idx.covering (10, out);
+
+	CPPUNIT_ASSERT (out.empty ());
+	CPPUNIT_ASSERT_EQUAL ((size_t) 0, idx.count_covering (10));
+	CPPUNIT_ASSERT_EQUAL ((size_t) 0, idx.first_starting_after (10));
+}
+
+void
+IntervalIndexTest::basicTest ()
+{
+	IntervalIndex<int> idx;
+
+	/* added out of order on purpose */
+	idx.add (100, 199, 2);
+	idx.add (0, 99, 1);
+	idx.add (50, 1049, 3); // long, overlaps everything up to 1049
+	idx.add (2000, 2099, 4);
+	idx.build ();
+
+	vector<int> out;
+
+	idx.covering (99, out);
+	CPPUNIT_ASSERT_EQUAL ((size_t) 2, out.size ());
+	CPPUNIT_ASSERT_EQUAL (1, out[0]);
+	CPPUNIT_ASSERT_EQUAL (3, out[1]);
+
+	out.clear ();
+	idx.covering (100, out);
+	CPPUNIT_ASSERT_EQUAL ((size_t) 2, out.size ());
+	CPPUNIT_ASSERT_EQUAL (3, out[0]);
+	CPPUNIT_ASSERT_EQUAL (2, out[1]);
+
+	out.clear ();
+	idx.overlapping (1050, 1999, out);
+	CPPUNIT_ASSERT (out.empty ());
+
+	out.clear ();
+	idx.overlapping (1049, 2000, out);
+	CPPUNIT_ASSERT_EQUAL ((size_t) 2, out.size ());
+	CPPUNIT_ASSERT_EQUAL (3, out[0]);
+	CPPUNIT_ASSERT_EQUAL (4, out[1]);
+
+	CPPUNIT_ASSERT_EQUAL ((size_t) 2, idx.count_covering (150));
+	CPPUNIT_ASSERT_EQUAL ((size_t) 0, idx.count_covering (1500));
+
+	CPPUNIT_ASSERT_EQUAL ((size_t) 2, idx.first_starting_after (50));
+	CPPUNIT_ASSERT_EQUAL ((size_t) 1, idx.first_starting_at_or_after (50));
+	CPPUNIT_ASSERT_EQUAL ((size_t) 4, idx.first_starting_after (2000));
+}
+
+void
+IntervalIndexTest::orderTest ()
+{
+	/* intervals with the same start keep the order they were added in */
+	IntervalIndex<int> idx;
+
+	for (int i = 0; i < 10; ++i) {
+		idx.add (100, 200 + i, i);
+	}
+	idx.build ();
+
+	vector<int> out;
+	idx.covering (150, out);
+
+	CPPUNIT_ASSERT_EQUAL ((size_t) 10, out.size ());
+	for (int i = 0; i < 10; ++i) {
+		CPPUNIT_ASSERT_EQUAL (i, out[i]);
+	}
+}
+
+void
+IntervalIndexTest::randomTest ()
+{
+	/* compare against a linear scan */
+	srand (42);
+
+	for (int round = 0; round < 20; ++round) {
+
+		IntervalIndex<size_t> idx;
+		vector<pair<samplepos_t, samplepos_t> > iv;
+
+		size_t const n = rand () % 500;
+
+		for (size_t i = 0; i < n; ++i) {
+			samplepos_t const first = rand () % 100000;
+			samplepos_t const last = first + (rand () % 4 ? rand () % 1000 : rand () % 50000);
+			iv.push_back (make_pair (first, last));
+			idx.add (first, last, i);
+		}
+		idx.build ();
+
+		for (int q = 0; q < 200; ++q) {
+			samplepos_t const from = rand () % 110000;
+			samplepos_t const to = from + rand () % 5000;
+
+			vector<size_t> out;
+			idx.overlapping (from, to, out);
+
+			size_t expected = 0;
+			for (size_t i = 0; i < n; ++i) {
+				if (iv[i].first <= to && iv[i].second >= from) {
+					++expected;
+				}
+			}
+
+			CPPUNIT_ASSERT_EQUAL (expected, out.size ());
+
+			for (size_t i = 0; i < out.size (); ++i) {
+				CPPUNIT_ASSERT (iv[out[i]].first <= to && iv[out[i]].second >= from);
+				if (i > 0) {
+					CPPUNIT_ASSERT (iv[out[i - 1]].first <= iv[out[i]].first);
+				}
+			}
+
+			size_t covering = 0;
+			for (size_t i = 0; i < n; ++i) {
+				if (iv[i].first <= from && iv[i].second >= from) {
+					++covering;
+				}
+			}
+			CPPUNIT_ASSERT_EQUAL (covering, idx.count_covering (from));
+		}
+	}
+}
@@ -0,0 +1,18 @@
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+
+class IntervalIndexTest : public CppUnit::TestFixture
+{
+	CPPUNIT_TEST_SUITE (IntervalIndexTest);
+	CPPUNIT_TEST (emptyTest);
+	CPPUNIT_TEST (basicTest);
+	CPPUNIT_TEST (orderTest);
+	CPPUNIT_TEST (randomTest);
+	CPPUNIT_TEST_SUITE_END ();
+
+public:
+	void emptyTest ();
+	void basicTest ();
+	void orderTest ();
+	void randomTest ();
+};
@@ -213,6 +213,35 @@ PlaylistReadTest::miscReadTest ()
 	_audio_playlist->read (_buf, _mbuf, _gbuf, 53, 54, 0);
 }
 
+/* Trim a region and then move it, after the playlist has been read (so that
+ * it has a render plan); nothing of the region may be left where it was.
+ */
+void
+PlaylistReadTest::trimMoveReadTest ()
+{
+	_audio_playlist->add_region (_ar[0], 0);
+	_ar[0]->set_default_fade_in ();
+	_ar[0]->set_default_fade_out ();
+	_ar[0]->set_length (1024);
+
+	_audio_playlist->read (_buf, _mbuf, _gbuf, 0, 1024, 0);
+
+	_ar[0]->set_length (256);
+	_ar[0]->set_position (512);
+
+	_audio_playlist->read (_buf, _mbuf, _gbuf, 0, 1024, 0);
+
+	for (int i = 0; i < 512; ++i) {
+		CPPUNIT_ASSERT_EQUAL (0, int (_buf[i]));
+	}
+
+	check_staircase (_buf + 512 + 64, 64, 128);
+
+	for (int i = 768; i < 1024; ++i) {
+		CPPUNIT_ASSERT_EQUAL (0, int (_buf[i]));
+	}
+}
+
 void
 PlaylistReadTest::check_staircase (Sample* b, int offset, int N)
 {
@@ -0,0 +1,88 @@
+#include <iostream>
+#include <cstdlib>
+
+#include <glib.h>
+
+#include "pbd/compose.h"
+#include "ardour/ardour.h"
+#include "ardour/audioengine.h"
+#include "ardour/rc_configuration.h"
+#include "ardour/session.h"
+#include "test_util.h"
+
+using namespace std;
+using namespace PBD;
+using namespace ARDOUR;
+
+static const char* localedir = LOCALEDIR;
+
+/** Run @param cycles process cycles and return the mean time per cycle, in microseconds */
+static double
+run_cycles (Session* session, int cycles)
+{
+	pframes_t const nframes = session->engine().samples_per_cycle ();
+
+	/* warm up: let the graph settle on the chosen scheduler */
+	for (int i = 0; i < 64; ++i) {
+		session->process (nframes);
+	}
+
+	gint64 const start = g_get_monotonic_time ();
+	for (int i = 0; i < cycles; ++i) {
+		session->process (nframes);
+	}
+	return (g_get_monotonic_time () - start) / (double) cycles;
+}
+
+/** Compare the locked and the work-stealing graph scheduler on a given session.
+ *
+ *  Usage: graph_scheduler <session> [cycles]
+ */
+int
+main (int argc, char* argv[])
+{
+	if (argc < 2) {
+		cerr << argv[0] << ": <session> [cycles]\n";
+		exit (EXIT_FAILURE);
+	}
+
+	int const cycles = argc > 2 ? atoi (argv[2]) : 32768;
+
+	ARDOUR::init (false, true, localedir);
+
+	/* the process graph is only used with more than one DSP thread */
+	Config->set_processor_usage (0);
+
+	Session* session = load_session (
+		string_compose ("../libs/ardour/test/profiling/sessions/%1", argv[1]),
+		string_compose ("%1.ardour", argv[1])
+		);
+
+	cout << "INFO: " << session->get_routes()->size() << " routes, "
+	     << AudioEngine::instance()->process_thread_count () << " process threads.\n";
+
+	for (int pass = 0; pass < 2; ++pass) {
+		Config->set_graph_work_stealing (false);
+		double const locked = run_cycles (session, cycles);
+
+		Config->set_graph_work_stealing (true);
+		double const ws = run_cycles (session, cycles);
+
+		cout << string_compose ("pass %1: locked %2 us/cycle, work-stealing %3 us/cycle (%4%%)\n",
+		                        pass, locked, ws, 100.0 * (locked - ws) / locked);
+
+		DSPStats::Snapshot predicted;
+		DSPStats::Snapshot actual;
+		if (session->process_graph_makespan (predicted, actual)) {
+			cout << string_compose ("pass %1: graph makespan predicted %2 us, measured %3 us (min %4, max %5)\n",
+			                        pass, predicted.avg, actual.avg, actual.min, actual.max);
+		}
+	}
+
+	AudioEngine::instance()->remove_session ();
+	delete session;
+	AudioEngine::instance()->stop ();
+	AudioEngine::destroy ();
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+#include <iostream>
+#include <cstdlib>
+
+#include <glib.h>
+#include <glibmm/miscutils.h>
+#include <boost/make_shared.hpp>
+
+#include "pbd/compose.h"
+#include "pbd/xml++.h"
+#include "ardour/ardour.h"
+#include "ardour/audioengine.h"
+#include "ardour/midi_model.h"
+#include "ardour/rc_configuration.h"
+#include "ardour/session.h"
+#include "ardour/smf_source.h"
+#include "ardour/source_factory.h"
+#include "ardour/transpose.h"
+#include "test_util.h"
+
+using namespace std;
+using namespace PBD;
+using namespace ARDOUR;
+
+static const char* localedir = LOCALEDIR;
+
+static size_t
+count_nodes (XMLNode const* node)
+{
+	size_t n = 1;
+	for (XMLNodeList::const_iterator i = node->children().begin(); i != node->children().end(); ++i) {
+		n += count_nodes (*i);
+	}
+	return n;
+}
+
+/** Save and restore @a cmd the way Session::save_history() and the undo
+ *  history loader do, with the XML or the binary form of the payload.
+ */
+static void
+save_and_restore (boost::shared_ptr<MidiModel> model, MidiModel::NoteDiffCommand* cmd, bool binary)
+{
+	Config->set_binary_midi_history (binary);
+	char const* name = binary ? "binary" : "XML";
+
+	gint64 start = g_get_monotonic_time ();
+	XMLNode& state (cmd->get_state ());
+	gint64 const get_state = g_get_monotonic_time () - start;
+
+	size_t const nodes = count_nodes (&state);
+
+	XMLTree out;
+	out.set_root (&state);
+
+	start = g_get_monotonic_time ();
+	std::string const buffer = out.write_buffer ();
+	gint64 const write = g_get_monotonic_time () - start;
+
+	XMLTree in;
+	start = g_get_monotonic_time ();
+	in.read_buffer (buffer);
+	MidiModel::NoteDiffCommand restored (model, *in.root ());
+	gint64 const restore = g_get_monotonic_time () - start;
+
+	start = g_get_monotonic_time ();
+	size_t const records = restored.changes ().size () + restored.added_notes ().size ();
+	gint64 const decode = g_get_monotonic_time () - start;
+
+	cout << string_compose ("%1: %2 records, %3 XML nodes, %4 kB; get_state %5 ms, write %6 ms, restore %7 ms, decode %8 ms\n",
+	                        name, records, nodes, buffer.size () / 1024,
+	                        get_state / 1000, write / 1000, restore / 1000, decode / 1000);
+}
+
+/** Profile saving and restoring the undo history of a large MIDI edit.
+ *
+ *  Usage: midi_history [notes]
+ */
+int
+main (int argc, char* argv[])
+{
+	int const n_notes = argc > 1 ? atoi (argv[1]) : 20000;
+
+	ARDOUR::init (false, true, localedir);
+	create_and_start_dummy_backend ();
+
+	Session* session = load_session (Glib::build_filename (new_test_output_dir (), "midi_history"), "midi_history");
+
+	boost::shared_ptr<SMFSource> source = boost::dynamic_pointer_cast<SMFSource> (
+		SourceFactory::createWritable (DataType::MIDI, *session,
+		                               Glib::build_filename (new_test_output_dir (), "midi_history.mid"),
+		                               false, get_test_sample_rate ()));
+
+	{
+		Glib::Threads::Mutex::Lock lm (source->mutex ());
+		source->load_model (lm);
+	}
+
+	boost::shared_ptr<MidiModel> model = source->model ();
+
+	MidiModel::NoteDiffCommand* add = model->new_note_diff_command ("add");
+	for (int i = 0; i < n_notes; ++i) {
+		add->add (boost::make_shared<Evoral::Note<Temporal::Beats> > (0, Temporal::Beats::ticks (i * 480), Temporal::Beats::ticks (240), 36 + i % 48, 100));
+	}
+
+	gint64 start = g_get_monotonic_time ();
+	(*add) ();
+	cout << string_compose ("INFO: %1 notes added in %2 ms\n", model->notes ().size (), (g_get_monotonic_time () - start) / 1000);
+
+	std::vector<Evoral::Sequence<Temporal::Beats>::Notes> seqs (1, model->notes ());
+	Transpose transpose (1);
+	MidiModel::NoteDiffCommand* cmd = dynamic_cast<MidiModel::NoteDiffCommand*> (transpose (model, Temporal::Beats (), seqs));
+
+	start = g_get_monotonic_time ();
+	(*cmd) ();
+	cout << string_compose ("transpose of %1 notes applied in %2 ms\n", cmd->changes ().size (), (g_get_monotonic_time () - start) / 1000);
+
+	save_and_restore (model, add, false);
+	save_and_restore (model, add, true);
+	save_and_restore (model, cmd, false);
+	save_and_restore (model, cmd, true);
+
+	delete cmd;
+	delete add;
+	model.reset ();
+	source.reset ();
+
+	AudioEngine::instance()->remove_session ();
+	delete session;
+	stop_and_destroy_backend ();
+
+	return 0;
+}
@@ -0,0 +1,125 @@
+#include <iostream>
+#include <cstdlib>
+
+#include <glib.h>
+#include <glibmm/miscutils.h>
+
+#include "pbd/compose.h"
+#include "ardour/ardour.h"
+#include "ardour/audioengine.h"
+#include "ardour/audioplaylist.h"
+#include "ardour/audioregion.h"
+#include "ardour/playlist_factory.h"
+#include "ardour/region_factory.h"
+#include "ardour/session.h"
+#include "ardour/sndfilesource.h"
+#include "ardour/source_factory.h"
+#include "test_util.h"
+
+using namespace std;
+using namespace PBD;
+using namespace ARDOUR;
+
+static const char* localedir = LOCALEDIR;
+
+/** Read the whole playlist in butler-sized chunks, @return mean time per read in microseconds */
+static double
+read_all (boost::shared_ptr<AudioPlaylist> playlist, samplecnt_t chunk)
+{
+	Sample* buf = new Sample[chunk];
+	Sample* mbuf = new Sample[chunk];
+	float* gbuf = new float[chunk];
+
+	samplepos_t const end = playlist->get_extent().second;
+	int reads = 0;
+
+	gint64 const start = g_get_monotonic_time ();
+	for (samplepos_t pos = 0; pos < end; pos += chunk) {
+		playlist->read (buf, mbuf, gbuf, pos, chunk, 0);
+		++reads;
+	}
+	gint64 const elapsed = g_get_monotonic_time () - start;
+
+	delete [] buf;
+	delete [] mbuf;
+	delete [] gbuf;
+
+	return reads ? elapsed / (double) reads : 0;
+}
+
+/** Profile AudioPlaylist::read on a playlist with many layered regions,
+ *  like one that results from comping (see also test/playlist_read_test.cc).
+ *
+ *  Usage: playlist_read [regions] [chunk]
+ */
+int
+main (int argc, char* argv[])
+{
+	int const n_regions = argc > 1 ? atoi (argv[1]) : 20000;
+	samplecnt_t const chunk = argc > 2 ? atoi (argv[2]) : 65536;
+
+	ARDOUR::init (false, true, localedir);
+	create_and_start_dummy_backend ();
+
+	Session* session = load_session (Glib::build_filename (new_test_output_dir (), "playlist_read"), "playlist_read");
+
+	boost::shared_ptr<AudioPlaylist> playlist = boost::dynamic_pointer_cast<AudioPlaylist> (PlaylistFactory::create (DataType::AUDIO, *session, "read"));
+	boost::shared_ptr<Source> source = SourceFactory::createWritable (DataType::AUDIO, *session,
+	                                                                  Glib::build_filename (new_test_output_dir (), "playlist_read.wav"),
+	                                                                  false, get_test_sample_rate ());
+
+	int const signal_length = 65536;
+	Sample* staircase = new Sample[signal_length];
+	for (int i = 0; i < signal_length; ++i) {
+		staircase[i] = i;
+	}
+	boost::dynamic_pointer_cast<SndFileSource> (source)->write (staircase, signal_length);
+	delete [] staircase;
+
+	/* takes of 4096 samples, every 2048 samples, three takes deep */
+	srand (42);
+
+	gint64 start = g_get_monotonic_time ();
+
+	playlist->freeze ();
+	for (int i = 0; i < n_regions; ++i) {
+		PropertyList plist;
+		plist.add (Properties::start, rand () % (signal_length - 4096));
+		plist.add (Properties::length, 4096);
+		boost::shared_ptr<AudioRegion> r = boost::dynamic_pointer_cast<AudioRegion> (RegionFactory::create (source, plist));
+		r->set_default_fade_in ();
+		r->set_default_fade_out ();
+		playlist->add_region (r, (i / 3) * 2048 + rand () % 256);
+	}
+	playlist->thaw ();
+
+	cout << string_compose ("INFO: %1 regions, %2 layers, added in %3 ms\n",
+	                        playlist->n_regions (), playlist->top_layer () + 1, (g_get_monotonic_time () - start) / 1000);
+
+	start = g_get_monotonic_time ();
+	size_t const segments = playlist->render_plan_size ();
+	cout << string_compose ("render plan: %1 segments, built in %2 ms\n", segments, (g_get_monotonic_time () - start) / 1000);
+
+	for (int pass = 0; pass < 3; ++pass) {
+		cout << string_compose ("pass %1: %2 us per read of %3 samples\n", pass, read_all (playlist, chunk), chunk);
+	}
+
+	/* move one region, which only requires the plan to be updated around it */
+	boost::shared_ptr<Region> r = playlist->region_list_property ().rlist ().front ();
+	r->set_position (r->position () + 1024);
+
+	start = g_get_monotonic_time ();
+	playlist->render_plan_size ();
+	cout << string_compose ("render plan updated after a move in %1 us\n", g_get_monotonic_time () - start);
+
+	cout << string_compose ("after move: %1 us per read of %2 samples\n", read_all (playlist, chunk), chunk);
+
+	playlist.reset ();
+	source.reset ();
+
+	AudioEngine::instance()->remove_session ();
+	delete session;
+	stop_and_destroy_backend ();
+
+	return 0;
+}
@@ -1,3 +1,7 @@
+#include <iostream>
+
+#include <glib.h>
+
 #include "ardour/tempo.h"
 #include "tempo_test.h"
 
@@ -635,3 +639,149 @@ TempoTest::tempoFundamentalsTest ()
 	CPPUNIT_ASSERT_DOUBLES_EQUAL (164.0, tE->quarter_notes_per_minute (), 1e-17);
 	CPPUNIT_ASSERT_DOUBLES_EQUAL (41.0, tE->pulses_per_minute (), 1e-17);
 }
+
+struct LargeMapResults {
+	vector<double> beats;
+	vector<double> qns;
+	vector<BBT_Time> bbts;
+	vector<samplepos_t> samples;
+	vector<double> tempi;
+	vector<uint32_t> divisions;
+};
+
+static gint64
+large_map_lookups (TempoMap& map, vector<samplepos_t> const& positions, LargeMapResults& r)
+{
+	gint64 const start = g_get_monotonic_time ();
+
+	for (vector<samplepos_t>::const_iterator p = positions.begin(); p != positions.end(); ++p) {
+		const double beat = map.beat_at_sample (*p);
+		const BBT_Time bbt = map.bbt_at_sample (*p);
+		const TempoMetric metric = map.metric_at (*p);
+
+		r.beats.push_back (beat);
+		r.qns.push_back (map.quarter_note_at_sample (*p));
+		r.bbts.push_back (bbt);
+		r.samples.push_back (map.sample_at_beat (beat));
+		r.samples.push_back (map.sample_at_bbt (bbt));
+		r.tempi.push_back (map.tempo_at_sample (*p).note_types_per_minute());
+		r.tempi.push_back (metric.tempo().note_types_per_minute());
+		r.divisions.push_back (metric.meter().divisions_per_bar());
+	}
+
+	return g_get_monotonic_time () - start;
+}
+
+/* a film-score sized map: the indexed lookups must give exactly the same
+   answers as the linear ones, just faster.
+*/
+void
+TempoTest::largeMapTest ()
+{
+	int const sampling_rate = 48000;
+	int const n_tempos = 4000;
+	int const n_positions = 20000;
+
+	TempoMap map (sampling_rate);
+	map.replace_meter (map.first_meter(), Meter (4, 4), BBT_Time (1, 1, 0), 0, AudioTime);
+	map.replace_tempo (map.first_tempo(), Tempo (120.0, 4.0), 0.0, 0, AudioTime);
+
+	gint64 start = g_get_monotonic_time ();
+
+	for (int n = 1; n <= n_tempos; ++n) {
+		map.add_tempo (Tempo (90.0 + (n % 61), 4.0), n * 0.25, 0, MusicTime);
+	}
+	/* alternate 7/8 and 4/4 every 16 bars */
+	for (uint32_t bar = 17; bar < n_tempos / 4; bar += 16) {
+		map.add_meter (Meter ((bar / 16) % 2 ? 7 : 4, (bar / 16) % 2 ? 8 : 4), BBT_Time (bar, 1, 0), 0, MusicTime);
+	}
+
+	cout << endl << "TempoTest: " << map._metrics.size() << " sections added in "
+	     << (g_get_monotonic_time () - start) / 1000 << " ms" << endl;
+
+	CPPUNIT_ASSERT (map._index.valid);
+	CPPUNIT_ASSERT_EQUAL (size_t (n_tempos + 1), map._index.tempos.size());
+
+	const samplepos_t end = map.sample_at_quarter_note (n_tempos * 1.05);
+	vector<samplepos_t> positions;
+	for (int n = 0; n < n_positions; ++n) {
+		positions.push_back ((end / n_positions) * n);
+	}
+
+	LargeMapResults indexed;
+	const gint64 indexed_us = large_map_lookups (map, positions, indexed);
+
+	map.invalidate_index ();
+
+	LargeMapResults linear;
+	const gint64 linear_us = large_map_lookups (map, positions, linear);
+
+	map.rebuild_index ();
+
+	cout << "TempoTest: " << n_positions << " positions looked up in " << indexed_us / 1000 << " ms (indexed), "
+	     << linear_us / 1000 << " ms (linear)" << endl;
+
+	for (size_t n = 0; n < positions.size(); ++n) {
+		CPPUNIT_ASSERT_EQUAL (linear.beats[n], indexed.beats[n]);
+		CPPUNIT_ASSERT_EQUAL (linear.qns[n], indexed.qns[n]);
+		CPPUNIT_ASSERT (linear.bbts[n] == indexed.bbts[n]);
+		CPPUNIT_ASSERT_EQUAL (linear.divisions[n], indexed.divisions[n]);
+	}
+	CPPUNIT_ASSERT (linear.samples == indexed.samples);
+	CPPUNIT_ASSERT (linear.tempi == indexed.tempi);
+
+	/* and the round trip holds all the way through the map */
+	for (size_t n = 0; n < positions.size(); ++n) {
+		const samplecnt_t error = indexed.samples[2 * n] - positions[n];
+		CPPUNIT_ASSERT (error >= -1 && error <= 1);
+	}
+}
+
+void
+TempoTest::rtSnapshotTest ()
+{
+	int const sampling_rate = 48000;
+
+	TempoMap map (sampling_rate);
+	map.replace_meter (map.first_meter(), Meter (4, 4), BBT_Time (1, 1, 0), 0, AudioTime);
+	map.replace_tempo (map.first_tempo(), Tempo (120.0, 4.0, 150.0), 0.0, 0, AudioTime);
+	map.add_tempo (Tempo (150.0, 4.0), 4.0, 0, MusicTime);
+	map.add_tempo (Tempo (90.0, 8.0), 0, 1920000, AudioTime);
+	map.add_meter (Meter (7, 8), BBT_Time (6, 1, 0), 0, MusicTime);
+
+	for (samplepos_t pos = 0; pos < 4800000; pos += 12345) {
+		CPPUNIT_ASSERT (map.bbt_at_sample (pos) == map.bbt_at_sample_rt (pos));
+		CPPUNIT_ASSERT_EQUAL (map.quarter_note_at_sample (pos), map.quarter_note_at_sample_rt (pos));
+		CPPUNIT_ASSERT_EQUAL (map.meter_at_sample (pos).divisions_per_bar(), map.meter_at_sample_rt (pos).divisions_per_bar());
+	}
+
+	for (uint32_t bar = 1; bar < 20; ++bar) {
+		const BBT_Time bbt (bar, 2, 960);
+		CPPUNIT_ASSERT_EQUAL (map.quarter_note_at_bbt (bbt), map.quarter_note_at_bbt_rt (bbt));
+	}
+
+	/* the grid of the snapshot is looked up in the snapshot's own index */
+	CPPUNIT_ASSERT (map._snapshot.reader ()->index ());
+
+	vector<TempoMap::BBTPoint> grid;
+	vector<TempoMap::BBTPoint> grid_rt;
+	map.get_grid (grid, 0, 4800000);
+	map.get_grid_rt (grid_rt, 0, 4800000);
+
+	CPPUNIT_ASSERT_EQUAL (grid.size (), grid_rt.size ());
+	for (size_t n = 0; n < grid.size (); ++n) {
+		CPPUNIT_ASSERT_EQUAL (grid[n].sample, grid_rt[n].sample);
+		CPPUNIT_ASSERT (grid[n].bbt () == grid_rt[n].bbt ());
+		CPPUNIT_ASSERT_EQUAL (grid[n].qn, grid_rt[n].qn);
+	}
+
+	/* a reader keeps its snapshot while the map changes underneath */
+	boost::shared_ptr<TempoMap::Snapshot> old (map._snapshot.reader ());
+	const double qn = map.quarter_note_at_sample_rt (2400000);
+
+	map.add_tempo (Tempo (60.0, 4.0), 2.0, 0, MusicTime);
+
+	CPPUNIT_ASSERT (map.quarter_note_at_sample_rt (2400000) < qn);
+	CPPUNIT_ASSERT_EQUAL (map.quarter_note_at_sample (2400000), map.quarter_note_at_sample_rt (2400000));
+	CPPUNIT_ASSERT_EQUAL (qn, old->pulse_at_minute (old->minute_at_sample (2400000)) * 4.0);
+}
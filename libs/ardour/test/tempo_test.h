@@ -13,6 +13,8 @@ class TempoTest : public CppUnit::TestFixture
 	CPPUNIT_TEST (rampTest44);
 	CPPUNIT_TEST (tempoAtPulseTest);
 	CPPUNIT_TEST (tempoFundamentalsTest);
+	CPPUNIT_TEST (largeMapTest);
+	CPPUNIT_TEST (rtSnapshotTest);
 	CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -28,5 +30,7 @@ public:
 	void rampTest44 ();
 	void tempoAtPulseTest();
 	void tempoFundamentalsTest();
+	void largeMapTest ();
+	void rtSnapshotTest ();
 };
 
@@ -481,6 +481,12 @@ Track::do_refill ()
 	return _disk_reader->do_refill ();
 }
 
+bool
+Track::update_locate_prefetch (std::vector<samplepos_t> const& points)
+{
+	return _disk_reader->update_locate_prefetch (points);
+}
+
 int
 Track::do_flush (RunContext c, bool force)
 {
@@ -516,15 +522,33 @@ Track::internal_playback_seek (samplecnt_t p)
 
 void
 Track::non_realtime_locate (samplepos_t p)
+{
+	non_realtime_locate_processors (p);
+	non_realtime_locate_disk_reader (p);
+}
+
+/** Locate everything but the disk reader */
+void
+Track::non_realtime_locate_processors (samplepos_t p)
 {
 	Route::non_realtime_locate (p);
 
+	if (!is_private_route()) {
+		_disk_writer->non_realtime_locate (p);
+	}
+}
+
+/** Locate the disk reader, which refills its buffers. This can run
+ *  concurrently with the disk reader locates of other tracks.
+ */
+void
+Track::non_realtime_locate_disk_reader (samplepos_t p)
+{
 	if (!is_private_route()) {
 		/* don't waste i/o cycles and butler calls
 		   for private tracks (e.g.auditioner)
 		*/
 		_disk_reader->non_realtime_locate (p);
-		_disk_writer->non_realtime_locate (p);
 	}
 }
 
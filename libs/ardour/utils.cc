@@ -628,6 +628,8 @@ ARDOUR::native_header_format_extension (HeaderFormat hf, const DataType& type)
         case RF64_WAV:
         case MBWF:
                 return ".rf64";
+        case FLAC:
+                return ".flac";
         }
 
         fatal << string_compose (_("programming error: unknown native header format: %1"), hf);
@@ -635,6 +637,17 @@ ARDOUR::native_header_format_extension (HeaderFormat hf, const DataType& type)
         return ".wav";
 }
 
+/** @return the format that a new file of format @a hf is actually written in */
+HeaderFormat
+ARDOUR::writable_header_format (HeaderFormat hf, bool destructive)
+{
+	if (hf == FLAC && destructive) {
+		/* FLAC can only be written from start to end */
+		return WAVE;
+	}
+	return hf;
+}
+
 bool
 ARDOUR::matching_unsuffixed_filename_exists_in (const string& dir, const string& path)
 {
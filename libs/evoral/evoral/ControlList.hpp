@@ -21,6 +21,7 @@
 
 #include <cassert>
 #include <list>
+#include <vector>
 #include <stdint.h>
 
 #include <boost/pool/pool.hpp>
@@ -207,6 +208,7 @@ public:
 	 * @returns parameter value
 	 */
 	double eval (double where) const {
+		rebuild_index_if_necessary ();
 		Glib::Threads::RWLock::ReaderLock lm (_lock);
 		return unlocked_eval (where);
 	}
@@ -245,6 +247,10 @@ public:
 		ControlList::const_iterator first;
 	};
 
+	/** Code that changes events through iterators or events() has to call
+	 *  mark_dirty() afterwards, which (among other things) stops evaluation
+	 *  from using the contiguous index of the events.
+	 */
 	const EventList& events() const { return _events; }
 
 	// FIXME: const violations for Curve
@@ -272,6 +278,12 @@ public:
 
 	void mark_dirty () const;
 
+	/** Rebuild the contiguous index of the events if it is stale.
+	 *  Not RT safe; meant for the threads that edit or locate, so that the
+	 *  process thread finds it ready.
+	 */
+	void rebuild_index_if_necessary () const;
+
 	enum InterpolationStyle {
 		Discrete,
 		Linear,
@@ -301,7 +313,11 @@ public:
 	virtual bool touching() const { return false; }
 	virtual bool writing() const { return false; }
 	virtual bool touch_enabled() const { return false; }
-	void start_write_pass (double when);
+	/** @param thinning_factor if non-zero, points written during the pass
+	 *  are thinned as they are added (see thin()), rather than only once
+	 *  the pass is finished.
+	 */
+	void start_write_pass (double when, double thinning_factor=0.0);
 	void write_pass_finished (double when, double thinning_factor=0.0);
 	void set_in_write_pass (bool, bool add_point = false, double when = 0.0);
 	bool in_write_pass () const;
@@ -338,6 +354,32 @@ protected:
 	mutable LookupCache   _lookup_cache;
 	mutable SearchCache   _search_cache;
 
+	/** Contiguous copy of the times and values of _events, for binary search
+	 *  in the evaluation paths. Edits make it stale by bumping
+	 *  _events_generation (see mark_dirty()). It is rebuilt outside the
+	 *  process thread, by copying _events under the reader lock, and then
+	 *  replaced under the writer lock, so that a reader sees either the old
+	 *  or the new one (see rebuild_index_if_necessary()). It is not rebuilt
+	 *  while a write pass is adding points. While it is stale, evaluation
+	 *  walks _events using the caches above.
+	 *
+	 *  _events itself stays a list, since iterators to its points have to
+	 *  stay valid across edits.
+	 */
+	struct Index {
+		Index (gint g) : generation (g) {}
+		gint                generation; ///< of the events it was built from
+		std::vector<double> when;
+		std::vector<double> value;
+	};
+
+	mutable boost::shared_ptr<Index const> _index; ///< only replaced under the writer lock
+	mutable gint                           _events_generation; ///< atomic
+
+	Index const* unlocked_index () const;
+	boost::shared_ptr<Index const> unlocked_build_index () const;
+	bool unlocked_index_rebuild_wanted () const;
+
 	mutable Glib::Threads::RWLock _lock;
 
 	Parameter             _parameter;
@@ -356,8 +398,13 @@ private:
 	bool       new_write_pass;
 	bool       did_write_during_pass;
 	bool       _in_write_pass;
+	double     _write_pass_thinning_factor;
+	uint32_t   _write_pass_points; ///< points written in a row, up to most_recent_insert_iterator
+	/** points removed by unlocked_thin_written() since the last one it kept */
+	std::vector<std::pair<double, double> > _write_pass_dropped;
 
 	void unlocked_remove_duplicates ();
+	void unlocked_thin_written (iterator);
 	void unlocked_invalidate_insert_iterator ();
 	void add_guard_point (double when, double offset);
 
@@ -41,9 +41,9 @@ public:
 	void mark_dirty() const { _dirty = true; }
 
 private:
-	double multipoint_eval (double x) const;
+	double multipoint_eval (double x, bool curved) const;
 
-	void _get_vector (double x0, double x1, float *arg, int32_t veclen) const;
+	void _get_vector (double x0, double x1, float *arg, int32_t veclen, bool may_solve) const;
 
 	mutable bool       _dirty;
 	const ControlList& _list;
@@ -119,16 +119,25 @@ public:
 		return a->time() < b->time();
 	}
 
+	/* The comparators take their arguments by reference, in the exact type
+	 * that the containers hold, so that comparing two notes does not have to
+	 * create (and atomically reference count) temporary shared_ptrs.
+	 */
+
 	struct NoteNumberComparator {
-		inline bool operator()(const boost::shared_ptr< const Note<Time> > a,
-		                       const boost::shared_ptr< const Note<Time> > b) const {
+		inline bool operator()(const NotePtr& a, const NotePtr& b) const {
+			return a->note() < b->note();
+		}
+		inline bool operator()(const constNotePtr& a, const constNotePtr& b) const {
 			return a->note() < b->note();
 		}
 	};
 
 	struct EarlierNoteComparator {
-		inline bool operator()(const boost::shared_ptr< const Note<Time> > a,
-		                       const boost::shared_ptr< const Note<Time> > b) const {
+		inline bool operator()(const NotePtr& a, const NotePtr& b) const {
+			return a->time() < b->time();
+		}
+		inline bool operator()(const constNotePtr& a, const constNotePtr& b) const {
 			return a->time() < b->time();
 		}
 	};
@@ -145,8 +154,7 @@ public:
 
 	struct LaterNoteEndComparator {
 		typedef const Note<Time>* value_type;
-		inline bool operator()(const boost::shared_ptr< const Note<Time> > a,
-		                       const boost::shared_ptr< const Note<Time> > b) const {
+		inline bool operator()(const NotePtr& a, const NotePtr& b) const {
 			return a->end_time().to_double() > b->end_time().to_double();
 		}
 	};
@@ -190,7 +198,10 @@ public:
 	typedef boost::shared_ptr<const Event<Time> > constSysExPtr;
 
 	struct EarlierSysExComparator {
-		inline bool operator() (constSysExPtr a, constSysExPtr b) const {
+		inline bool operator() (const SysExPtr& a, const SysExPtr& b) const {
+			return a->time() < b->time();
+		}
+		inline bool operator() (const constSysExPtr& a, const constSysExPtr& b) const {
 			return a->time() < b->time();
 		}
 	};
@@ -203,7 +214,10 @@ public:
 	typedef boost::shared_ptr<const PatchChange<Time> > constPatchChangePtr;
 
 	struct EarlierPatchChangeComparator {
-		inline bool operator() (constPatchChangePtr a, constPatchChangePtr b) const {
+		inline bool operator() (const PatchChangePtr& a, const PatchChangePtr& b) const {
+			return a->time() < b->time();
+		}
+		inline bool operator() (const constPatchChangePtr& a, const constPatchChangePtr& b) const {
 			return a->time() < b->time();
 		}
 	};
@@ -302,6 +316,16 @@ public:
 	bool add_note_unlocked (const NotePtr note, void* arg = 0);
 	void remove_note_unlocked(const constNotePtr note);
 
+	/** Remove all of @a notes at once: one pass over the note indexes,
+	 *  instead of a search (and maybe a rescan of the note range) per note.
+	 *  Small sets of notes are still removed one by one.
+	 *  Notes are matched by identity; the ID of a note is only used for
+	 *  notes that are not in the model themselves (like notes rebuilt from
+	 *  the undo history), for one model note per ID.
+	 *  @return number of notes removed
+	 */
+	size_t remove_notes_unlocked (const std::set<NotePtr>& notes);
+
 	void add_patch_change_unlocked (const PatchChangePtr);
 	void remove_patch_change_unlocked (const constPatchChangePtr);
 
@@ -323,7 +347,7 @@ protected:
 		return 0;
 	}
 
-	typedef std::multiset<NotePtr, NoteNumberComparator>  Pitches;
+	typedef std::multiset<NotePtr, NoteNumberComparator> Pitches;
 	inline       Pitches& pitches(uint8_t chan)       { return _pitches[chan&0xf]; }
 	inline const Pitches& pitches(uint8_t chan) const { return _pitches[chan&0xf]; }
 
@@ -68,6 +68,9 @@ ControlList::ControlList (const Parameter& id, const ParameterDescriptor& desc)
 	_search_cache.left = -1;
 	_search_cache.first = _events.end();
 	_sort_pending = false;
+	_events_generation = 0;
+	_write_pass_thinning_factor = 0.0;
+	_write_pass_points = 0;
 	new_write_pass = true;
 	_in_write_pass = false;
 	did_write_during_pass = false;
@@ -87,6 +90,9 @@ ControlList::ControlList (const ControlList& other)
 	_lookup_cache.range.second = _events.end();
 	_search_cache.first = _events.end();
 	_sort_pending = false;
+	_events_generation = 0;
+	_write_pass_thinning_factor = 0.0;
+	_write_pass_points = 0;
 	new_write_pass = true;
 	_in_write_pass = false;
 	did_write_during_pass = false;
@@ -109,6 +115,9 @@ ControlList::ControlList (const ControlList& other, double start, double end)
 	_lookup_cache.range.second = _events.end();
 	_search_cache.first = _events.end();
 	_sort_pending = false;
+	_events_generation = 0;
+	_write_pass_thinning_factor = 0.0;
+	_write_pass_points = 0;
 
 	/* now grab the relevant points, and shift them back if necessary */
 
@@ -225,6 +234,8 @@ ControlList::maybe_signal_changed ()
 
 	if (_frozen) {
 		_changed_when_thawed = true;
+	} else {
+		rebuild_index_if_necessary ();
 	}
 }
 
@@ -339,6 +350,47 @@ struct ControlEventTimeComparator {
 	}
 };
 
+/** @return twice the area of the triangle formed by 3 points */
+static inline double
+thinning_area (double aw, double av, double bw, double bv, double cw, double cv)
+{
+	return fabs ((aw * (bv - cv)) +
+	             (bw * (cv - av)) +
+	             (cw * (av - bv)));
+}
+
+/** @return true if @a b can be removed from between @a a and @a c, that is if
+ *  neither @a b nor any of the points already removed between @a a and @a b
+ *  (@a dropped) is further than the thinning factor allows from the line
+ *  from @a a to @a c. Testing only @a b would let the error grow with every
+ *  point removed along a gentle curve.
+ *
+ *  After max_thinned_run points in a row, @a b is kept regardless, so that
+ *  a long straight ramp costs at most that many tests per point.
+ */
+static bool
+thinnable (const ControlEvent* a, const ControlEvent* b, const ControlEvent* c,
+           std::vector<std::pair<double, double> > const& dropped, double thinning_factor)
+{
+	static const size_t max_thinned_run = 64;
+
+	if (dropped.size() >= max_thinned_run) {
+		return false;
+	}
+
+	if (thinning_area (a->when, a->value, b->when, b->value, c->when, c->value) >= thinning_factor) {
+		return false;
+	}
+
+	for (std::vector<std::pair<double, double> >::const_iterator d = dropped.begin(); d != dropped.end(); ++d) {
+		if (thinning_area (a->when, a->value, d->first, d->second, c->when, c->value) >= thinning_factor) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 void
 ControlList::thin (double thinning_factor)
 {
@@ -358,6 +410,7 @@ ControlList::thin (double thinning_factor)
 		ControlEvent* prev = 0;
 		iterator pprev;
 		int counter = 0;
+		std::vector<std::pair<double, double> > dropped; // since prevprev
 
 		DEBUG_TRACE (DEBUG::ControlList, string_compose ("@%1 thin from %2 events\n", this, _events.size()));
 
@@ -368,14 +421,7 @@ ControlList::thin (double thinning_factor)
 
 			if (counter > 2) {
 
-				/* compute the area of the triangle formed by 3 points
-				 */
-
-				double area = fabs ((prevprev->when * (prev->value - cur->value)) +
-						    (prev->when * (cur->value - prevprev->value)) +
-						    (cur->when * (prevprev->value - prev->value)));
-
-				if (area < thinning_factor) {
+				if (thinnable (prevprev, prev, cur, dropped, thinning_factor)) {
 					iterator tmp = pprev;
 
 					/* pprev will change to current
@@ -384,12 +430,15 @@ ControlList::thin (double thinning_factor)
 					*/
 
 					pprev = i;
+					dropped.push_back (std::make_pair (prev->when, prev->value));
 					_events.erase (tmp);
+					prev = cur;
 					changed = true;
 					continue;
 				}
 			}
 
+			dropped.clear ();
 			prevprev = prev;
 			prev = cur;
 			pprev = i;
@@ -432,6 +481,43 @@ void
 ControlList::unlocked_invalidate_insert_iterator ()
 {
 	most_recent_insert_iterator = _events.end();
+	_write_pass_points = 0;
+}
+
+/** Called with the writer lock held, after @a written has been added
+ *  during a write pass. Applies the test of thin() to the point before it,
+ *  so that a long pass only keeps the points needed to describe its curve.
+ *  Only points written by the pass itself are ever removed, and the
+ *  first and the most recent one are always kept.
+ */
+void
+ControlList::unlocked_thin_written (iterator written)
+{
+	++_write_pass_points;
+
+	if (_write_pass_points == 1) {
+		/* a new run of points, nothing removed from it yet */
+		_write_pass_dropped.clear ();
+	}
+
+	if (_write_pass_points < 3 || _write_pass_thinning_factor == 0.0 || _desc.toggled) {
+		return;
+	}
+
+	iterator prev = written;
+	--prev;
+	iterator prevprev = prev;
+	--prevprev;
+
+	if (thinnable (*prevprev, *prev, *written, _write_pass_dropped, _write_pass_thinning_factor)) {
+		_write_pass_dropped.push_back (std::make_pair ((*prev)->when, (*prev)->value));
+		delete *prev;
+		_events.erase (prev);
+		--_write_pass_points;
+	} else {
+		/* prev stays, and is where the next line starts */
+		_write_pass_dropped.clear ();
+	}
 }
 
 void
@@ -453,13 +539,14 @@ ControlList::unlocked_remove_duplicates ()
 }
 
 void
-ControlList::start_write_pass (double when)
+ControlList::start_write_pass (double when, double thinning_factor)
 {
 	Glib::Threads::RWLock::WriterLock lm (_lock);
 
 	DEBUG_TRACE (DEBUG::ControlList, string_compose ("%1: setup write pass @ %2\n", this, when));
 
 	insert_position = when;
+	_write_pass_thinning_factor = thinning_factor;
 
 	/* leave the insert iterator invalid, so that we will do the lookup
 	   of where it should be in a "lazy" way - deferring it until
@@ -518,6 +605,9 @@ ControlList::add_guard_point (double when, double offset)
 	}
 	assert (offset <= 0);
 
+	/* whatever comes next does not follow points of this pass */
+	_write_pass_points = 0;
+
 	if (offset != 0) {
 		/* check if there are points between when + offset .. when */
 		ControlEvent cp (when + offset, 0.0);
@@ -759,6 +849,7 @@ ControlList::add (double when, double value, bool with_guards, bool with_initial
 				/* not adding a guard, but we need to set iterator appropriately */
 				const ControlEvent cp (when, 0.0);
 				most_recent_insert_iterator = lower_bound (_events.begin(), _events.end(), &cp, time_comparator);
+				_write_pass_points = 0;
 			}
 			WritePassStarted (); /* EMIT SIGNAL w/WriteLock */
 			new_write_pass = false;
@@ -803,6 +894,10 @@ ControlList::add (double when, double value, bool with_guards, bool with_initial
 			most_recent_insert_iterator = _events.end();
 			--most_recent_insert_iterator;
 
+			if (!done && _in_write_pass) {
+				unlocked_thin_written (most_recent_insert_iterator);
+			}
+
 		} else if ((*most_recent_insert_iterator)->when == when) {
 
 			if ((*most_recent_insert_iterator)->value != value) {
@@ -863,6 +958,10 @@ ControlList::add (double when, double value, bool with_guards, bool with_initial
 				EventList::iterator x = _events.insert (most_recent_insert_iterator, new ControlEvent (when, value));
 				DEBUG_TRACE (DEBUG::ControlList, string_compose ("@%1 inserted new value before MRI, size now %2\n", this, _events.size()));
 				most_recent_insert_iterator = x;
+
+				if (_in_write_pass) {
+					unlocked_thin_written (most_recent_insert_iterator);
+				}
 			}
 		}
 
@@ -1094,6 +1193,8 @@ ControlList::thaw ()
 			unlocked_invalidate_insert_iterator ();
 			_sort_pending = false;
 		}
+
+		_index = unlocked_build_index ();
 	}
 }
 
@@ -1105,6 +1206,7 @@ ControlList::mark_dirty () const
 	_lookup_cache.range.second = _events.end();
 	_search_cache.left = -1;
 	_search_cache.first = _events.end();
+	g_atomic_int_inc (&_events_generation);
 
 	if (_curve) {
 		_curve->mark_dirty();
@@ -1113,6 +1215,69 @@ ControlList::mark_dirty () const
 	Dirty (); /* EMIT SIGNAL */
 }
 
+/** Caller must hold the reader or the writer lock, and _events must be sorted. */
+boost::shared_ptr<ControlList::Index const>
+ControlList::unlocked_build_index () const
+{
+	boost::shared_ptr<Index> index (new Index (g_atomic_int_get (&_events_generation)));
+
+	index->when.reserve (_events.size());
+	index->value.reserve (_events.size());
+
+	for (const_iterator i = _events.begin(); i != _events.end(); ++i) {
+		index->when.push_back ((*i)->when);
+		index->value.push_back ((*i)->value);
+	}
+
+	return index;
+}
+
+/** Caller must hold the reader or the writer lock.
+ *  @return the index, or 0 if it is stale.
+ */
+ControlList::Index const*
+ControlList::unlocked_index () const
+{
+	if (_index && _index->generation == g_atomic_int_get (&_events_generation)) {
+		return _index.get();
+	}
+	return 0;
+}
+
+/** Caller must hold the reader or the writer lock.
+ *  @return true if the index is stale and can be rebuilt: not while a write
+ *  pass is adding points, since every point added would make it stale again.
+ */
+bool
+ControlList::unlocked_index_rebuild_wanted () const
+{
+	return !unlocked_index () && !_frozen && !_sort_pending && !(_in_write_pass && !new_write_pass);
+}
+
+void
+ControlList::rebuild_index_if_necessary () const
+{
+	boost::shared_ptr<Index const> index;
+
+	{
+		Glib::Threads::RWLock::ReaderLock lm (_lock);
+
+		if (!unlocked_index_rebuild_wanted ()) {
+			return;
+		}
+
+		index = unlocked_build_index ();
+	}
+
+	Glib::Threads::RWLock::WriterLock lm (_lock);
+
+	/* an edit, or another rebuild, may have come in meanwhile */
+	if (index->generation == g_atomic_int_get (&_events_generation) && unlocked_index_rebuild_wanted ()) {
+		/* the old index is freed once the lock is released */
+		_index.swap (index);
+	}
+}
+
 void
 ControlList::truncate_end (double last_coordinate)
 {
@@ -1389,6 +1554,47 @@ ControlList::multipoint_eval (double x) const
 	double uval, lval;
 	double fraction;
 
+	Index const* const index = unlocked_index ();
+
+	if (index) {
+
+		/* binary search in the contiguous index, no cache needed */
+
+		const size_t n = index->when.size();
+		const size_t u = lower_bound (index->when.begin(), index->when.end(), x) - index->when.begin();
+
+		if (u == n) {
+			/* we're after the last point */
+			return index->value[n - 1];
+		}
+
+		if (u == 0 || index->when[u] == x) {
+			/* x is a control point in the data, or we're before the first point */
+			return index->value[u];
+		}
+
+		lpos = index->when[u - 1];
+		lval = index->value[u - 1];
+		upos = index->when[u];
+		uval = index->value[u];
+
+		fraction = (double) (x - lpos) / (double) (upos - lpos);
+
+		switch (_interpolation) {
+			case Discrete:
+				return lval;
+			case Logarithmic:
+				return interpolate_logarithmic (lval, uval, fraction, _desc.lower, _desc.upper);
+			case Exponential:
+				return interpolate_gain (lval, uval, fraction, _desc.upper);
+			case Curved:
+				/* only used x-fade curves, never direct eval */
+				assert (0);
+			default: // Linear
+				return interpolate_linear (lval, uval, fraction);
+		}
+	}
+
 	/* "Stepped" lookup (no interpolation) */
 	/* FIXME: no cache.  significant? */
 	if (_interpolation == Discrete) {
@@ -1541,6 +1747,23 @@ ControlList::rt_safe_earliest_event_unlocked (double start, double& x, double& y
 bool
 ControlList::rt_safe_earliest_event_discrete_unlocked (double start, double& x, double& y, bool inclusive) const
 {
+	Index const* const index = unlocked_index ();
+
+	if (index) {
+		vector<double>::const_iterator const i = inclusive
+			? lower_bound (index->when.begin(), index->when.end(), start)
+			: upper_bound (index->when.begin(), index->when.end(), start);
+
+		if (i == index->when.end()) {
+			/* No points in range */
+			return false;
+		}
+
+		x = *i;
+		y = index->value[i - index->when.begin()];
+		return true;
+	}
+
 	build_search_cache_if_necessary (start);
 
 	if (_search_cache.first != _events.end()) {
@@ -1591,13 +1814,54 @@ ControlList::rt_safe_earliest_event_linear_unlocked (double start, double& x, do
 		return rt_safe_earliest_event_discrete_unlocked (start, x, y, inclusive);
 	}
 
-	// Hack to avoid infinitely repeating the same event
-	build_search_cache_if_necessary (start);
+	const ControlEvent* first = NULL;
+	const ControlEvent* next = NULL;
 
-	if (_search_cache.first != _events.end()) {
+	/* copies of the points from the index */
+	ControlEvent indexed_first (0, 0);
+	ControlEvent indexed_next (0, 0);
+
+	Index const* const index = unlocked_index ();
+
+	if (index) {
+
+		const size_t n = index->when.size();
+		const size_t k = lower_bound (index->when.begin(), index->when.end(), start) - index->when.begin();
+
+		if (k == n) {
+			/* No points in the future, so no steps (towards them) in the future */
+			return false;
+		}
 
-		const ControlEvent* first = NULL;
-		const ControlEvent* next = NULL;
+		size_t f = k;
+
+		if (k == 0 || index->when[k] <= start) {
+			/* Step is after first */
+			if (k + 1 == n) {
+				return false;
+			}
+		} else {
+			/* Step is before first */
+			f = k - 1;
+		}
+
+		indexed_first.when = index->when[f];
+		indexed_first.value = index->value[f];
+		indexed_next.when = index->when[f + 1];
+		indexed_next.value = index->value[f + 1];
+
+		first = &indexed_first;
+		next = &indexed_next;
+
+	} else {
+
+		// Hack to avoid infinitely repeating the same event
+		build_search_cache_if_necessary (start);
+
+		if (_search_cache.first == _events.end()) {
+			/* No points in the future, so no steps (towards them) in the future */
+			return false;
+		}
 
 		if (_search_cache.first == _events.begin() || (*_search_cache.first)->when <= start) {
 			/* Step is after first */
@@ -1615,83 +1879,79 @@ ControlList::rt_safe_earliest_event_linear_unlocked (double start, double& x, do
 			first = *prev;
 			next = *_search_cache.first;
 		}
+	}
 
-		if (inclusive && first->when == start) {
-			x = first->when;
-			y = first->value;
+	if (inclusive && first->when == start) {
+		x = first->when;
+		y = first->value;
+		/* Move left of cache to this point
+		 * (Optimize for immediate call this cycle within range) */
+		_search_cache.left = x;
+		return true;
+	} else if (next->when < start || (!inclusive && next->when == start)) {
+		/* "Next" is before the start, no points left. */
+		return false;
+	}
+
+	if (fabs(first->value - next->value) <= 1) {
+		if (next->when > start) {
+			x = next->when;
+			y = next->value;
 			/* Move left of cache to this point
 			 * (Optimize for immediate call this cycle within range) */
 			_search_cache.left = x;
 			return true;
-		} else if (next->when < start || (!inclusive && next->when == start)) {
-			/* "Next" is before the start, no points left. */
+		} else {
 			return false;
 		}
+	}
 
-		if (fabs(first->value - next->value) <= 1) {
-			if (next->when > start) {
-				x = next->when;
-				y = next->value;
-				/* Move left of cache to this point
-				 * (Optimize for immediate call this cycle within range) */
-				_search_cache.left = x;
-				return true;
-			} else {
-				return false;
-			}
-		}
+	const double slope = (next->value - first->value) / (double)(next->when - first->when);
+	//cerr << "start y: " << start_y << endl;
 
-		const double slope = (next->value - first->value) / (double)(next->when - first->when);
-		//cerr << "start y: " << start_y << endl;
+	//y = first->value + (slope * fabs(start - first->when));
+	y = first->value;
 
-		//y = first->value + (slope * fabs(start - first->when));
-		y = first->value;
+	if (first->value < next->value) // ramping up
+		y = ceil(y);
+	else // ramping down
+		y = floor(y);
+
+	x = first->when + (y - first->value) / (double)slope;
+
+	while ((inclusive && x < start) || (x <= start && y != next->value)) {
 
 		if (first->value < next->value) // ramping up
-			y = ceil(y);
+			y += 1.0;
 		else // ramping down
-			y = floor(y);
+			y -= 1.0;
 
 		x = first->when + (y - first->value) / (double)slope;
+	}
 
-		while ((inclusive && x < start) || (x <= start && y != next->value)) {
-
-			if (first->value < next->value) // ramping up
-				y += 1.0;
-			else // ramping down
-				y -= 1.0;
-
-			x = first->when + (y - first->value) / (double)slope;
-		}
-
-		/*cerr << first->value << " @ " << first->when << " ... "
-		  << next->value << " @ " << next->when
-		  << " = " << y << " @ " << x << endl;*/
+	/*cerr << first->value << " @ " << first->when << " ... "
+	  << next->value << " @ " << next->when
+	  << " = " << y << " @ " << x << endl;*/
 
-		assert(    (y >= first->value && y <= next->value)
-		           || (y <= first->value && y >= next->value) );
+	assert(    (y >= first->value && y <= next->value)
+	           || (y <= first->value && y >= next->value) );
 
 
-		const bool past_start = (inclusive ? x >= start : x > start);
-		if (past_start) {
-			/* Move left of cache to this point
-			 * (Optimize for immediate call this cycle within range) */
-			_search_cache.left = x;
-			assert(inclusive ? x >= start : x > start);
-			return true;
+	const bool past_start = (inclusive ? x >= start : x > start);
+	if (past_start) {
+		/* Move left of cache to this point
+		 * (Optimize for immediate call this cycle within range) */
+		_search_cache.left = x;
+		assert(inclusive ? x >= start : x > start);
+		return true;
+	} else {
+		if (inclusive) {
+			x = next->when;
 		} else {
-			if (inclusive) {
-				x = next->when;
-			} else {
-				x = start;
-			}
-			_search_cache.left = x;
-			return true;
+			x = start;
 		}
-
-	} else {
-		/* No points in the future, so no steps (towards them) in the future */
-		return false;
+		_search_cache.left = x;
+		return true;
 	}
 }
 
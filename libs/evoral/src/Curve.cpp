@@ -178,7 +178,7 @@ Curve::rt_safe_get_vector (double x0, double x1, float *vec, int32_t veclen) con
 	if (!lm.locked()) {
 		return false;
 	} else {
-		_get_vector (x0, x1, vec, veclen);
+		_get_vector (x0, x1, vec, veclen, false);
 		return true;
 	}
 }
@@ -187,11 +187,14 @@ void
 Curve::get_vector (double x0, double x1, float *vec, int32_t veclen) const
 {
 	Glib::Threads::RWLock::ReaderLock lm(_list.lock());
-	_get_vector (x0, x1, vec, veclen);
+	_get_vector (x0, x1, vec, veclen, true);
 }
 
+/** @param may_solve true if the spline may be solved here (which allocates);
+ *  otherwise a curve that needs solving is interpolated linearly.
+ */
 void
-Curve::_get_vector (double x0, double x1, float *vec, int32_t veclen) const
+Curve::_get_vector (double x0, double x1, float *vec, int32_t veclen, bool may_solve) const
 {
 	double rx, lx, hx, max_x, min_x;
 	int32_t i;
@@ -316,8 +319,10 @@ Curve::_get_vector (double x0, double x1, float *vec, int32_t veclen) const
 					}
 					break;
 				case ControlList::Discrete:
-					// any discrete vector curves somewhere?
-					assert (0);
+					for (int i = 0; i < veclen; ++i) {
+						vec[i] = (lx + i * dx_num / dx_den < upos) ? lval : uval;
+					}
+					break;
 				case ControlList::Curved:
 					// fallthrough, no 2 point spline
 				default: // Linear:
@@ -336,8 +341,8 @@ Curve::_get_vector (double x0, double x1, float *vec, int32_t veclen) const
 					vec[0] = interpolate_gain (lval, uval, fraction, _list.descriptor().upper);
 					break;
 				case ControlList::Discrete:
-					// any discrete vector curves somewhere?
-					assert (0);
+					vec[0] = lx < upos ? lval : uval;
+					break;
 				case ControlList::Curved:
 					// fallthrough, no 2 point spline
 				default: // Linear:
@@ -349,8 +354,15 @@ Curve::_get_vector (double x0, double x1, float *vec, int32_t veclen) const
 		return;
 	}
 
-	if (_dirty) {
-		solve ();
+	/* only curved lists use the spline coefficients */
+	bool curved = _list.interpolation() == ControlList::Curved;
+
+	if (curved && _dirty) {
+		if (may_solve) {
+			solve ();
+		} else {
+			curved = false;
+		}
 	}
 
 	rx = lx;
@@ -361,12 +373,12 @@ Curve::_get_vector (double x0, double x1, float *vec, int32_t veclen) const
 	}
 
 	for (i = 0; i < veclen; ++i, rx += dx) {
-		vec[i] = multipoint_eval (rx);
+		vec[i] = multipoint_eval (rx, curved);
 	}
 }
 
 double
-Curve::multipoint_eval (double x) const
+Curve::multipoint_eval (double x, bool curved) const
 {
 	pair<ControlList::EventList::const_iterator,ControlList::EventList::const_iterator> range;
 
@@ -433,7 +445,7 @@ Curve::multipoint_eval (double x) const
 			case ControlList::Exponential:
 				return interpolate_gain (before->value, after->value, tdelta / trange, _list.descriptor().upper);
 			case ControlList::Curved:
-				if (after->coeff) {
+				if (curved && after->coeff) {
 					ControlEvent* ev = after;
 					double x2 = x * x;
 					return ev->coeff[0] + (ev->coeff[1] * x) + (ev->coeff[2] * x2) + (ev->coeff[3] * x2 * x);
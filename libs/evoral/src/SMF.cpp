@@ -261,6 +261,50 @@ SMF::seek_to_start() const
 	}
 }
 
+/** Seek to the first event at or after @a ticks, so that it is the next one
+ * returned by read_event().
+ *
+ * libsmf keeps all events of the track in memory, fully decoded (so running
+ * status does not have to be tracked) and sorted by time, so this is a binary
+ * search, rather than reading from the start of the track.
+ *
+ * \return the time (in ticks) of the event before it, which is what the delta
+ * time returned by the next read_event() is relative to.
+ */
+uint64_t
+SMF::seek_to_time(uint64_t ticks) const
+{
+	Glib::Threads::Mutex::Lock lm (_smf_lock);
+
+	if (!_smf_track) {
+		cerr << "WARNING: SMF seek_to_time() with no track" << endl;
+		return 0;
+	}
+
+	/* events are numbered from 1 */
+	size_t lo = 1;
+	size_t hi = _smf_track->number_of_events + 1;
+
+	while (lo < hi) {
+		size_t const mid = lo + (hi - lo) / 2;
+		if (smf_track_get_event_by_number (_smf_track, mid)->time_pulses < ticks) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	if (lo > _smf_track->number_of_events) {
+		/* nothing left to read */
+		_smf_track->next_event_number = 0;
+		return _smf_track->number_of_events ? smf_track_get_last_event (_smf_track)->time_pulses : 0;
+	}
+
+	_smf_track->next_event_number = lo;
+
+	return lo > 1 ? smf_track_get_event_by_number (_smf_track, lo - 1)->time_pulses : 0;
+}
+
 /** Read an event from the current position in file.
  *
  * File position MUST be at the beginning of a delta time, or this will die very messily.
@@ -24,6 +24,8 @@
 #include <stdint.h>
 #include <cstdio>
 
+#include <boost/make_shared.hpp>
+
 #if __clang__
 #include "evoral/Note.hpp"
 #endif
@@ -493,8 +495,9 @@ Sequence<Time>::Sequence(const Sequence<Time>& other)
 	, _highest_note(other._highest_note)
 {
 	for (typename Notes::const_iterator i = other._notes.begin(); i != other._notes.end(); ++i) {
-		NotePtr n (new Note<Time> (**i));
-		_notes.insert (n);
+		NotePtr n (boost::make_shared<Note<Time> > (**i));
+		/* in order, so the hint makes this constant time */
+		_notes.insert (_notes.end (), n);
 	}
 
 	for (typename SysExes::const_iterator i = other._sysexes.begin(); i != other._sysexes.end(); ++i) {
@@ -856,6 +859,100 @@ Sequence<Time>::remove_note_unlocked(const constNotePtr note)
 	}
 }
 
+template<typename Time>
+size_t
+Sequence<Time>::remove_notes_unlocked (const std::set<NotePtr>& notes)
+{
+	if (notes.empty ()) {
+		return 0;
+	}
+
+	DEBUG_TRACE (DEBUG::Sequence, string_compose ("%1 remove %2 notes\n", this, notes.size ()));
+
+	/* a few notes are cheaper to look up one by one in the indexes */
+	if (notes.size () * 8 < _notes.size ()) {
+		const size_t before = _notes.size ();
+		for (typename std::set<NotePtr>::const_iterator n = notes.begin(); n != notes.end(); ++n) {
+			remove_note_unlocked (*n);
+		}
+		return before - _notes.size ();
+	}
+
+	/* match the notes themselves first. Copies of a note (e.g. those made
+	 * by copy-dragging) share its ID, so an ID must only be used for notes
+	 * that are not in the model as such, like those rebuilt from the undo
+	 * history, and then only for one note per ID.
+	 */
+	std::vector<NotePtr> erased;
+	erased.reserve (notes.size ());
+
+	for (typename Notes::iterator i = _notes.begin(); i != _notes.end(); ) {
+		if (notes.find (*i) != notes.end ()) {
+			erased.push_back (*i);
+			_notes.erase (i++);
+		} else {
+			++i;
+		}
+	}
+
+	if (erased.size () < notes.size ()) {
+		std::set<NotePtr> const found (erased.begin (), erased.end ());
+		std::set<event_id_t> ids;
+
+		for (typename std::set<NotePtr>::const_iterator n = notes.begin(); n != notes.end(); ++n) {
+			if (found.find (*n) == found.end ()) {
+				ids.insert ((*n)->id());
+			}
+		}
+
+		for (typename Notes::iterator i = _notes.begin(); i != _notes.end() && !ids.empty (); ) {
+			typename std::set<event_id_t>::iterator id = ids.find ((*i)->id());
+			if (id != ids.end ()) {
+				DEBUG_TRACE (DEBUG::Sequence, string_compose ("%1\tID-based pass, erasing note #%2\n", this, (*i)->id()));
+				ids.erase (id);
+				erased.push_back (*i);
+				_notes.erase (i++);
+			} else {
+				++i;
+			}
+		}
+	}
+
+	/* the erased notes still have the properties they are indexed by */
+	NotePtr search_note (new Note<Time>(0, Time(), Time(), 0, 0));
+
+	for (typename std::vector<NotePtr>::const_iterator n = erased.begin(); n != erased.end(); ++n) {
+		Pitches& p (pitches ((*n)->channel()));
+		search_note->set_note ((*n)->note());
+
+		typename Pitches::iterator j;
+		for (j = p.lower_bound (search_note); j != p.end() && (*j)->note() == (*n)->note(); ++j) {
+			if (*j == *n) {
+				p.erase (j);
+				break;
+			}
+		}
+	}
+
+	if (!erased.empty ()) {
+		_lowest_note = 127;
+		_highest_note = 0;
+
+		for (typename Notes::const_iterator i = _notes.begin(); i != _notes.end(); ++i) {
+			if ((*i)->note() < _lowest_note) {
+				_lowest_note = (*i)->note();
+			}
+			if ((*i)->note() > _highest_note) {
+				_highest_note = (*i)->note();
+			}
+		}
+
+		_edited = true;
+	}
+
+	return erased.size ();
+}
+
 template<typename Time>
 void
 Sequence<Time>::remove_patch_change_unlocked (const constPatchChangePtr p)
@@ -989,7 +1086,8 @@ Sequence<Time>::append_note_on_unlocked (const Event<Time>& ev, event_id_t evid)
 		return;
 	}
 
-	NotePtr note(new Note<Time>(ev.channel(), ev.time(), Time(), ev.note(), ev.velocity()));
+	/* one allocation for the note and its reference count, next to each other */
+	NotePtr note (boost::make_shared<Note<Time> > (ev.channel(), ev.time(), Time(), ev.note(), ev.velocity()));
 	note->set_id (evid);
 
 	add_note_unlocked (note);
@@ -2,6 +2,9 @@
 #include "evoral/ControlList.hpp"
 #include "evoral/Curve.hpp"
 #include <stdlib.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 CPPUNIT_TEST_SUITE_REGISTRATION (CurveTest);
 
@@ -86,6 +89,34 @@ CurveTest::rtGet ()
 	}
 }
 
+void
+CurveTest::rtGetUnsolved ()
+{
+	float vec[1024];
+
+	boost::shared_ptr<Evoral::ControlList> cl = TestCtrlList();
+	cl->create_curve ();
+	cl->set_interpolation (ControlList::Curved);
+
+	cl->fast_simple_add (   0.0,    0.0);
+	cl->fast_simple_add (1024.0, 1024.0);
+	cl->fast_simple_add (2048.0,    0.0);
+
+	// The spline is not solved yet, RT use must not solve it: expect a line
+	CPPUNIT_ASSERT (cl->curve().rt_safe_get_vector (0.0, 1023.0, vec, 1024));
+	for (int i = 0; i < 1024; ++i) {
+		CPPUNIT_ASSERT_DOUBLES_EQUAL ((float) i, vec[i], 1e-3);
+	}
+
+	// Once solved (by non-RT use), RT use follows the curve
+	cl->curve().get_vector (0.0, 1023.0, vec, 1024);
+	const float curved = vec[512];
+	CPPUNIT_ASSERT (curved != 512.f);
+
+	CPPUNIT_ASSERT (cl->curve().rt_safe_get_vector (0.0, 1023.0, vec, 1024));
+	CPPUNIT_ASSERT_EQUAL (curved, vec[512]);
+}
+
 void
 CurveTest::twoPointLinear ()
 {
@@ -195,6 +226,30 @@ CurveTest::threePointLinear ()
 	CPPUNIT_ASSERT_EQUAL_MESSAGE ("veclen=3 80..160 @ 3", 1.6f, vec[2]);
 }
 
+void
+CurveTest::twoPointDiscrete ()
+{
+	float vec[1024];
+
+	boost::shared_ptr<Evoral::ControlList> cl = TestCtrlList();
+
+	cl->create_curve ();
+	cl->set_interpolation (ControlList::Discrete);
+
+	cl->fast_simple_add (   0.0 , 1.0);
+	cl->fast_simple_add (1024.0 , 2.0);
+
+	cl->curve ().get_vector (512.0, 1535.0, vec, 1024);
+
+	CPPUNIT_ASSERT_EQUAL (1.f, vec[0]);
+	CPPUNIT_ASSERT_EQUAL (1.f, vec[511]);
+	CPPUNIT_ASSERT_EQUAL (2.f, vec[512]);
+	CPPUNIT_ASSERT_EQUAL (2.f, vec[1023]);
+
+	cl->curve ().get_vector (512.0, 512.0, vec, 1);
+	CPPUNIT_ASSERT_EQUAL (1.f, vec[0]);
+}
+
 void
 CurveTest::threePointDiscete ()
 {
@@ -472,3 +527,185 @@ CurveTest::constrainedCubic ()
 		CPPUNIT_ASSERT_DOUBLES_EQUAL(v, g[x], 0.000008);
 	}
 }
+
+void
+CurveTest::indexedEval ()
+{
+	boost::shared_ptr<Evoral::ControlList> cl = TestCtrlList();
+
+	/* fast_simple_add() leaves the contiguous index stale, so the
+	 * first evaluation walks the list, as before.
+	 */
+	srand (7);
+	for (int i = 0; i < 1000; ++i) {
+		cl->fast_simple_add (i * 100.0 + (i % 3) * 17.0, (rand () % 1000) / 10.0);
+	}
+
+	const ControlList::InterpolationStyle styles[] = { ControlList::Discrete, ControlList::Linear };
+
+	for (int s = 0; s < 2; ++s) {
+		cl->set_interpolation (styles[s]);
+
+		std::vector<double> listed;
+		std::vector<double> earliest;
+
+		cl->mark_dirty ();
+
+		for (double x = -50.0; x < 100100.0; x += 33.0) {
+			listed.push_back (cl->unlocked_eval (x));
+		}
+		for (double x = -50.0; x < 100100.0; x += 333.0) {
+			double ex = 0, ey = 0;
+			earliest.push_back (cl->rt_safe_earliest_event_unlocked (x, ex, ey, true) ? ex : -1.0);
+		}
+
+		/* builds the index */
+		cl->freeze ();
+		cl->thaw ();
+
+		size_t n = 0;
+		for (double x = -50.0; x < 100100.0; x += 33.0, ++n) {
+			CPPUNIT_ASSERT_DOUBLES_EQUAL (listed[n], cl->unlocked_eval (x), 1e-9);
+		}
+
+		n = 0;
+		for (double x = -50.0; x < 100100.0; x += 333.0, ++n) {
+			double ex = 0, ey = 0;
+			CPPUNIT_ASSERT_DOUBLES_EQUAL (earliest[n], cl->rt_safe_earliest_event_unlocked (x, ex, ey, true) ? ex : -1.0, 1e-9);
+		}
+
+		/* exact hits on control points */
+		for (ControlList::const_iterator i = cl->begin(); i != cl->end(); ++i) {
+			CPPUNIT_ASSERT_EQUAL ((*i)->value, cl->unlocked_eval ((*i)->when));
+		}
+	}
+}
+
+void
+CurveTest::indexAfterEdits ()
+{
+	boost::shared_ptr<Evoral::ControlList> cl = TestCtrlList();
+	cl->set_interpolation (ControlList::Linear);
+
+	for (int i = 0; i < 10; ++i) {
+		cl->fast_simple_add (i * 100.0, i);
+	}
+
+	/* builds the index */
+	CPPUNIT_ASSERT_DOUBLES_EQUAL (4.5, cl->eval (450.0), 1e-9);
+
+	/* an edit leaves the index stale, the next read must not use it */
+	ControlList::iterator p = cl->begin ();
+	std::advance (p, 5);
+	cl->modify (p, 500.0, 9.0);
+
+	bool ok;
+	CPPUNIT_ASSERT_DOUBLES_EQUAL (6.5, cl->rt_safe_eval (450.0, ok), 1e-9);
+	CPPUNIT_ASSERT (ok);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL (6.5, cl->eval (450.0), 1e-9);
+
+	cl->add (450.0, 1.0, false, false);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL (1.0, cl->rt_safe_eval (450.0, ok), 1e-9);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL (1.0, cl->eval (450.0), 1e-9);
+
+	/* a change in place (as Lua scripts make them) followed by
+	 * mark_dirty(): the process thread walks the list until the index
+	 * is rebuilt elsewhere.
+	 */
+	p = cl->begin ();
+	std::advance (p, 5);
+	(*p)->value = 3.0;
+	cl->mark_dirty ();
+
+	CPPUNIT_ASSERT_DOUBLES_EQUAL (3.0, cl->rt_safe_eval (450.0, ok), 1e-9);
+	CPPUNIT_ASSERT (ok);
+	cl->rebuild_index_if_necessary ();
+	CPPUNIT_ASSERT_DOUBLES_EQUAL (3.0, cl->rt_safe_eval (450.0, ok), 1e-9);
+	CPPUNIT_ASSERT (ok);
+}
+
+void
+CurveTest::writePassThinning ()
+{
+	boost::shared_ptr<Evoral::ControlList> cl = TestCtrlList();
+	cl->set_interpolation (ControlList::Linear);
+
+	/* a ramp up and down, written with one point per cycle */
+	cl->start_write_pass (0, 20.0);
+	cl->set_in_write_pass (true);
+
+	for (int i = 0; i < 4096; ++i) {
+		cl->add (i * 1024.0, i < 2048 ? i / 2048.0 : (4096 - i) / 2048.0, false);
+	}
+
+	/* while the pass is running, one point in 65 is kept along the
+	 * straight lines, since at most 64 in a row are removed.
+	 */
+	CPPUNIT_ASSERT_EQUAL ((size_t) 65, cl->size ());
+	CPPUNIT_ASSERT_DOUBLES_EQUAL (1.0, cl->unlocked_eval (2048 * 1024.0), 1e-9);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL (0.5, cl->unlocked_eval (1024 * 1024.0), 1e-6);
+	CPPUNIT_ASSERT_DOUBLES_EQUAL (0.5, cl->unlocked_eval (3072 * 1024.0), 1e-3);
+
+	cl->set_in_write_pass (false);
+	cl->write_pass_finished (4096 * 1024.0, 20.0);
+
+	/* thin() then leaves only the ends and the peak */
+	CPPUNIT_ASSERT_EQUAL ((size_t) 3, cl->size ());
+}
+
+static double
+thinning_test_curve (int i)
+{
+	return 0.5 + 0.5 * sin (2.0 * M_PI * i / 4096.0);
+}
+
+void
+CurveTest::writePassThinningCurve ()
+{
+	boost::shared_ptr<Evoral::ControlList> cl = TestCtrlList();
+	cl->set_interpolation (ControlList::Linear);
+
+	/* a slow sine, where every single point is close to the line
+	 * through its neighbours, but the curve is not.
+	 */
+	cl->start_write_pass (0, 20.0);
+	cl->set_in_write_pass (true);
+
+	for (int i = 0; i < 4096; ++i) {
+		cl->add (i * 1024.0, thinning_test_curve (i), false);
+	}
+
+	cl->set_in_write_pass (false);
+	cl->write_pass_finished (4096 * 1024.0, 20.0);
+
+	CPPUNIT_ASSERT (cl->size () < 4096 / 10);
+
+	std::vector<std::pair<double, double> > kept;
+	for (ControlList::const_iterator e = cl->begin (); e != cl->end (); ++e) {
+		kept.push_back (std::make_pair ((*e)->when, (*e)->value));
+	}
+
+	double max_error = 0;
+	size_t seg = 0;
+
+	for (int i = 0; i < 4096; ++i) {
+		double const when = i * 1024.0;
+
+		while (seg + 2 < kept.size () && kept[seg + 1].first <= when) {
+			++seg;
+		}
+
+		double const span = kept[seg + 1].first - kept[seg].first;
+		double const error = fabs (cl->unlocked_eval (when) - thinning_test_curve (i));
+
+		/* the thinning criterion, for every point that was written:
+		 * twice the area of the triangle it forms with the line that
+		 * replaced it stays below the thinning factor.
+		 */
+		CPPUNIT_ASSERT (error * span < 20.0 + 1e-6);
+
+		max_error = std::max (max_error, error);
+	}
+
+	CPPUNIT_ASSERT (max_error < 1e-3);
+}
@@ -8,21 +8,33 @@ class CurveTest : public CppUnit::TestFixture
 	CPPUNIT_TEST_SUITE (CurveTest);
 	CPPUNIT_TEST (trivial);
 	CPPUNIT_TEST (rtGet);
+	CPPUNIT_TEST (rtGetUnsolved);
 	CPPUNIT_TEST (twoPointLinear);
 	CPPUNIT_TEST (threePointLinear);
+	CPPUNIT_TEST (twoPointDiscrete);
 	CPPUNIT_TEST (threePointDiscete);
 	CPPUNIT_TEST (constrainedCubic);
 	CPPUNIT_TEST (ctrlListEval);
+	CPPUNIT_TEST (indexedEval);
+	CPPUNIT_TEST (indexAfterEdits);
+	CPPUNIT_TEST (writePassThinning);
+	CPPUNIT_TEST (writePassThinningCurve);
 	CPPUNIT_TEST_SUITE_END ();
 
 public:
 	void trivial ();
 	void rtGet ();
+	void rtGetUnsolved ();
 	void twoPointLinear ();
 	void threePointLinear ();
+	void twoPointDiscrete ();
 	void threePointDiscete ();
 	void constrainedCubic ();
 	void ctrlListEval ();
+	void indexedEval ();
+	void indexAfterEdits ();
+	void writePassThinning ();
+	void writePassThinningCurve ();
 
 private:
 	boost::shared_ptr<Evoral::ControlList> TestCtrlList() {
@@ -1,5 +1,8 @@
 #include "SMFTest.hpp"
 
+#include <algorithm>
+#include <vector>
+
 #include <glibmm/fileutils.h>
 #include <glibmm/miscutils.h>
 
@@ -117,3 +120,51 @@ SMFTest::writeTest ()
 
 	// TODO: Check files are actually equivalent
 }
+
+void
+SMFTest::seekTest ()
+{
+	TestSMF smf;
+	string  testdata_path;
+	CPPUNIT_ASSERT (find_file (test_search_path (), "TakeFive.mid", testdata_path));
+
+	smf.open(testdata_path);
+	CPPUNIT_ASSERT(!smf.is_empty());
+
+	uint32_t delta_t = 0;
+	uint32_t size    = 0;
+	uint8_t* buf     = NULL;
+
+	/* read the whole track to know when each event happens */
+	vector<uint64_t> times;
+	uint64_t time = 0;
+	smf.seek_to_start();
+	while (smf.read_event(&delta_t, &size, &buf) >= 0) {
+		time += delta_t;
+		times.push_back (time);
+	}
+	CPPUNIT_ASSERT (times.size() > 2);
+
+	const uint64_t end = times.back();
+
+	for (uint64_t target = 0; target <= end; target += end / 97 + 1) {
+		const size_t expected = lower_bound (times.begin(), times.end(), target) - times.begin();
+
+		time = smf.seek_to_time (target);
+		CPPUNIT_ASSERT_EQUAL (expected > 0 ? times[expected - 1] : (uint64_t) 0, time);
+
+		/* the next event read is the first one at or after target,
+		   and reading continues from there as usual */
+		for (size_t n = expected; n < min (expected + 3, times.size()); ++n) {
+			CPPUNIT_ASSERT (smf.read_event(&delta_t, &size, &buf) >= 0);
+			time += delta_t;
+			CPPUNIT_ASSERT_EQUAL (times[n], time);
+		}
+	}
+
+	/* beyond the end, there is nothing left to read */
+	smf.seek_to_time (end + 1);
+	CPPUNIT_ASSERT_EQUAL (-1, smf.read_event(&delta_t, &size, &buf));
+
+	free (buf);
+}
@@ -1,4 +1,5 @@
 #include "SequenceTest.hpp"
+#include <algorithm>
 #include <cassert>
 
 CPPUNIT_TEST_SUITE_REGISTRATION(SequenceTest);
@@ -194,3 +195,75 @@ SequenceTest::controlInterpolationTest ()
 		last_value = i->second;
 	}
 }
+
+void
+SequenceTest::removeNotesTest ()
+{
+	seq->clear();
+
+	for (Notes::const_iterator i = test_notes.begin(); i != test_notes.end(); ++i) {
+		CPPUNIT_ASSERT (seq->add_note_unlocked (*i));
+	}
+
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 64, seq->lowest_note ());
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 75, seq->highest_note ());
+
+	/* the lowest and highest notes, and one whose time has been changed since it was added */
+	std::set<MySequence<Time>::NotePtr> removals;
+	removals.insert (test_notes[0]);
+	removals.insert (test_notes[11]);
+	removals.insert (test_notes[5]);
+	test_notes[5]->set_time (Time (1150));
+
+	CPPUNIT_ASSERT_EQUAL (size_t (3), seq->remove_notes_unlocked (removals));
+
+	CPPUNIT_ASSERT_EQUAL (size_t (9), seq->notes().size());
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 65, seq->lowest_note ());
+	CPPUNIT_ASSERT_EQUAL ((uint8_t) 74, seq->highest_note ());
+
+	for (MySequence<Time>::Notes::const_iterator i = seq->notes().begin(); i != seq->notes().end(); ++i) {
+		CPPUNIT_ASSERT (removals.find (*i) == removals.end ());
+	}
+
+	/* removing notes that are not there any more is harmless */
+	CPPUNIT_ASSERT_EQUAL (size_t (0), seq->remove_notes_unlocked (removals));
+	CPPUNIT_ASSERT_EQUAL (size_t (9), seq->notes().size());
+}
+
+void
+SequenceTest::removeNoteCopiesTest ()
+{
+	seq->clear();
+
+	for (Notes::const_iterator i = test_notes.begin(); i != test_notes.end(); ++i) {
+		CPPUNIT_ASSERT (seq->add_note_unlocked (*i));
+	}
+
+	/* copies keep the ID of their original, like those of a copy-drag */
+	std::set<MySequence<Time>::NotePtr> copies;
+	for (Notes::const_iterator i = test_notes.begin(); i != test_notes.end(); ++i) {
+		MySequence<Time>::NotePtr copy (new Note<Time> (**i));
+		copy->set_time (copy->time() + Time (5000));
+		CPPUNIT_ASSERT (seq->add_note_unlocked (copy));
+		copies.insert (copy);
+	}
+
+	CPPUNIT_ASSERT_EQUAL (size_t (24), seq->notes().size());
+	CPPUNIT_ASSERT_EQUAL (size_t (12), seq->remove_notes_unlocked (copies));
+	CPPUNIT_ASSERT_EQUAL (size_t (12), seq->notes().size());
+
+	for (Notes::const_iterator i = test_notes.begin(); i != test_notes.end(); ++i) {
+		CPPUNIT_ASSERT (std::find (seq->notes().begin(), seq->notes().end(), *i) != seq->notes().end());
+	}
+
+	/* and a single copy, which takes the per-note path */
+	MySequence<Time>::NotePtr copy (new Note<Time> (*test_notes[3]));
+	copy->set_time (copy->time() + Time (5000));
+	CPPUNIT_ASSERT (seq->add_note_unlocked (copy));
+
+	std::set<MySequence<Time>::NotePtr> one;
+	one.insert (copy);
+	CPPUNIT_ASSERT_EQUAL (size_t (1), seq->remove_notes_unlocked (one));
+	CPPUNIT_ASSERT_EQUAL (size_t (12), seq->notes().size());
+	CPPUNIT_ASSERT (std::find (seq->notes().begin(), seq->notes().end(), test_notes[3]) != seq->notes().end());
+}
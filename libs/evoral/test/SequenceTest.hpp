@@ -116,6 +116,8 @@ class SequenceTest : public CppUnit::TestFixture
 	CPPUNIT_TEST (preserveEventOrderingTest);
 	CPPUNIT_TEST (iteratorSeekTest);
 	CPPUNIT_TEST (controlInterpolationTest);
+	CPPUNIT_TEST (removeNotesTest);
+	CPPUNIT_TEST (removeNoteCopiesTest);
 	CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -146,6 +148,8 @@ public:
 	void preserveEventOrderingTest ();
 	void iteratorSeekTest ();
 	void controlInterpolationTest ();
+	void removeNotesTest ();
+	void removeNoteCopiesTest ();
 
 private:
 	DummyTypeMap*       type_map;
@@ -0,0 +1,90 @@
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <glib.h>
+#include <boost/shared_ptr.hpp>
+
+#include "pbd/compose.h"
+
+#include "evoral/ControlList.hpp"
+#include "evoral/Parameter.hpp"
+#include "evoral/ParameterDescriptor.hpp"
+
+using namespace std;
+using namespace Evoral;
+
+/** Evaluate @a cl at @a positions, and look for the next event after each of them,
+ *  printing the time each takes.
+ */
+static void
+run (char const* name, boost::shared_ptr<ControlList> cl, vector<double> const& positions)
+{
+	double sum = 0;
+
+	gint64 start = g_get_monotonic_time ();
+	for (vector<double>::const_iterator p = positions.begin (); p != positions.end (); ++p) {
+		sum += cl->unlocked_eval (*p);
+	}
+	gint64 const eval = g_get_monotonic_time () - start;
+
+	start = g_get_monotonic_time ();
+	for (vector<double>::const_iterator p = positions.begin (); p != positions.end (); ++p) {
+		double x, y;
+		if (cl->rt_safe_earliest_event_unlocked (*p, x, y, true)) {
+			sum += y;
+		}
+	}
+	gint64 const earliest = g_get_monotonic_time () - start;
+
+	cout << string_compose ("%1: %2 evals %3 ms, earliest event %4 ms (%5)\n",
+	                        name, positions.size (), eval / 1000, earliest / 1000, sum) << flush;
+}
+
+/** Compare ControlList lookups with and without the contiguous index.
+ *
+ *  Usage: control_list [points] [lookups]
+ */
+int
+main (int argc, char* argv[])
+{
+	int const n_points = argc > 1 ? atoi (argv[1]) : 100000;
+	int const lookups = argc > 2 ? atoi (argv[2]) : 100000;
+
+	boost::shared_ptr<ControlList> cl (new ControlList (Parameter (0), ParameterDescriptor ()));
+
+	srand (42);
+	cl->freeze ();
+	for (int i = 0; i < n_points; ++i) {
+		cl->fast_simple_add (i * 64.0, (rand () % 1000) / 1000.0);
+	}
+	cl->thaw ();
+
+	vector<double> sequential;
+	vector<double> random;
+	for (int i = 0; i < lookups; ++i) {
+		sequential.push_back (i * (n_points * 64.0 / lookups));
+		random.push_back (rand () % (n_points * 64));
+	}
+
+	ControlList::InterpolationStyle const styles[] = { ControlList::Discrete, ControlList::Linear };
+	char const* const style_names[] = { "discrete", "linear" };
+
+	for (int s = 0; s < 2; ++s) {
+		cl->set_interpolation (styles[s]);
+
+		/* stale index: walk the list, with the lookup caches */
+		cl->mark_dirty ();
+		run (string_compose ("%1, list, sequential", style_names[s]).c_str (), cl, sequential);
+		cl->mark_dirty ();
+		run (string_compose ("%1, list, random", style_names[s]).c_str (), cl, random);
+
+		/* thaw() builds the index again */
+		cl->freeze ();
+		cl->thaw ();
+		run (string_compose ("%1, index, sequential", style_names[s]).c_str (), cl, sequential);
+		run (string_compose ("%1, index, random", style_names[s]).c_str (), cl, random);
+	}
+
+	return 0;
+}
@@ -0,0 +1,159 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef _pbd_mpmc_queue_h_
+#define _pbd_mpmc_queue_h_
+
+#include <cassert>
+#include <cstddef>
+#include <stdint.h>
+
+#include <glib.h>
+
+#include "pbd/libpbd_visibility.h"
+
+namespace PBD {
+
+/** Lock-free bounded multiple-producer/multiple-consumer queue.
+ *
+ * This is a fixed-size array of cells, each tagged with a sequence
+ * number (after Dmitry Vyukov's bounded MPMC queue). Producers and
+ * consumers each claim a slot with a single CAS; nobody ever blocks.
+ *
+ * The size must be set with ::reserve() before the queue is used
+ * concurrently; push_back() and pop_front() never allocate.
+ */
+template <typename T>
+class /*LIBPBD_API*/ MPMCQueue
+{
+public:
+	MPMCQueue (size_t buffer_size = 8)
+		: _buffer (0)
+		, _buffer_mask (0)
+	{
+		reserve (buffer_size);
+	}
+
+	~MPMCQueue ()
+	{
+		delete[] _buffer;
+	}
+
+	static size_t
+	power_of_two_size (size_t sz)
+	{
+		int32_t power_of_two;
+		for (power_of_two = 1; 1U << power_of_two < sz; ++power_of_two) ;
+		return 1U << power_of_two;
+	}
+
+	/** Resize the queue. NOT thread safe, drops all queued elements. */
+	void
+	reserve (size_t buffer_size)
+	{
+		buffer_size = power_of_two_size (buffer_size);
+		assert ((buffer_size >= 2) && ((buffer_size & (buffer_size - 1)) == 0));
+		if (_buffer_mask >= buffer_size - 1) {
+			return;
+		}
+		delete[] _buffer;
+		_buffer = new cell_t[buffer_size];
+		_buffer_mask = buffer_size - 1;
+		clear ();
+	}
+
+	/** NOT thread safe */
+	void
+	clear ()
+	{
+		for (size_t i = 0; i <= _buffer_mask; ++i) {
+			g_atomic_int_set (&_buffer[i]._sequence, (gint) i);
+		}
+		g_atomic_int_set (&_enqueue_pos, 0);
+		g_atomic_int_set (&_dequeue_pos, 0);
+	}
+
+	bool
+	push_back (T const& data)
+	{
+		cell_t* cell;
+		guint pos = (guint) g_atomic_int_get (&_enqueue_pos);
+		for (;;) {
+			cell = &_buffer[pos & _buffer_mask];
+			guint seq = (guint) g_atomic_int_get (&cell->_sequence);
+			gint dif = (gint)(seq - pos);
+			if (dif == 0) {
+				if (g_atomic_int_compare_and_exchange (&_enqueue_pos, (gint) pos, (gint) (pos + 1))) {
+					break;
+				}
+			} else if (dif < 0) {
+				/* queue is full */
+				return false;
+			} else {
+				pos = (guint) g_atomic_int_get (&_enqueue_pos);
+			}
+		}
+
+		cell->_data = data;
+		g_atomic_int_set (&cell->_sequence, (gint) (pos + 1));
+		return true;
+	}
+
+	bool
+	pop_front (T& data)
+	{
+		cell_t* cell;
+		guint pos = (guint) g_atomic_int_get (&_dequeue_pos);
+		for (;;) {
+			cell = &_buffer[pos & _buffer_mask];
+			guint seq = (guint) g_atomic_int_get (&cell->_sequence);
+			gint dif = (gint)(seq - (pos + 1));
+			if (dif == 0) {
+				if (g_atomic_int_compare_and_exchange (&_dequeue_pos, (gint) pos, (gint) (pos + 1))) {
+					break;
+				}
+			} else if (dif < 0) {
+				/* queue is empty */
+				return false;
+			} else {
+				pos = (guint) g_atomic_int_get (&_dequeue_pos);
+			}
+		}
+
+		data = cell->_data;
+		g_atomic_int_set (&cell->_sequence, (gint) (pos + _buffer_mask + 1));
+		return true;
+	}
+
+private:
+	struct cell_t {
+		volatile gint _sequence;
+		T             _data;
+	};
+
+	cell_t*       _buffer;
+	size_t        _buffer_mask;
+
+	volatile gint _enqueue_pos;
+	volatile gint _dequeue_pos;
+};
+
+} /* end namespace PBD */
+
+#endif
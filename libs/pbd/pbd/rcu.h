@@ -124,17 +124,7 @@ public:
 	{
 		m_lock.lock();
 
-		// clean out any dead wood
-
-		typename std::list<boost::shared_ptr<T> >::iterator i;
-
-		for (i = m_dead_wood.begin(); i != m_dead_wood.end(); ) {
-			if ((*i).unique()) {
-				i = m_dead_wood.erase (i);
-			} else {
-				++i;
-			}
-		}
+		clean_dead_wood ();
 
 		/* store the current so that we can do compare and exchange
 		   when someone calls update(). Notice that we hold
@@ -188,12 +178,43 @@ public:
 		return ret;
 	}
 
+	/** Publish @param new_value, built from scratch by the caller,
+	 *  without making a copy of the current value first. Same as
+	 *  write_copy() followed by update(), for writers that never look at
+	 *  the old value.
+	 */
+	bool replace (boost::shared_ptr<T> new_value)
+	{
+		m_lock.lock();
+
+		clean_dead_wood ();
+
+		current_write_old = RCUManager<T>::x.m_rcu_value;
+
+		return update (new_value);
+	}
+
 	void flush () {
 		Glib::Threads::Mutex::Lock lm (m_lock);
 		m_dead_wood.clear ();
 	}
 
 private:
+	void clean_dead_wood ()
+	{
+		/* CALLER MUST HOLD m_lock */
+
+		typename std::list<boost::shared_ptr<T> >::iterator i;
+
+		for (i = m_dead_wood.begin(); i != m_dead_wood.end(); ) {
+			if ((*i).unique()) {
+				i = m_dead_wood.erase (i);
+			} else {
+				++i;
+			}
+		}
+	}
+
 	Glib::Threads::Mutex                      m_lock;
 	boost::shared_ptr<T>*            current_write_old;
 	std::list<boost::shared_ptr<T> > m_dead_wood;
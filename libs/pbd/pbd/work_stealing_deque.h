@@ -0,0 +1,140 @@
+/*
+    Copyright (C) 2026 agent
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+
+*/
+
+#ifndef _pbd_work_stealing_deque_h_
+#define _pbd_work_stealing_deque_h_
+
+#include <cassert>
+
+#include <glib.h>
+
+#include "pbd/libpbd_visibility.h"
+
+namespace PBD {
+
+/** Bounded lock-free work-stealing deque (Chase & Lev).
+ *
+ * Exactly one thread (the owner) may call push() and pop(), which
+ * operate LIFO on the bottom end. Any other thread may call steal(),
+ * which takes the oldest element from the top end.
+ *
+ * Indices are free-running and compared modulo 2^32, so the deque
+ * never needs to be reset while other threads may be looking at it.
+ * The capacity is fixed at construction time; push() fails rather
+ * than allocate.
+ */
+template <typename T>
+class /*LIBPBD_API*/ WorkStealingDeque
+{
+public:
+	WorkStealingDeque (guint sz)
+	{
+		guint power_of_two;
+		for (power_of_two = 1; 1U << power_of_two < sz; ++power_of_two) ;
+		_size = 1U << power_of_two;
+		_mask = _size - 1;
+		_buf  = new T[_size];
+		g_atomic_int_set (&_top, 0);
+		g_atomic_int_set (&_bottom, 0);
+	}
+
+	~WorkStealingDeque ()
+	{
+		delete [] _buf;
+	}
+
+	/** Owner only */
+	bool push (T const& v)
+	{
+		guint b = (guint) g_atomic_int_get (&_bottom);
+		guint t = (guint) g_atomic_int_get (&_top);
+		if ((gint)(b - t) >= (gint)_size) {
+			return false;
+		}
+		_buf[b & _mask] = v;
+		g_atomic_int_set (&_bottom, (gint)(b + 1));
+		return true;
+	}
+
+	/** Owner only */
+	bool pop (T& v)
+	{
+		/* use an atomic RMW rather than a plain store, since the
+		 * following read of _top must not be reordered before it.
+		 */
+		guint b = (guint) g_atomic_int_add (&_bottom, -1) - 1;
+		guint t = (guint) g_atomic_int_get (&_top);
+
+		if ((gint)(b - t) < 0) {
+			/* empty */
+			g_atomic_int_set (&_bottom, (gint)(b + 1));
+			return false;
+		}
+
+		v = _buf[b & _mask];
+
+		if (b != t) {
+			/* more than one element left, no thief can reach this one */
+			return true;
+		}
+
+		/* last element, race against thieves for it */
+		bool won = g_atomic_int_compare_and_exchange (&_top, (gint) t, (gint)(t + 1));
+		g_atomic_int_set (&_bottom, (gint)(b + 1));
+		return won;
+	}
+
+	/** Any thread */
+	bool steal (T& v)
+	{
+		guint t = (guint) g_atomic_int_get (&_top);
+		guint b = (guint) g_atomic_int_get (&_bottom);
+
+		if ((gint)(b - t) <= 0) {
+			return false;
+		}
+
+		v = _buf[t & _mask];
+		return g_atomic_int_compare_and_exchange (&_top, (gint) t, (gint)(t + 1));
+	}
+
+	/** Approximate number of queued elements */
+	guint size () const
+	{
+		gint d = (gint)((guint) g_atomic_int_get (&_bottom) - (guint) g_atomic_int_get (&_top));
+		return d > 0 ? (guint) d : 0;
+	}
+
+	guint capacity () const { return _size; }
+
+private:
+	WorkStealingDeque (WorkStealingDeque const&);
+	WorkStealingDeque& operator= (WorkStealingDeque const&);
+
+	T*    _buf;
+	guint _size;
+	guint _mask;
+
+	mutable volatile gint _top;
+	mutable volatile gint _bottom;
+};
+
+} /* end namespace PBD */
+
+#endif
@@ -400,6 +400,8 @@ OSC::register_callbacks()
 		REGISTER_CALLBACK (serv, "/refresh", "f", refresh_surface);
 		REGISTER_CALLBACK (serv, "/strip/list", "", routes_list);
 		REGISTER_CALLBACK (serv, "/strip/list", "f", routes_list);
+		REGISTER_CALLBACK (serv, "/strip/dsp_stats", "", routes_dsp_stats);
+		REGISTER_CALLBACK (serv, "/strip/dsp_stats", "f", routes_dsp_stats);
 		REGISTER_CALLBACK (serv, "/add_marker", "", add_marker);
 		REGISTER_CALLBACK (serv, "/add_marker", "f", add_marker);
 		REGISTER_CALLBACK (serv, "/access_action", "s", access_action);
@@ -1230,6 +1232,69 @@ OSC::routes_list (lo_message msg)
 	lo_message_free (reply);
 }
 
+/** Reply with the processing time statistics of every route in the session,
+ *  one message per route: name, cycles, last, min, avg, max (usec), followed
+ *  by the histogram bins (see ARDOUR::DSPStats).
+ */
+void
+OSC::routes_dsp_stats (lo_message msg)
+{
+	if (!session) {
+		return;
+	}
+	OSCSurface *sur = get_surface(get_address (msg));
+
+	boost::shared_ptr<RouteList> rl = session->get_routes ();
+
+	for (RouteList::const_iterator i = rl->begin(); i != rl->end(); ++i) {
+
+		if ((*i)->is_auditioner ()) {
+			continue;
+		}
+
+		DSPStats::Snapshot s;
+
+		if (!(*i)->dsp_stats_snapshot (s)) {
+			/* busy, the surface keeps what it was sent last */
+			continue;
+		}
+
+		lo_message reply = lo_message_new ();
+
+		lo_message_add_string (reply, "dsp_stats");
+		lo_message_add_string (reply, (*i)->name().c_str());
+		lo_message_add_int64 (reply, s.count);
+		lo_message_add_float (reply, s.last);
+		lo_message_add_float (reply, s.min);
+		lo_message_add_float (reply, s.avg);
+		lo_message_add_float (reply, s.max);
+		for (uint32_t n = 0; n < DSPStats::n_bins; ++n) {
+			lo_message_add_int64 (reply, s.bin (n));
+		}
+
+		if (sur->feedback[14]) {
+			lo_send_message (get_address (msg), "/reply", reply);
+		} else {
+			lo_send_message (get_address (msg), "#reply", reply);
+		}
+		lo_message_free (reply);
+	}
+
+	// Send end of listing message
+	lo_message reply = lo_message_new ();
+
+	lo_message_add_string (reply, "end_dsp_stats");
+	lo_message_add_float (reply, 1e6 * session->get_block_size() / session->sample_rate());
+
+	if (sur->feedback[14]) {
+		lo_send_message (get_address (msg), "/reply", reply);
+	} else {
+		lo_send_message (get_address (msg), "#reply", reply);
+	}
+
+	lo_message_free (reply);
+}
+
 int
 OSC::cancel_all_solos ()
 {
@@ -0,0 +1,26 @@
+ardour { ["type"] = "Snippet", name = "Dump Route DSP Stats",
+	license     = "MIT",
+	author      = "agent",
+}
+
+function factory () return function ()
+	local cycle_us = 1e6 * Session:get_block_size () / Session:sample_rate ()
+	print (string.format ("Cycle: %.1f us", cycle_us))
+
+	-- sort routes by average processing time, most expensive first
+	local stats = {}
+	for r in Session:get_routes ():iter () do
+		local s = ARDOUR.DSPStats ()
+		if r:dsp_stats (s) then
+			stats[#stats + 1] = { name = r:name (), s = s }
+		else
+			print (string.format ("%-30s  busy, try again", r:name ()))
+		end
+	end
+	table.sort (stats, function (a, b) return a.s.avg > b.s.avg end)
+
+	for _, e in ipairs (stats) do
+		print (string.format ("%-30s  cycles: %8d  min: %6d  avg: %8.1f  max: %6d [us]  avg-load: %5.1f%%",
+		e.name, e.s.count, e.s.min, e.s.avg, e.s.max, 100 * e.s.avg / cycle_us))
+	end
+end end